@@ -0,0 +1,161 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Plays the same file on a VideoWall of 16, 36 and 64 tiles and reports the
+// frame rate of the window and how long the render thread spends on each
+// frame. Usage: QtMediaPlayerVideoWallBenchmark <media file> [seconds per run]
+// [tile frame rate limit].
+
+#include <qtmediaplayer.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qurl.h>
+#include <QtCore/qvariant.h>
+#include <QtGui/qguiapplication.h>
+#include <QtQml/qqmlapplicationengine.h>
+#include <QtQuick/qquickwindow.h>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+
+QTMEDIAPLAYER_USE_NAMESPACE
+
+static const char kQml[] = R"(
+import QtQuick 2.15
+import QtQuick.Window 2.15
+import org.wangwenx190.QtMediaPlayer 1.0
+
+Window {
+    width: 1920
+    height: 1080
+    visible: true
+    color: "black"
+
+    VideoWall {
+        objectName: "wall"
+        anchors.fill: parent
+    }
+}
+)";
+
+static constexpr const int kTileCounts[] = {16, 36, 64};
+// Give the players some time to open the file and decode the first frames.
+static constexpr const int kWarmUp = 3000;
+
+// Written by the render thread, read by the GUI thread between two runs.
+struct FrameStatistics
+{
+    QAtomicInteger<qint64> frames = 0;
+    QAtomicInteger<qint64> renderTime = 0;
+    QAtomicInteger<qint64> longestRenderTime = 0;
+    QElapsedTimer renderTimer = {};
+
+    void reset()
+    {
+        frames.storeRelaxed(0);
+        renderTime.storeRelaxed(0);
+        longestRenderTime.storeRelaxed(0);
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication application(argc, argv);
+
+    const QStringList arguments = QCoreApplication::arguments();
+    if (arguments.size() < 2) {
+        std::printf("Usage: %s <media file> [seconds per run] [tile frame rate limit]\n", qUtf8Printable(arguments.constFirst()));
+        return 1;
+    }
+    const QUrl source = QUrl::fromUserInput(arguments.at(1), QCoreApplication::applicationDirPath(), QUrl::AssumeLocalFile);
+    const int seconds = ((arguments.size() > 2) ? qMax(arguments.at(2).toInt(), 1) : 10);
+    const qreal frameRate = ((arguments.size() > 3) ? qMax(arguments.at(3).toDouble(), 0.0) : 0.0);
+
+    if (!Loader::initializeBackend(QStringLiteral("mdk"))) {
+        std::printf("The MDK backend is not available.\n");
+        return 1;
+    }
+
+    QQmlApplicationEngine engine;
+    engine.loadData(QByteArray(kQml));
+    if (engine.rootObjects().isEmpty()) {
+        return 1;
+    }
+    const auto window = qobject_cast<QQuickWindow *>(engine.rootObjects().constFirst());
+    QObject * const wall = (window ? window->findChild<QObject *>(QStringLiteral("wall")) : nullptr);
+    if (!wall) {
+        return 1;
+    }
+    wall->setProperty("tileFrameRate", frameRate);
+
+    FrameStatistics statistics = {};
+    QObject::connect(window, &QQuickWindow::beforeRendering, window, [&statistics](){
+        statistics.renderTimer.start();
+    }, Qt::DirectConnection);
+    QObject::connect(window, &QQuickWindow::afterRendering, window, [&statistics](){
+        const qint64 elapsed = statistics.renderTimer.nsecsElapsed();
+        statistics.frames.fetchAndAddRelaxed(1);
+        statistics.renderTime.fetchAndAddRelaxed(elapsed);
+        if (elapsed > statistics.longestRenderTime.loadRelaxed()) {
+            statistics.longestRenderTime.storeRelaxed(elapsed);
+        }
+    }, Qt::DirectConnection);
+
+    std::printf("%-6s %10s %18s %18s\n", "Tiles", "FPS", "Render mean (ms)", "Render max (ms)");
+    int run = 0;
+    QElapsedTimer runTimer = {};
+    std::function<void()> startRun = {};
+    startRun = [&](){
+        if (run >= int(std::size(kTileCounts))) {
+            wall->setProperty("sources", QVariant::fromValue(QList<QUrl>{}));
+            QCoreApplication::quit();
+            return;
+        }
+        const int tiles = kTileCounts[run];
+        QList<QUrl> sources = {};
+        for (int i = 0; i != tiles; ++i) {
+            sources.append(source);
+        }
+        wall->setProperty("sources", QVariant::fromValue(sources));
+        QTimer::singleShot(kWarmUp, window, [&, tiles](){
+            statistics.reset();
+            runTimer.start();
+            QTimer::singleShot(seconds * 1000, window, [&, tiles](){
+                const qreal elapsed = (qreal(runTimer.nsecsElapsed()) / 1000000000.0);
+                const qint64 frames = statistics.frames.loadRelaxed();
+                const qreal mean = ((frames > 0) ? (qreal(statistics.renderTime.loadRelaxed()) / frames / 1000000.0) : 0.0);
+                std::printf("%-6d %10.1f %18.2f %18.2f\n", tiles, (qreal(frames) / elapsed), mean,
+                            (qreal(statistics.longestRenderTime.loadRelaxed()) / 1000000.0));
+                std::fflush(stdout);
+                ++run;
+                startRun();
+            });
+        });
+    };
+    startRun();
+
+    return QCoreApplication::exec();
+}
@@ -0,0 +1,226 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Compares every SIMD kernel of YuvConverter with the scalar one, bit by bit,
+// and measures how long each kernel takes to convert a 1080p and a 4K frame.
+// Run with --verify to skip the measurements.
+
+#include <yuvconverter.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qrandom.h>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+QTMEDIAPLAYER_USE_NAMESPACE
+
+using PixelFormat = YuvConverter::PixelFormat;
+using OutputFormat = YuvConverter::OutputFormat;
+using ColorSpace = YuvConverter::ColorSpace;
+using Range = YuvConverter::Range;
+using Kernel = YuvConverter::Kernel;
+
+static constexpr const Kernel kKernels[] = {Kernel::Scalar, Kernel::SSE41, Kernel::AVX2, Kernel::NEON};
+static constexpr const PixelFormat kFormats[] = {PixelFormat::I420, PixelFormat::NV12, PixelFormat::P010};
+
+[[nodiscard]] static inline const char *kernelName(const Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::Auto:
+        return "Auto";
+    case Kernel::Scalar:
+        return "Scalar";
+    case Kernel::SSE41:
+        return "SSE4.1";
+    case Kernel::AVX2:
+        return "AVX2";
+    case Kernel::NEON:
+        return "NEON";
+    }
+    return "Unknown";
+}
+
+[[nodiscard]] static inline const char *formatName(const PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::I420:
+        return "I420";
+    case PixelFormat::NV12:
+        return "NV12";
+    case PixelFormat::P010:
+        return "P010";
+    }
+    return "Unknown";
+}
+
+// A frame filled with random samples. The rows are padded, so the kernels
+// have to respect the strides.
+class TestFrame
+{
+public:
+    explicit TestFrame(const PixelFormat format, const QSize &size)
+    {
+        const int bytesPerSample = ((format == PixelFormat::P010) ? 2 : 1);
+        const int chromaWidth = ((size.width() + 1) / 2);
+        const int chromaHeight = ((size.height() + 1) / 2);
+        static constexpr const int kPadding = 48;
+        const int planeCount = ((format == PixelFormat::I420) ? 3 : 2);
+        m_frame.format = format;
+        m_frame.size = size;
+        for (int i = 0; i != planeCount; ++i) {
+            const int samples = ((i == 0) ? size.width() : (chromaWidth * ((planeCount == 2) ? 2 : 1)));
+            const int rows = ((i == 0) ? size.height() : chromaHeight);
+            const int stride = ((samples * bytesPerSample) + kPadding);
+            m_planes[i].resize(((size_t(stride) * rows) + 3) / 4);
+            QRandomGenerator::global()->fillRange(m_planes[i].data(), qsizetype(m_planes[i].size()));
+            m_frame.planes[i] = reinterpret_cast<const uchar *>(m_planes[i].data());
+            m_frame.strides[i] = stride;
+        }
+    }
+
+    Q_NODISCARD const YuvConverter::Frame &frame() const
+    {
+        return m_frame;
+    }
+
+private:
+    YuvConverter::Frame m_frame = {};
+    std::vector<quint32> m_planes[3] = {};
+};
+
+[[nodiscard]] static inline std::vector<uchar> convert(const YuvConverter &converter, const TestFrame &frame)
+{
+    const QSize size = frame.frame().size;
+    std::vector<uchar> result(size_t(size.width()) * size.height() * 4, 0);
+    if (!converter.convert(frame.frame(), result.data(), size.width() * 4)) {
+        result.clear();
+    }
+    return result;
+}
+
+// Odd sizes leave a remainder for the scalar tail of the SIMD kernels.
+[[nodiscard]] static inline bool verify()
+{
+    static const QSize sizes[] = {{1, 1}, {15, 7}, {33, 17}, {641, 359}, {1920, 1080}};
+    static constexpr const ColorSpace colorSpaces[] = {ColorSpace::BT601, ColorSpace::BT709};
+    static constexpr const Range ranges[] = {Range::Limited, Range::Full};
+    static constexpr const OutputFormat outputFormats[] = {OutputFormat::RGBA, OutputFormat::BGRA};
+    bool result = true;
+    for (auto &&format : kFormats) {
+        for (auto &&size : sizes) {
+            const TestFrame frame(format, size);
+            for (auto &&colorSpace : colorSpaces) {
+                for (auto &&range : ranges) {
+                    for (auto &&outputFormat : outputFormats) {
+                        const std::vector<uchar> expected = convert(YuvConverter(colorSpace, range, outputFormat, Kernel::Scalar), frame);
+                        if (expected.empty()) {
+                            std::printf("FAIL: the scalar kernel rejected a %s frame.\n", formatName(format));
+                            result = false;
+                            continue;
+                        }
+                        for (auto &&kernel : kKernels) {
+                            if ((kernel == Kernel::Scalar) || !YuvConverter::isKernelSupported(kernel)) {
+                                continue;
+                            }
+                            const std::vector<uchar> actual = convert(YuvConverter(colorSpace, range, outputFormat, kernel), frame);
+                            if (actual == expected) {
+                                continue;
+                            }
+                            size_t offset = 0;
+                            while ((offset < actual.size()) && (actual.at(offset) == expected.at(offset))) {
+                                ++offset;
+                            }
+                            std::printf("FAIL: %s differs from Scalar for %s %dx%d (BT.%s, %s range, %s) at byte %zu.\n",
+                                        kernelName(kernel), formatName(format), size.width(), size.height(),
+                                        ((colorSpace == ColorSpace::BT709) ? "709" : "601"),
+                                        ((range == Range::Full) ? "full" : "limited"),
+                                        ((outputFormat == OutputFormat::BGRA) ? "BGRA" : "RGBA"), offset);
+                            result = false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (auto &&kernel : kKernels) {
+        if ((kernel != Kernel::Scalar) && YuvConverter::isKernelSupported(kernel)) {
+            std::printf("%s: %s\n", kernelName(kernel), (result ? "bit-exact" : "see above"));
+        }
+    }
+    return result;
+}
+
+static inline void measure()
+{
+    static const QSize sizes[] = {{1920, 1080}, {3840, 2160}};
+    static constexpr const int kIterations = 50;
+    std::printf("\n%-6s %-10s %-7s %10s %10s\n", "Format", "Size", "Kernel", "Best (ms)", "Mean (ms)");
+    for (auto &&format : kFormats) {
+        for (auto &&size : sizes) {
+            const TestFrame frame(format, size);
+            std::vector<uchar> destination(size_t(size.width()) * size.height() * 4, 0);
+            for (auto &&kernel : kKernels) {
+                if (!YuvConverter::isKernelSupported(kernel)) {
+                    continue;
+                }
+                const YuvConverter converter(ColorSpace::BT709, Range::Limited, OutputFormat::RGBA, kernel);
+                // Warm up the caches and the CPU clock.
+                converter.convert(frame.frame(), destination.data(), size.width() * 4);
+                qint64 best = std::numeric_limits<qint64>::max();
+                qint64 total = 0;
+                QElapsedTimer timer = {};
+                for (int i = 0; i != kIterations; ++i) {
+                    timer.start();
+                    converter.convert(frame.frame(), destination.data(), size.width() * 4);
+                    const qint64 elapsed = timer.nsecsElapsed();
+                    best = qMin(best, elapsed);
+                    total += elapsed;
+                }
+                char sizeText[32] = {};
+                std::snprintf(sizeText, sizeof(sizeText), "%dx%d", size.width(), size.height());
+                std::printf("%-6s %-10s %-7s %10.2f %10.2f\n", formatName(format), sizeText,
+                            kernelName(kernel), (qreal(best) / 1000000.0), (qreal(total) / kIterations / 1000000.0));
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool verifyOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--verify") == 0) {
+            verifyOnly = true;
+        }
+    }
+    std::printf("Best kernel on this CPU: %s\n", kernelName(YuvConverter::bestKernel()));
+    if (!verify()) {
+        return 1;
+    }
+    if (!verifyOnly) {
+        measure();
+    }
+    return 0;
+}
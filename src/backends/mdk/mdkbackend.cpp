@@ -23,8 +23,10 @@
  */
 
 #include <backendinterface.h>
+#include <videomirror.h>
 #include "include/mdk/global.h"
 #include "mdkplayer.h"
+#include "mdkvideowall.h"
 #include "mdkqthelper.h"
 #include <QtCore/qfileinfo.h>
 #include <QtQuick/qsgrendererinterface.h>
@@ -170,16 +172,21 @@ public:
         qRegisterMetaType<MediaStatus>();
         qRegisterMetaType<LogLevel>();
         qRegisterMetaType<FillMode>();
+        qRegisterMetaType<TrackType>();
         qRegisterMetaType<ChapterInfo>();
         qRegisterMetaType<Chapters>();
         qRegisterMetaType<MetaData>();
         qRegisterMetaType<MediaTracks>();
         qRegisterMetaType<MediaInfo>();
+        qRegisterMetaType<PresentationClock>();
         qRegisterMetaType<MDKPlayer>();
         qmlRegisterUncreatableMetaObject(staticMetaObject, QTMEDIAPLAYER_QML_URI, 1, 0, "QtMediaPlayer",
               QStringLiteral("QtMediaPlayer is not creatable, it's only used for accessing enums & flags."));
         qmlRegisterUncreatableType<MediaInfo>(QTMEDIAPLAYER_QML_URI, 1, 0, "MediaInfo", QStringLiteral("MediaInfo is not creatable."));
+        qmlRegisterUncreatableType<PresentationClock>(QTMEDIAPLAYER_QML_URI, 1, 0, "PresentationClock", QStringLiteral("PresentationClock is not creatable."));
         qmlRegisterType<MDKPlayer>(QTMEDIAPLAYER_QML_URI, 1, 0, "MediaPlayer");
+        qmlRegisterType<VideoMirror>(QTMEDIAPLAYER_QML_URI, 1, 0, "VideoMirror");
+        qmlRegisterType<MDKVideoWall>(QTMEDIAPLAYER_QML_URI, 1, 0, "VideoWall");
         qmlRegisterModule(QTMEDIAPLAYER_QML_URI, 1, 0);
         return true;
     }
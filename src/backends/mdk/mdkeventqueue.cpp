@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mdkeventqueue.h"
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// Only the latest value of these matters, several of them in a row are merged.
+[[nodiscard]] static inline bool isMergeable(const MDKEvent::Type type)
+{
+    return ((type == MDKEvent::Type::MediaStatusChanged) || (type == MDKEvent::Type::CurrentMediaChanged)
+            || (type == MDKEvent::Type::Resync));
+}
+
+MDKEventQueue::MDKEventQueue()
+{
+    for (int i = 0; i != kSlotCount; ++i) {
+        m_slots[i].sequence.storeRelaxed(static_cast<quint64>(i));
+    }
+}
+
+MDKEventQueue::~MDKEventQueue() = default;
+
+bool MDKEventQueue::push(const MDKEvent &event)
+{
+    m_pushedEvents.fetchAndAddRelaxed(1);
+    // Bounded multi-producer queue, the same scheme as the log sink uses.
+    Slot *slot = nullptr;
+    quint64 pos = m_enqueuePos.loadRelaxed();
+    while (true) {
+        slot = &m_slots[pos & (kSlotCount - 1)];
+        const quint64 sequence = slot->sequence.loadAcquire();
+        const qint64 diff = static_cast<qint64>(sequence) - static_cast<qint64>(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.testAndSetRelaxed(pos, pos + 1, pos)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full. The GUI thread is far behind, let it read the state from
+            // MDK instead of blocking MDK's threads.
+            m_overflow.storeRelease(1);
+            slot = nullptr;
+            break;
+        } else {
+            pos = m_enqueuePos.loadRelaxed();
+        }
+    }
+    if (slot) {
+        slot->event = event;
+        slot->sequence.storeRelease(pos + 1);
+    }
+    // Only one drain may be pending at any time.
+    return m_drainPending.testAndSetOrdered(0, 1);
+}
+
+void MDKEventQueue::take(MDKEventList &events)
+{
+    // Cleared before reading, so events pushed from now on wake us up again.
+    m_drainPending.fetchAndStoreOrdered(0);
+    const auto append = [this, &events](const MDKEvent &event){
+        if (!events.isEmpty()) {
+            MDKEvent &last = events.last();
+            if ((last.type == event.type) && (isMergeable(event.type) || (last.value == event.value))) {
+                last.value = event.value;
+                m_coalescedEvents.fetchAndAddRelaxed(1);
+                return;
+            }
+        }
+        events.append(event);
+    };
+    while (true) {
+        Slot &slot = m_slots[m_dequeuePos & (kSlotCount - 1)];
+        if (slot.sequence.loadAcquire() != (m_dequeuePos + 1)) {
+            break;
+        }
+        const MDKEvent event = slot.event;
+        slot.sequence.storeRelease(m_dequeuePos + kSlotCount);
+        ++m_dequeuePos;
+        append(event);
+    }
+    if (m_overflow.fetchAndStoreAcquire(0) != 0) {
+        append({});
+    }
+}
+
+quint64 MDKEventQueue::pushedEvents() const
+{
+    return m_pushedEvents.loadRelaxed();
+}
+
+quint64 MDKEventQueue::coalescedEvents() const
+{
+    return m_coalescedEvents.loadRelaxed();
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
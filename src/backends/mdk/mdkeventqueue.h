@@ -0,0 +1,96 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mdkbackend_global.h"
+#include <QtCore/qatomic.h>
+#include <QtCore/qvector.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// What MDK reported from one of its threads, handled later on the GUI thread.
+struct MDKEvent
+{
+    enum class Type : quint8
+    {
+        StateChanged,
+        MediaStatusChanged,
+        CurrentMediaChanged,
+        // Events have been dropped, the current state has to be read from MDK.
+        Resync
+    };
+
+    Type type = Type::Resync;
+    // The PlaybackState or the MediaStatus flags reported by MDK.
+    int value = 0;
+};
+
+using MDKEventList = QVector<MDKEvent>;
+
+// Carries the events of one player from MDK's threads to the GUI thread
+// without locks or allocations. MDK invokes its callbacks from more than one
+// thread, so any thread may push, but only the GUI thread may take.
+class MDKEventQueue
+{
+    Q_DISABLE_COPY_MOVE(MDKEventQueue)
+
+public:
+    explicit MDKEventQueue();
+    ~MDKEventQueue();
+
+    // Never blocks. Returns true if the consumer has to be woken up, which is
+    // only the case for the first event after the last take(). If the queue
+    // is full the event is dropped and the next take() asks for a resync.
+    Q_NODISCARD bool push(const MDKEvent &event);
+
+    // Appends everything that has been pushed so far to the list. Repeated
+    // status and media changes are merged into the latest one and states that
+    // equal the previous one are skipped.
+    void take(MDKEventList &events);
+
+    // Diagnostics: how many events have been pushed and how many of them
+    // were merged or skipped by take().
+    Q_NODISCARD quint64 pushedEvents() const;
+    Q_NODISCARD quint64 coalescedEvents() const;
+
+private:
+    static constexpr const int kSlotCount = 64; // Must be a power of two.
+
+    struct Slot
+    {
+        QAtomicInteger<quint64> sequence = 0;
+        MDKEvent event = {};
+    };
+
+    Slot m_slots[kSlotCount];
+    QAtomicInteger<quint64> m_enqueuePos = 0;
+    quint64 m_dequeuePos = 0;
+    QAtomicInt m_overflow = 0;
+    QAtomicInt m_drainPending = 0;
+    QAtomicInteger<quint64> m_pushedEvents = 0;
+    QAtomicInteger<quint64> m_coalescedEvents = 0;
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
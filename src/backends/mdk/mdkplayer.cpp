@@ -26,11 +26,17 @@
 #include "mdkbackend.h"
 #include "mdkvideotexturenode.h"
 #include "mdkqthelper.h"
+#include "mdkpositionticker.h"
 #include <backendinterface.h>
+#include <logsink.h>
 #include "include/mdk/Player.h"
+#include "include/mdk/VideoFrame.h"
+#include <cstring>
 #include <QtCore/qdebug.h>
 #include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
 #include <QtCore/qdatetime.h>
+#include <QtCore/qtimer.h>
 #include <QtQuick/qquickwindow.h>
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
@@ -58,6 +64,25 @@ QTMEDIAPLAYER_BEGIN_NAMESPACE
                                 : (display ? value.toDisplayString() : value.toString()));
 }
 
+[[nodiscard]] static inline TapFrame::PixelFormat tapPixelFormatFromMDK(const MDK_NS_PREPEND(PixelFormat) format)
+{
+    switch (format) {
+    case MDK_NS_PREPEND(PixelFormat)::YUV420P:
+        return TapFrame::PixelFormat::I420;
+    case MDK_NS_PREPEND(PixelFormat)::NV12:
+        return TapFrame::PixelFormat::NV12;
+    case MDK_NS_PREPEND(PixelFormat)::P010LE:
+        return TapFrame::PixelFormat::P010;
+    case MDK_NS_PREPEND(PixelFormat)::RGBA:
+        return TapFrame::PixelFormat::RGBA;
+    case MDK_NS_PREPEND(PixelFormat)::BGRA:
+        return TapFrame::PixelFormat::BGRA;
+    default:
+        break;
+    }
+    return TapFrame::PixelFormat::Unknown;
+}
+
 [[nodiscard]] static inline MediaStatus mediaStatusFromMDK(const MDK_NS_PREPEND(MediaStatus) ms)
 {
     MediaStatus result = {};
@@ -122,6 +147,9 @@ void MDKPlayer::initialize()
     }
 
     m_player->setRenderCallback([this](void *){
+        // Picked up by the texture node in its next sync().
+        m_videoFrameDirty.storeRelease(1);
+        m_positionFrameDirty.storeRelease(1);
         QMetaObject::invokeMethod(this, "update");
     });
 
@@ -135,19 +163,6 @@ void MDKPlayer::initialize()
 
     initMdkHandlers();
 
-    m_timer.setTimerType(Qt::CoarseTimer);
-    m_timer.setInterval(500);
-    connect(&m_timer, &QTimer::timeout, this, [this](){
-        if (isPlaying()) {
-            const qint64 currentPosition = position();
-            if (currentPosition != m_lastPosition) {
-                m_lastPosition = currentPosition;
-                Q_EMIT positionChanged();
-            }
-        }
-    });
-    m_timer.start();
-
     connect(this, &MDKPlayer::rendererReadyChanged, this, [this](){
         if (!m_rendererReady) {
             return;
@@ -155,17 +170,42 @@ void MDKPlayer::initialize()
         if (!m_cachedUrl.isValid()) {
             return;
         }
-        setSource(m_cachedUrl);
+        const QUrl url = m_cachedUrl;
+        const quint64 id = m_cachedRequestId;
         m_cachedUrl.clear();
+        m_cachedRequestId = 0;
+        startLoad(url, id);
     });
 }
 
 void MDKPlayer::deinitialize()
 {
+    {
+        const QMutexLocker locker(&m_frameTapMutex);
+        m_frameTaps.clear();
+    }
+    m_player->onFrame<MDK_NS_PREPEND(VideoFrame)>(nullptr);
+    if (m_positionTicking) {
+        MDKPositionTicker::instance()->unsubscribe(this);
+        m_positionTicking = false;
+    }
+    // Don't leave the worker reading a device the application may destroy next.
+    if (const QPointer<QThread> thread = m_extractionThread) {
+        cancelExtraction();
+        if (thread) {
+            thread->wait();
+        }
+    }
     if (!isStopped()) {
         stop();
     }
+    // The Stopped callback won't be handled anymore.
+    failPendingSeeks();
+    qDeleteAll(m_retiredExtractedFiles);
+    m_retiredExtractedFiles.clear();
     if (!m_livePreview) {
+        qCDebug(lcQMPMDK) << "MDK events:" << m_mdkEvents.pushedEvents() << "posted,"
+                          << m_mdkEvents.coalescedEvents() << "coalesced.";
         qCDebug(lcQMPMDK) << "Player destroyed.";
     }
 }
@@ -216,6 +256,8 @@ QString MDKPlayer::ffmpegConfiguration() const
 void MDKPlayer::invalidateSceneGraph() // Called on the render thread when the scenegraph is invalidated.
 {
     m_node = nullptr;
+    m_yuvNode = nullptr;
+    m_yuvNodeActive.storeRelease(0);
 }
 
 void MDKPlayer::setRendererReady(const bool value)
@@ -230,22 +272,277 @@ void MDKPlayer::setRendererReady(const bool value)
 void MDKPlayer::releaseResources() // Called on the gui thread if the item is removed from scene.
 {
     m_node = nullptr;
+    m_yuvNode = nullptr;
+    m_yuvNodeActive.storeRelease(0);
+}
+
+bool MDKPlayer::isTextureProvider() const
+{
+    return true;
+}
+
+QSGTextureProvider *MDKPlayer::textureProvider() const
+{
+    // Only valid on the render thread, like the node itself.
+    return m_node;
+}
+
+bool MDKPlayer::yuvRendering() const
+{
+    return m_yuvRendering;
+}
+
+void MDKPlayer::setYuvRendering(const bool value)
+{
+    if (m_yuvRendering == value) {
+        return;
+    }
+    m_yuvRendering = value;
+    updateFrameCallback();
+    update();
+    Q_EMIT yuvRenderingChanged();
+}
+
+int MDKPlayer::positionNotifyInterval() const
+{
+    return m_positionNotifyInterval;
+}
+
+void MDKPlayer::setPositionNotifyInterval(const int value)
+{
+    const int interval = qMax(value, 1);
+    if (m_positionNotifyInterval == interval) {
+        return;
+    }
+    m_positionNotifyInterval = interval;
+    if (m_positionTicking) {
+        MDKPositionTicker::instance()->updateInterval();
+    }
+    Q_EMIT positionNotifyIntervalChanged();
+}
+
+void MDKPlayer::updatePositionTicking()
+{
+    const bool ticking = isPlaying();
+    if (m_positionTicking == ticking) {
+        return;
+    }
+    m_positionTicking = ticking;
+    if (m_positionTicking) {
+        m_lastPositionNotify = MDKPositionTicker::instance()->now();
+        MDKPositionTicker::instance()->subscribe(this);
+    } else {
+        MDKPositionTicker::instance()->unsubscribe(this);
+        // Report where the playback has actually stopped.
+        updatePosition();
+    }
+}
+
+void MDKPlayer::notifyPosition(const qint64 timestamp)
+{
+    // The shared timer runs at the shortest interval of all players and a
+    // coarse timer may fire a bit early, so allow some slack.
+    if ((timestamp - m_lastPositionNotify) < ((m_positionNotifyInterval * 3) / 4)) {
+        return;
+    }
+    // Audio only media (or suspended video) has no frames to wait for.
+    if (hasVideo() && !videoSuspended() && !m_positionFrameDirty.fetchAndStoreAcquire(0)) {
+        return;
+    }
+    m_lastPositionNotify = timestamp;
+    updatePosition();
+}
+
+void MDKPlayer::updatePosition()
+{
+    const qint64 currentPosition = position();
+    if (currentPosition == m_lastPosition) {
+        return;
+    }
+    m_lastPosition = currentPosition;
+    Q_EMIT positionChanged();
+}
+
+bool MDKPlayer::addFrameTap(const QSharedPointer<FrameTap> &tap)
+{
+    Q_ASSERT(tap);
+    if (!tap) {
+        return false;
+    }
+    {
+        const QMutexLocker locker(&m_frameTapMutex);
+        if (m_frameTaps.contains(tap)) {
+            return true;
+        }
+        m_frameTaps.append(tap);
+    }
+    updateFrameCallback();
+    return true;
+}
+
+void MDKPlayer::removeFrameTap(const QSharedPointer<FrameTap> &tap)
+{
+    Q_ASSERT(tap);
+    if (!tap) {
+        return;
+    }
+    {
+        const QMutexLocker locker(&m_frameTapMutex);
+        if (!m_frameTaps.removeOne(tap)) {
+            return;
+        }
+    }
+    updateFrameCallback();
+}
+
+void MDKPlayer::updateFrameCallback()
+{
+    bool tapped = false;
+    {
+        const QMutexLocker locker(&m_frameTapMutex);
+        tapped = !m_frameTaps.isEmpty();
+    }
+    // MDK only keeps one frame callback, it serves both the YUV node and the taps.
+    if (m_yuvRendering || tapped) {
+        m_player->onFrame<MDK_NS_PREPEND(VideoFrame)>([this](MDK_NS_PREPEND(VideoFrame) &frame, int track){
+            Q_UNUSED(track);
+            storePlanarFrame(frame);
+            tapFrame(frame);
+            return 0;
+        });
+    } else {
+        m_player->onFrame<MDK_NS_PREPEND(VideoFrame)>(nullptr);
+    }
+}
+
+void MDKPlayer::tapFrame(MDK_NS_PREPEND(VideoFrame) &frame) // Called on MDK's video thread.
+{
+    QList<QSharedPointer<FrameTap>> taps = {};
+    {
+        const QMutexLocker locker(&m_frameTapMutex);
+        taps = m_frameTaps;
+    }
+    if (taps.isEmpty() || !frame.isValid()) {
+        return;
+    }
+    if ((frame.width() <= 0) || (frame.height() <= 0)) {
+        return;
+    }
+    TapFrame::PixelFormat format = tapPixelFormatFromMDK(frame.format());
+    const bool direct = (frame.bufferData(0) && (format != TapFrame::PixelFormat::Unknown));
+    // Hardware frames and the formats consumers don't know are converted by MDK.
+    MDK_NS_PREPEND(VideoFrame) converted = {};
+    if (!direct) {
+        converted = frame.to(MDK_NS_PREPEND(PixelFormat)::YUV420P);
+        format = TapFrame::PixelFormat::I420;
+    }
+    const MDK_NS_PREPEND(VideoFrame) &source = (direct ? frame : converted);
+    if (!source.bufferData(0)) {
+        return;
+    }
+    const auto result = QSharedPointer<TapFrame>::create();
+    result->format = format;
+    result->size = QSize(frame.width(), frame.height());
+    result->timestamp = frame.timestamp();
+    result->planeCount = qMin(source.planeCount(), 3);
+    for (int i = 0; i != result->planeCount; ++i) {
+        const int stride = source.bytesPerLine(i);
+        const int rows = source.height(i);
+        const uint8_t * const data = source.bufferData(i);
+        if (!data || (stride <= 0) || (rows <= 0)) {
+            return;
+        }
+        // MDK's buffer can't be kept beyond this callback, so it's copied
+        // once here and shared by all taps.
+        result->planes[i] = QByteArray(reinterpret_cast<const char *>(data), stride * rows);
+        result->strides[i] = stride;
+    }
+    for (auto &&tap : qAsConst(taps)) {
+        tap->push(result);
+    }
+}
+
+void MDKPlayer::storePlanarFrame(MDK_NS_PREPEND(VideoFrame) &frame) // Called on MDK's video thread.
+{
+    if (!frame.isValid() || !m_yuvNodeActive.loadAcquire()) {
+        return;
+    }
+    const int width = frame.width();
+    const int height = frame.height();
+    if ((width <= 0) || (height <= 0)) {
+        return;
+    }
+    const MDK_NS_PREPEND(PixelFormat) format = frame.format();
+    const bool direct = (frame.bufferData(0) && ((format == MDK_NS_PREPEND(PixelFormat)::YUV420P)
+                                                 || (format == MDK_NS_PREPEND(PixelFormat)::NV12)));
+    // Hardware frames and all the other formats are downloaded and converted
+    // by MDK. Don't call to() otherwise: it returns the frame itself then.
+    MDK_NS_PREPEND(VideoFrame) converted = {};
+    if (!direct) {
+        converted = frame.to(MDK_NS_PREPEND(PixelFormat)::YUV420P);
+    }
+    const MDK_NS_PREPEND(VideoFrame) &source = (direct ? frame : converted);
+    if (!source.bufferData(0)) {
+        return;
+    }
+    MDKPlanarFrame &planar = m_planarWriteFrame;
+    planar.size = QSize(width, height);
+    planar.chromaSize = QSize((width + 1) / 2, (height + 1) / 2);
+    planar.nv12 = (direct && (format == MDK_NS_PREPEND(PixelFormat)::NV12));
+    planar.planeCount = (planar.nv12 ? 2 : 3);
+    for (int i = 0; i != planar.planeCount; ++i) {
+        const int rowBytes = ((i == 0) ? width : (planar.chromaSize.width() * (planar.nv12 ? 2 : 1)));
+        const int rows = ((i == 0) ? height : planar.chromaSize.height());
+        const int stride = source.bytesPerLine(i);
+        const uint8_t * const data = source.bufferData(i);
+        if (!data || (stride < rowBytes)) {
+            return;
+        }
+        // The textures are uploaded with an unpack alignment of 1, so the
+        // rows are packed tightly.
+        planar.planes[i].resize(rowBytes * rows);
+        char * const target = planar.planes[i].data();
+        for (int row = 0; row != rows; ++row) {
+            std::memcpy(target + (row * rowBytes), data + (row * stride), rowBytes);
+        }
+    }
+    {
+        QMutexLocker locker(&m_planarFrameMutex);
+        std::swap(m_planarFrame, m_planarWriteFrame);
+        m_planarFrameFresh = true;
+    }
 }
 
 QSGNode *MDKPlayer::updatePaintNode(QSGNode *node, UpdatePaintNodeData *data)
 {
     Q_UNUSED(data);
-    auto n = static_cast<MDKVideoTextureNode *>(node);
-    if (!n && ((width() <= 0) || (height() <= 0))) {
+    if (!node && ((width() <= 0) || (height() <= 0))) {
         return nullptr;
     }
-    if (!n) {
+    const bool yuv = (m_yuvRendering && MDKYuvVideoNode::isSupported(window()));
+    if (node && (yuv != (m_yuvNode != nullptr))) {
+        // The rendering path has changed, start over with the other node.
+        delete node;
+        node = nullptr;
+        m_node = nullptr;
+        m_yuvNode = nullptr;
+        m_videoFrameDirty.storeRelease(1);
+    }
+    m_yuvNodeActive.storeRelease(yuv ? 1 : 0);
+    if (yuv) {
+        if (!m_yuvNode) {
+            m_yuvNode = new MDKYuvVideoNode(this);
+        }
+        m_yuvNode->sync();
+        window()->update(); // Ensure getting to beforeRendering() at some point.
+        return m_yuvNode;
+    }
+    if (!m_node) {
         m_node = createNode(this);
-        n = m_node;
     }
     m_node->sync();
     window()->update(); // Ensure getting to beforeRendering() at some point.
-    return n;
+    return m_node;
 }
 
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
@@ -275,49 +572,273 @@ QUrl MDKPlayer::source() const
 
 void MDKPlayer::setSource(const QUrl &value)
 {
+    startLoad(value, 0);
+}
+
+quint64 MDKPlayer::loadAsync(const QUrl &url)
+{
+    const quint64 id = createRequestId();
+    startLoad(url, id);
+    return id;
+}
+
+bool MDKPlayer::isSourceSupported(const QUrl &value) const
+{
+    // Copied from a device by setSourceDevice(), it may not have a meaningful name.
+    if (m_extractedFile && (value == QUrl::fromLocalFile(m_extractedFile->fileName()))) {
+        return true;
+    }
+    if (!value.isValid()) {
+        qCWarning(lcQMPMDK) << "The given URL" << value << "is invalid.";
+        return false;
+    }
+    if ((QString::compare(value.scheme(), QStringLiteral("qrc"), Qt::CaseInsensitive) == 0)
+        && !QFile::exists(QStringLiteral(":") + value.path())) {
+        qCWarning(lcQMPMDK) << "The embeded resource" << value << "doesn't exist.";
+        return false;
+    }
+    const QString filename = value.fileName();
+    if (filename.isEmpty()) {
+        qCWarning(lcQMPMDK) << "The source url" << value << "doesn't contain a filename.";
+        return false;
+    }
+    if (!isMediaFile(filename)) {
+        qCWarning(lcQMPMDK) << "The source url" << value << "doesn't seem to be a multimedia file.";
+        return false;
+    }
+    return true;
+}
+
+void MDKPlayer::startLoad(const QUrl &value, const quint64 id)
+{
+    // A copy still being made for an earlier source isn't needed anymore.
+    cancelExtraction();
     if (!m_rendererReady) {
+        // Only the latest source matters, a previously deferred one is dropped.
+        finishRequest(m_cachedRequestId, false);
         m_cachedUrl = value;
+        m_cachedRequestId = id;
         return;
     }
-    const auto realStop = [this]() -> void {
+    if (value.isEmpty()) {
+        qCDebug(lcQMPMDK) << "Empty source is set, playback stopped.";
+        finishRequest(m_pendingLoadId, false);
+        m_pendingLoadUrl.clear();
+        m_pendingLoadId = 0;
         m_player->setMedia(nullptr);
         m_player->setNextMedia(nullptr);
         m_player->set(MDK_NS_PREPEND(PlaybackState)::Stopped);
-        m_player->waitFor(MDK_NS_PREPEND(PlaybackState)::Stopped);
-    };
-    if (value.isEmpty()) {
-        qCDebug(lcQMPMDK) << "Empty source is set, playback stopped.";
-        realStop();
+        finishRequest(id, true);
         return;
     }
-    if (!value.isValid()) {
-        qCWarning(lcQMPMDK) << "The given URL" << value << "is invalid.";
+    if (!isSourceSupported(value)) {
+        finishRequest(id, false);
         return;
     }
-    if (QString::compare(value.scheme(), QStringLiteral("qrc"), Qt::CaseInsensitive) == 0) {
-        qCWarning(lcQMPMDK) << "Currently embeded resource is not supported.";
+    const bool resource = (QString::compare(value.scheme(), QStringLiteral("qrc"), Qt::CaseInsensitive) == 0);
+    // Loading the same resource again doesn't need another copy.
+    if (resource && !(m_extractedFile && (m_extractedSource == value))) {
+        startExtraction(nullptr, value, value.fileName(), id);
         return;
     }
-    const QString filename = value.fileName();
-    if (filename.isEmpty()) {
-        qCWarning(lcQMPMDK) << "The source url" << value << "doesn't contain a filename.";
+    const QUrl url = (resource ? QUrl::fromLocalFile(m_extractedFile->fileName()) : value);
+    if (url == source()) {
+        if (isStopped() && !m_livePreview) {
+            m_player->set(MDK_NS_PREPEND(PlaybackState)::Playing);
+        }
+        finishRequest(id, true, url);
         return;
     }
-    if (!isMediaFile(filename)) {
-        qCWarning(lcQMPMDK) << "The source url" << value << "doesn't seem to be a multimedia file.";
+    if (!isStopped() || m_pendingLoadUrl.isValid()) {
+        // Don't block the GUI thread until MDK has stopped the current media,
+        // the new one will be opened from the state change callback instead.
+        finishRequest(m_pendingLoadId, false);
+        m_pendingLoadUrl = url;
+        m_pendingLoadId = id;
+        if (!isStopped()) {
+            m_player->setMedia(nullptr);
+            m_player->setNextMedia(nullptr);
+            m_player->set(MDK_NS_PREPEND(PlaybackState)::Stopped);
+        }
         return;
     }
-    if (value == source()) {
-        if (isStopped() && !m_livePreview) {
-            m_player->set(MDK_NS_PREPEND(PlaybackState)::Playing);
+    openMedia(url, id);
+}
+
+void MDKPlayer::startExtraction(QIODevice *device, const QUrl &resource, const QString &name, const quint64 id)
+{
+    Q_ASSERT(device || resource.isValid());
+    cancelExtraction();
+    // Keep the suffix, FFmpeg uses it for the format detection.
+    const QString fileTemplate = QDir::tempPath() + QStringLiteral("/qtmediaplayer_XXXXXX_")
+                                 + (name.isEmpty() ? QStringLiteral("stream") : name);
+    const auto extraction = QSharedPointer<Extraction>::create();
+    extraction->file.reset(new QTemporaryFile(fileTemplate));
+    if (!extraction->file->open()) {
+        qCWarning(lcQMPMDK) << "Failed to create a temporary file:" << extraction->file->errorString();
+        finishRequest(id, false);
+        return;
+    }
+    // The temporary file object stays on this thread, the worker writes
+    // through its own handle.
+    const QString fileName = extraction->file->fileName();
+    extraction->file->close();
+    extraction->resource = resource;
+    // Large resources and devices take a while to copy, don't block the GUI
+    // thread meanwhile.
+    QThread * const thread = QThread::create([extraction, device, fileName](){
+        QFile resourceFile;
+        QIODevice *source = device;
+        if (!source) {
+            resourceFile.setFileName(QStringLiteral(":") + extraction->resource.path());
+            if (!resourceFile.open(QFile::ReadOnly)) {
+                qCWarning(lcQMPMDK) << "Failed to open the embeded resource" << extraction->resource;
+                return;
+            }
+            source = &resourceFile;
+        }
+        QFile target(fileName);
+        if (!target.open(QFile::WriteOnly | QFile::Truncate)) {
+            qCWarning(lcQMPMDK) << "Failed to open the temporary file:" << target.errorString();
+            return;
+        }
+        static constexpr const qint64 kChunkSize = 1024 * 1024;
+        QByteArray buffer(kChunkSize, Qt::Uninitialized);
+        while (!extraction->canceled.loadRelaxed()) {
+            const qint64 length = source->read(buffer.data(), kChunkSize);
+            if (length <= 0) {
+                break;
+            }
+            if (target.write(buffer.constData(), length) != length) {
+                qCWarning(lcQMPMDK) << "Failed to write the temporary file:" << target.errorString();
+                return;
+            }
+        }
+        extraction->succeeded = (!extraction->canceled.loadRelaxed() && target.flush());
+    });
+    connect(thread, &QThread::finished, this, [this, extraction, id](){
+        finishExtraction(extraction, id);
+    });
+    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+    m_extraction = extraction;
+    m_extractionThread = thread;
+    m_extractionId = id;
+    thread->start(QThread::LowPriority);
+}
+
+void MDKPlayer::finishExtraction(const QSharedPointer<Extraction> &extraction, const quint64 id)
+{
+    // Canceled, the request has been answered already.
+    if (extraction != m_extraction) {
+        return;
+    }
+    m_extraction.reset();
+    m_extractionThread.clear();
+    m_extractionId = 0;
+    if (!extraction->succeeded) {
+        finishRequest(id, false);
+        return;
+    }
+    retireExtractedFile();
+    m_extractedFile.reset(extraction->file.take());
+    m_extractedSource = extraction->resource;
+    startLoad(QUrl::fromLocalFile(m_extractedFile->fileName()), id);
+}
+
+void MDKPlayer::cancelExtraction()
+{
+    if (!m_extraction) {
+        return;
+    }
+    // The worker stops at the next chunk, the partial copy is removed with
+    // the extraction once the thread has finished.
+    m_extraction->canceled.storeRelaxed(1);
+    m_extraction.reset();
+    m_extractionThread.clear();
+    finishRequest(m_extractionId, false);
+    m_extractionId = 0;
+}
+
+void MDKPlayer::retireExtractedFile()
+{
+    if (!m_extractedFile) {
+        return;
+    }
+    // Stopping is asynchronous, MDK may still be reading the previous copy.
+    // It can't be removed before MDK has closed it, not on Windows at least.
+    m_retiredExtractedFiles.append(m_extractedFile.take());
+    m_extractedSource.clear();
+    releaseRetiredFiles();
+}
+
+void MDKPlayer::releaseRetiredFiles()
+{
+    const QUrl url = source();
+    for (auto it = m_retiredExtractedFiles.begin(); it != m_retiredExtractedFiles.end();) {
+        QTemporaryFile * const file = *it;
+        if (url.isValid() && (url == QUrl::fromLocalFile(file->fileName()))) {
+            ++it;
+            continue;
         }
+        delete file;
+        it = m_retiredExtractedFiles.erase(it);
+    }
+}
+
+void MDKPlayer::setSourceDevice(QIODevice *device, const QString &name)
+{
+    Q_ASSERT(device);
+    if (!device) {
+        return;
+    }
+    if (!device->isOpen() || !device->isReadable()) {
+        qCWarning(lcQMPMDK) << "The source device must be opened for reading.";
         return;
     }
-    realStop();
+    // The copy would only get what happens to be buffered at the moment.
+    if (device->isSequential()) {
+        qCWarning(lcQMPMDK) << "Sequential source devices are not supported.";
+        return;
+    }
+    // A plain file on disk can be opened by MDK directly.
+    if (const auto file = qobject_cast<QFile *>(device)) {
+        const QString fileName = file->fileName();
+        if (!fileName.isEmpty() && !fileName.startsWith(u':')) {
+            setSource(QUrl::fromLocalFile(fileName));
+            return;
+        }
+    }
+    startExtraction(device, {}, name, 0);
+}
+
+void MDKPlayer::startPendingLoad()
+{
+    if (!m_pendingLoadUrl.isValid()) {
+        return;
+    }
+    const QUrl url = m_pendingLoadUrl;
+    const quint64 id = m_pendingLoadId;
+    m_pendingLoadUrl.clear();
+    m_pendingLoadId = 0;
+    openMedia(url, id);
+}
+
+void MDKPlayer::openMedia(const QUrl &value, const quint64 id)
+{
+    // Seeks in the previous media are over, whatever MDK reports for them.
+    failPendingSeeks();
+    clearMediaInfoSnapshot();
     m_player->setMedia(qUtf8Printable(urlToString(value)));
     Q_EMIT sourceChanged();
     // It's necessary to call "prepare()", otherwise we'll get no picture.
-    m_player->prepare();
+    m_player->prepare(0, [this, id, value](int64_t position, bool *boost) -> bool {
+        Q_UNUSED(boost);
+        // A negative position means the media failed to open.
+        finishRequest(id, (position >= 0), ((position >= 0) ? QVariant(value) : QVariant{}));
+        // The previous media has been closed by now, even without a Stopped state.
+        QMetaObject::invokeMethod(this, &MDKPlayer::releaseRetiredFiles, Qt::QueuedConnection);
+        return true;
+    });
     if (m_autoStart && !m_livePreview) {
         m_player->set(MDK_NS_PREPEND(PlaybackState)::Playing);
     }
@@ -347,25 +868,14 @@ void MDKPlayer::setPosition(const qint64 value)
 
 qint64 MDKPlayer::duration() const
 {
-    if (!isLoaded()) {
-        return 0;
-    }
-    const auto &mi = m_player->mediaInfo();
-    return mi.duration;
+    const auto info = mediaInfoSnapshot();
+    return (info ? info->duration : 0);
 }
 
 QSizeF MDKPlayer::videoSize() const
 {
-    if (!isLoaded()) {
-        return {};
-    }
-    const auto &mi = m_player->mediaInfo();
-    const auto &vs = mi.video;
-    if (vs.empty()) {
-        return {};
-    }
-    const auto &vsf = vs.at(0);
-    return {static_cast<qreal>(vsf.codec.width), static_cast<qreal>(vsf.codec.height)};
+    const auto info = mediaInfoSnapshot();
+    return (info ? info->videoSize : QSizeF{});
 }
 
 qreal MDKPlayer::volume() const
@@ -584,18 +1094,18 @@ void MDKPlayer::setSnapshotFormat(const QString &value)
 
 QString MDKPlayer::snapshotTemplate() const
 {
-    return m_snapshotTemplate;
+    return m_snapshotTemplate.pattern();
 }
 
 void MDKPlayer::setSnapshotTemplate(const QString &value)
 {
-    if (value.isEmpty() || (value == m_snapshotTemplate)) {
+    if (value.isEmpty() || (value == m_snapshotTemplate.pattern())) {
         return;
     }
-    m_snapshotTemplate = value;
+    m_snapshotTemplate = SnapshotTemplate(value);
     Q_EMIT snapshotTemplateChanged();
     if (!m_livePreview) {
-        qCDebug(lcQMPMDK) << "Snapshot template -->" << m_snapshotTemplate;
+        qCDebug(lcQMPMDK) << "Snapshot template -->" << value;
     }
 }
 
@@ -736,87 +1246,20 @@ void MDKPlayer::setFillMode(const FillMode value)
 
 Chapters MDKPlayer::chapters() const
 {
-    if (!isLoaded()) {
-        return {};
-    }
-    const auto &mi = m_player->mediaInfo();
-    const auto &cpts = mi.chapters;
-    if (cpts.empty()) {
-        return {};
-    }
-    Chapters result = {};
-    for (auto &&chapter : qAsConst(cpts)) {
-        ChapterInfo info = {};
-        info.title = QString::fromStdString(chapter.title);
-        info.startTime = chapter.start_time;
-        info.endTime = chapter.end_time;
-        result.append(info);
-    }
-    return result;
+    const auto info = mediaInfoSnapshot();
+    return (info ? info->chapters : Chapters{});
 }
 
 MetaData MDKPlayer::metaData() const
 {
-    if (!isLoaded()) {
-        return {};
-    }
-    const auto &mi = m_player->mediaInfo();
-    const auto &md = mi.metadata;
-    if (md.empty()) {
-        return {};
-    }
-    MetaData result = {};
-    for (auto &&data : qAsConst(md)) {
-        result.insert(QString::fromStdString(data.first), QString::fromStdString(data.second));
-    }
-    return result;
+    const auto info = mediaInfoSnapshot();
+    return (info ? info->metaData : MetaData{});
 }
 
 MediaTracks MDKPlayer::mediaTracks() const
 {
-    if (!isLoaded()) {
-        return {};
-    }
-    const auto &mi = m_player->mediaInfo();
-    const auto &vs = mi.video;
-    const auto &as = mi.audio;
-    MediaTracks result = {};
-    if (!vs.empty()) {
-        for (auto &&vsi : qAsConst(vs)) {
-            QVariantHash info = {};
-            info.insert(QStringLiteral("index"), vsi.index);
-            info.insert(QStringLiteral("start_time"), qint64(vsi.start_time));
-            info.insert(QStringLiteral("duration"), qint64(vsi.duration));
-            info.insert(QStringLiteral("frames"), qint64(vsi.frames));
-            info.insert(QStringLiteral("rotation"), vsi.rotation);
-            info.insert(QStringLiteral("width"), vsi.codec.width);
-            info.insert(QStringLiteral("height"), vsi.codec.height);
-            info.insert(QStringLiteral("frame_rate"), vsi.codec.frame_rate);
-            info.insert(QStringLiteral("bit_rate"), qint64(vsi.codec.bit_rate));
-            info.insert(QStringLiteral("codec"), QString::fromUtf8(vsi.codec.codec));
-            info.insert(QStringLiteral("format_name"), QString::fromUtf8(vsi.codec.format_name));
-            // What about metadata?
-            result.video.append(info);
-        }
-    }
-    if (!as.empty()) {
-        for (auto &&asi : qAsConst(as)) {
-            QVariantHash info = {};
-            info.insert(QStringLiteral("index"), asi.index);
-            info.insert(QStringLiteral("start_time"), qint64(asi.start_time));
-            info.insert(QStringLiteral("duration"), qint64(asi.duration));
-            info.insert(QStringLiteral("frames"), qint64(asi.frames));
-            info.insert(QStringLiteral("bit_rate"), qint64(asi.codec.bit_rate));
-            info.insert(QStringLiteral("frame_rate"), asi.codec.frame_rate);
-            info.insert(QStringLiteral("codec"), QString::fromUtf8(asi.codec.codec));
-            info.insert(QStringLiteral("channels"), asi.codec.channels);
-            info.insert(QStringLiteral("sample_rate"), asi.codec.sample_rate);
-            // What about metadata?
-            result.audio.append(info);
-        }
-    }
-    // TODO: subtitles
-    return result;
+    const auto info = mediaInfoSnapshot();
+    return (info ? info->mediaTracks : MediaTracks{});
 }
 
 int MDKPlayer::activeVideoTrack() const
@@ -847,7 +1290,10 @@ void MDKPlayer::setActiveVideoTrack(const int value)
     if (m_activeVideoTrack == track) {
         return;
     }
-    m_player->setActiveTracks(MDK_NS_PREPEND(MediaType)::Video, {track});
+    // A suspended video picks up the new track when it resumes.
+    if (!videoSuspended()) {
+        m_player->setActiveTracks(MDK_NS_PREPEND(MediaType)::Video, {track});
+    }
     m_activeVideoTrack = track;
     Q_EMIT activeVideoTrackChanged();
 }
@@ -951,22 +1397,72 @@ void MDKPlayer::stop()
 
 void MDKPlayer::seek(const qint64 value)
 {
-    if (!isLoaded() || (value == position())) {
+    doSeek(value, 0);
+}
+
+quint64 MDKPlayer::seekAsync(const qint64 value)
+{
+    const quint64 id = createRequestId();
+    doSeek(value, id);
+    return id;
+}
+
+void MDKPlayer::applyVideoSuspension(const bool suspend)
+{
+    if (suspend) {
+        // Without an active video track nothing is decoded and the render
+        // callback stays quiet. Audio and the clock are not affected.
+        m_player->setActiveTracks(MDK_NS_PREPEND(MediaType)::Video, {});
+        if (!m_livePreview) {
+            qCDebug(lcQMPMDK) << "Video suspended.";
+        }
         return;
     }
-    const auto &mi = m_player->mediaInfo();
-    if (value < mi.start_time) {
-        qCWarning(lcQMPMDK) << "Media start time is" << mi.start_time
+    m_player->setActiveTracks(MDK_NS_PREPEND(MediaType)::Video, {m_activeVideoTrack});
+    if (isLoaded()) {
+        // A key frame seek brings the picture back quickly. Nobody waits for
+        // it, so it's queued without an id.
+        queueSeek(m_player->position(), MDK_NS_PREPEND(SeekFlag)::Default, 0);
+    }
+    if (!m_livePreview) {
+        qCDebug(lcQMPMDK) << "Video resumed.";
+    }
+}
+
+void MDKPlayer::doSeek(const qint64 value, const quint64 id)
+{
+    if (!isLoaded()) {
+        finishRequest(id, false);
+        return;
+    }
+    if (value == position()) {
+        finishRequest(id, true, value);
+        return;
+    }
+    const auto info = mediaInfoSnapshot();
+    Q_ASSERT(info);
+    if (!info) {
+        finishRequest(id, false);
+        return;
+    }
+    if (value < info->startTime) {
+        qCWarning(lcQMPMDK) << "Media start time is" << info->startTime
                             << ", however, the user is trying to seek to" << value;
+        finishRequest(id, false);
         return;
     }
-    if (value > mi.duration) {
-        qCWarning(lcQMPMDK) << "Media duration is" << mi.duration
+    if (value > info->duration) {
+        qCWarning(lcQMPMDK) << "Media duration is" << info->duration
                             << ", however, the user is trying to seek to" << value;
+        finishRequest(id, false);
         return;
     }
     // We have to seek accurately when we are in live preview mode.
-    m_player->seek(value, m_livePreview ? MDK_NS_PREPEND(SeekFlag)::FromStart : MDK_NS_PREPEND(SeekFlag)::Default);
+    if (!queueSeek(value, m_livePreview ? MDK_NS_PREPEND(SeekFlag)::FromStart
+                                        : MDK_NS_PREPEND(SeekFlag)::Default, id)) {
+        finishRequest(id, false);
+        return;
+    }
     // In case the playback is paused.
     Q_EMIT positionChanged();
     if (!m_livePreview) {
@@ -974,53 +1470,163 @@ void MDKPlayer::seek(const qint64 value)
     }
 }
 
+bool MDKPlayer::queueSeek(const qint64 value, const MDK_NS_PREPEND(SeekFlag) flags, const quint64 id)
+{
+    // MDK stores only the callback of the latest seek and invokes it whenever
+    // any seek finishes, in the order they were issued. So every seek, even
+    // the ones nobody waits for, uses the same callback, which completes the
+    // oldest queued id. The generation keeps results that arrive after the
+    // queue has been dropped away from the seeks queued later.
+    m_pendingSeeks.append(id);
+    const quint64 generation = m_seekGeneration;
+    const auto callback = [this, generation](int64_t ret) {
+        QMetaObject::invokeMethod(this, [this, generation, ret](){
+            if ((generation != m_seekGeneration) || m_pendingSeeks.isEmpty()) {
+                return;
+            }
+            const quint64 seekId = m_pendingSeeks.takeFirst();
+            finishRequest(seekId, (ret >= 0), ((ret >= 0) ? QVariant(static_cast<qint64>(ret)) : QVariant{}));
+        }, Qt::QueuedConnection);
+    };
+    if (!m_player->seek(value, flags, callback)) {
+        m_pendingSeeks.removeLast();
+        return false;
+    }
+    return true;
+}
+
+void MDKPlayer::failPendingSeeks()
+{
+    ++m_seekGeneration;
+    QList<quint64> seeks = {};
+    seeks.swap(m_pendingSeeks);
+    for (auto &&id : qAsConst(seeks)) {
+        finishRequest(id, false);
+    }
+}
+
 void MDKPlayer::snapshot()
 {
     if (!isLoaded()) {
         return;
     }
+    // Everything except the frame time is known now, there's no need to
+    // query the player again once the frame has arrived.
+    FrameGrab grab = {};
+    grab.context.fileName = QFileInfo(filePath()).completeBaseName();
+    grab.context.dateTime = QDateTime::currentDateTime();
+    grab.context.position = position();
+    grab.context.duration = duration();
+    grab.context.metaData = metaData();
+    requestFrameGrab(grab);
+}
+
+quint64 MDKPlayer::grabFrame(const QSize &size)
+{
+    const quint64 id = createRequestId();
+    if (!isLoaded()) {
+        finishRequest(id, false);
+        return id;
+    }
+    FrameGrab grab = {};
+    grab.id = id;
+    grab.size = size;
+    requestFrameGrab(grab);
+    return id;
+}
+
+void MDKPlayer::requestFrameGrab(const FrameGrab &grab)
+{
+    m_pendingFrameGrabs.append(grab);
+    if (m_frameGrabInFlight) {
+        return;
+    }
+    // MDK takes the snapshot while rendering the video, which it doesn't do
+    // while the YUV node draws the frames or the video is suspended. The
+    // request would never be answered.
+    if (m_yuvNodeActive.loadAcquire() || videoSuspended()) {
+        qCWarning(lcQMPMDK) << "Can't take a snapshot while MDK doesn't render the video.";
+        finishFrameGrabs({}, 0.0);
+        return;
+    }
+    m_frameGrabInFlight = true;
+    const quint64 serial = m_frameGrabSerial;
+    // No size: the frame is captured as decoded, without the renderer's transforms.
     MDK_NS_PREPEND(Player)::SnapshotRequest snapshotRequest = {};
-    m_player->snapshot(&snapshotRequest, [this](MDK_NS_PREPEND(Player)::SnapshotRequest *ret, qreal frameTime) {
-        Q_UNUSED(ret);
-        QString path = m_snapshotTemplate;
-        const QString completeBaseName = QFileInfo(filePath()).completeBaseName();
-        if (path.isEmpty()) {
-            path = completeBaseName;
-        } else {
-            path.replace(QStringLiteral("${filename}"), completeBaseName, Qt::CaseInsensitive);
-            const QDateTime currentDateTime = QDateTime::currentDateTime();
-            path.replace(QStringLiteral("${date}"), currentDateTime.toString(QStringLiteral("yyyy.MM.dd")), Qt::CaseInsensitive);
-            path.replace(QStringLiteral("${time}"), currentDateTime.toString(QStringLiteral("hh.mm.ss.zzz")), Qt::CaseInsensitive);
-            path.replace(QStringLiteral("${datetime}"), currentDateTime.toString(QStringLiteral("yyyy.MM.dd.hh.mm.ss.zzz")), Qt::CaseInsensitive);
-            path.replace(QStringLiteral("${frametime}"), QString::number(frameTime), Qt::CaseInsensitive);
-            path.replace(QStringLiteral("${position}"), QString::number(position()), Qt::CaseInsensitive);
-            path.replace(QStringLiteral("${duration}"), QString::number(duration()), Qt::CaseInsensitive);
-            const auto &md = metaData();
-            path.replace(QStringLiteral("${title}"), md.value(QStringLiteral("title")).toString(), Qt::CaseInsensitive);
-            path.replace(QStringLiteral("${author}"), md.value(QStringLiteral("author")).toString(), Qt::CaseInsensitive);
-            path.replace(QStringLiteral("${artist}"), md.value(QStringLiteral("artist")).toString(), Qt::CaseInsensitive);
-            path.replace(QStringLiteral("${album}"), md.value(QStringLiteral("album")).toString(), Qt::CaseInsensitive);
+    m_player->snapshot(&snapshotRequest, [this, serial](MDK_NS_PREPEND(Player)::SnapshotRequest *ret, double frameTime) {
+        // Called on a dedicated MDK thread, the data is only valid until we return.
+        QImage image = {};
+        if (ret && ret->data) {
+            image = QImage(ret->data, ret->width, ret->height, ret->stride, QImage::Format_ARGB32).copy();
         }
-        path.append(u'.');
-        if (m_snapshotFormat.isEmpty()) {
-            path.append(QStringLiteral("png"));
-        } else {
-            path.append(m_snapshotFormat);
+        QMetaObject::invokeMethod(this, [this, serial, image, frameTime](){
+            // Too late, the request has timed out or the media was stopped.
+            if (serial != m_frameGrabSerial) {
+                return;
+            }
+            finishFrameGrabs(image, frameTime);
+        }, Qt::QueuedConnection);
+        // Don't let MDK write a file, the image is encoded on the thread pool if needed.
+        return std::string{};
+    });
+    // Nothing may be rendered for a while, e.g. when the window is hidden.
+    static constexpr const int kFrameGrabTimeout = 5000;
+    QTimer::singleShot(kFrameGrabTimeout, this, [this, serial](){
+        if (serial != m_frameGrabSerial) {
+            return;
         }
-        const QString dirPath = QDir::toNativeSeparators(m_snapshotDirectory.toLocalFile());
-        if (!dirPath.endsWith(u'/') && !dirPath.endsWith(u'\\')) {
-            path.prepend(QDir::separator());
+        qCWarning(lcQMPMDK) << "Timed out waiting for the snapshot.";
+        finishFrameGrabs({}, 0.0);
+    });
+    // The snapshot is taken by the renderer.
+    update();
+}
+
+void MDKPlayer::finishFrameGrabs(const QImage &image, const qreal frameTime)
+{
+    m_frameGrabInFlight = false;
+    // Whatever is still on its way for the finished request is ignored.
+    ++m_frameGrabSerial;
+    QList<FrameGrab> grabs = {};
+    grabs.swap(m_pendingFrameGrabs);
+    for (auto &&grab : qAsConst(grabs)) {
+        if (grab.id != 0) {
+            finishFrameGrab(grab.id, image, grab.size);
+            continue;
         }
-        if (m_snapshotDirectory.isEmpty()) {
-            path.prepend(QDir::toNativeSeparators(QCoreApplication::applicationDirPath()));
-        } else {
-            path.prepend(dirPath);
+        if (image.isNull()) {
+            qCWarning(lcQMPMDK) << "Failed to take a snapshot.";
+            continue;
         }
+        SnapshotTemplate::Context context = grab.context;
+        context.frameTime = frameTime;
+        const QString path = snapshotFilePath(context);
         if (!m_livePreview) {
             qCDebug(lcQMPMDK) << "Taking snapshot -->" << path;
         }
-        return qstrdup(qUtf8Printable(path));
-    });
+        SnapshotWriter::save(image, path);
+    }
+}
+
+QString MDKPlayer::snapshotFilePath(const SnapshotTemplate::Context &context) const
+{
+    QString path = m_snapshotTemplate.expand(context);
+    path.append(u'.');
+    if (m_snapshotFormat.isEmpty()) {
+        path.append(QStringLiteral("png"));
+    } else {
+        path.append(m_snapshotFormat);
+    }
+    const QString dirPath = QDir::toNativeSeparators(m_snapshotDirectory.toLocalFile());
+    if (!dirPath.endsWith(u'/') && !dirPath.endsWith(u'\\')) {
+        path.prepend(QDir::separator());
+    }
+    if (m_snapshotDirectory.isEmpty()) {
+        path.prepend(QDir::toNativeSeparators(QCoreApplication::applicationDirPath()));
+    } else {
+        path.prepend(dirPath);
+    }
+    return path;
 }
 
 void MDKPlayer::initMdkHandlers()
@@ -1033,50 +1639,36 @@ void MDKPlayer::initMdkHandlers()
         if (!msg) {
             return;
         }
-        const QString text = QString::fromUtf8(msg).trimmed();
-        if (text.isEmpty()) {
-            return;
-        }
+        QtMsgType type = QtDebugMsg;
         switch (level) {
         case MDK_NS_PREPEND(LogLevel)::Info:
-            qCInfo(lcQMPMDK).noquote() << text;
+            type = QtInfoMsg;
             break;
         case MDK_NS_PREPEND(LogLevel)::All:
         case MDK_NS_PREPEND(LogLevel)::Debug:
-            qCDebug(lcQMPMDK).noquote() << text;
+            type = QtDebugMsg;
             break;
         case MDK_NS_PREPEND(LogLevel)::Warning:
-            qCWarning(lcQMPMDK).noquote() << text;
+            type = QtWarningMsg;
             break;
         case MDK_NS_PREPEND(LogLevel)::Error:
-            qCCritical(lcQMPMDK).noquote() << text;
+            type = QtCriticalMsg;
             break;
         default:
-            break;
-        }
-    });
-    m_player->currentMediaChanged([this](){
-        const QUrl url = source();
-        if (!url.isValid()) {
             return;
         }
-        if (!m_livePreview) {
-            qCDebug(lcQMPMDK) << "Current media source -->" << urlToString(url, true);
+        // This is called on MDK's threads, leave the formatting to the log sink.
+        if (!LogSink::isEnabled(lcQMPMDK(), type)) {
+            return;
         }
-        Q_EMIT sourceChanged();
+        LogSink::instance()->post(lcQMPMDK(), type, "mdk", msg, reinterpret_cast<quintptr>(this));
+    });
+    // These are invoked on MDK's threads, they are handled on the GUI thread.
+    m_player->currentMediaChanged([this](){
+        postMdkEvent({MDKEvent::Type::CurrentMediaChanged, 0});
     });
     m_player->onMediaStatusChanged([this](MDK_NS_PREPEND(MediaStatus) ms) {
-        m_mediaStatus = mediaStatusFromMDK(ms);
-        Q_EMIT mediaStatusChanged();
-        if ((m_mediaStatus & MediaStatusFlag::Prepared) && !m_loaded) {
-            m_loaded = true;
-            Q_EMIT loaded();
-            Q_EMIT videoSizeChanged();
-            resetInternalData();
-        }
-        if (!m_livePreview) {
-            qCDebug(lcQMPMDK) << "Current media status -->" << m_mediaStatus;
-        }
+        postMdkEvent({MDKEvent::Type::MediaStatusChanged, static_cast<int>(ms)});
         return true;
     });
     m_player->onEvent([this](const MDK_NS_PREPEND(MediaEvent) &me) {
@@ -1092,35 +1684,162 @@ void MDKPlayer::initMdkHandlers()
         return false;
     });
     m_player->onStateChanged([this](MDK_NS_PREPEND(PlaybackState) pbs) {
-        Q_EMIT playbackStateChanged();
-        if (pbs == MDK_NS_PREPEND(PlaybackState)::Playing) {
-            Q_EMIT playing();
-            if (!m_livePreview) {
-                qCDebug(lcQMPMDK) << "Playing.";
-            }
+        postMdkEvent({MDKEvent::Type::StateChanged, static_cast<int>(pbs)});
+    });
+}
+
+void MDKPlayer::postMdkEvent(const MDKEvent &event) // Called on MDK's threads.
+{
+    if (m_mdkEvents.push(event)) {
+        QMetaObject::invokeMethod(this, &MDKPlayer::drainMdkEvents, Qt::QueuedConnection);
+    }
+}
+
+void MDKPlayer::drainMdkEvents()
+{
+    m_drainedMdkEvents.clear();
+    m_mdkEvents.take(m_drainedMdkEvents);
+    for (auto &&event : qAsConst(m_drainedMdkEvents)) {
+        switch (event.type) {
+        case MDKEvent::Type::StateChanged:
+            handlePlaybackStateChanged(static_cast<MDK_NS_PREPEND(PlaybackState)>(event.value));
+            break;
+        case MDKEvent::Type::MediaStatusChanged:
+            handleMediaStatusChanged(static_cast<MDK_NS_PREPEND(MediaStatus)>(event.value));
+            break;
+        case MDKEvent::Type::CurrentMediaChanged:
+            handleCurrentMediaChanged();
+            break;
+        case MDKEvent::Type::Resync:
+            qCWarning(lcQMPMDK) << "MDK events have been dropped, reading the current state instead.";
+            handleMediaStatusChanged(m_player->mediaStatus());
+            handlePlaybackStateChanged(m_player->state());
+            handleCurrentMediaChanged();
+            break;
         }
-        if (pbs == MDK_NS_PREPEND(PlaybackState)::Paused) {
-            Q_EMIT paused();
-            if (!m_livePreview) {
-                qCDebug(lcQMPMDK) << "Paused.";
-            }
+    }
+}
+
+void MDKPlayer::handleCurrentMediaChanged()
+{
+    const QUrl url = source();
+    if (!url.isValid()) {
+        return;
+    }
+    if (!m_livePreview) {
+        qCDebug(lcQMPMDK) << "Current media source -->" << urlToString(url, true);
+    }
+    Q_EMIT sourceChanged();
+}
+
+void MDKPlayer::handleMediaStatusChanged(const MDK_NS_PREPEND(MediaStatus) ms)
+{
+    const MediaStatus status = mediaStatusFromMDK(ms);
+    if (status == m_mediaStatus) {
+        return;
+    }
+    m_mediaStatus = status;
+    Q_EMIT mediaStatusChanged();
+    if ((m_mediaStatus & MediaStatusFlag::Prepared) && !m_loaded) {
+        // Published before any getter can be called from the signals.
+        updateMediaInfoSnapshot();
+        m_loaded = true;
+        Q_EMIT loaded();
+        Q_EMIT videoSizeChanged();
+        resetInternalData();
+    }
+    if (!m_livePreview) {
+        qCDebug(lcQMPMDK) << "Current media status -->" << m_mediaStatus;
+    }
+}
+
+void MDKPlayer::handlePlaybackStateChanged(const MDK_NS_PREPEND(PlaybackState) pbs)
+{
+    if (pbs == m_reportedState) {
+        return;
+    }
+    m_reportedState = pbs;
+    Q_EMIT playbackStateChanged();
+    updatePositionTicking();
+    if (pbs == MDK_NS_PREPEND(PlaybackState)::Playing) {
+        Q_EMIT playing();
+        if (!m_livePreview) {
+            qCDebug(lcQMPMDK) << "Playing.";
         }
-        if (pbs == MDK_NS_PREPEND(PlaybackState)::Stopped) {
-            const QUrl url = source();
-            const qint64 pos = m_lastPosition;
-            m_player->setMedia(nullptr);
-            m_player->setNextMedia(nullptr);
-            m_loaded = false;
-            m_mediaStatus = {};
-            Q_EMIT stopped();
-            Q_EMIT stoppedWithPosition(url, pos);
-            Q_EMIT sourceChanged();
-            resetInternalData();
-            if (!m_livePreview) {
-                qCDebug(lcQMPMDK) << "Stopped.";
-            }
+    }
+    if (pbs == MDK_NS_PREPEND(PlaybackState)::Paused) {
+        Q_EMIT paused();
+        if (!m_livePreview) {
+            qCDebug(lcQMPMDK) << "Paused.";
         }
-    });
+    }
+    if (pbs == MDK_NS_PREPEND(PlaybackState)::Stopped) {
+        const QUrl url = source();
+        const qint64 pos = m_lastPosition;
+        m_player->setMedia(nullptr);
+        m_player->setNextMedia(nullptr);
+        m_loaded = false;
+        clearMediaInfoSnapshot();
+        m_mediaStatus = {};
+        // MDK has closed the media, the copies it was reading can go now.
+        releaseRetiredFiles();
+        // Neither the seeks nor the snapshot will be answered anymore.
+        failPendingSeeks();
+        if (m_frameGrabInFlight) {
+            finishFrameGrabs({}, 0.0);
+        }
+        Q_EMIT stopped();
+        Q_EMIT stoppedWithPosition(url, pos);
+        Q_EMIT sourceChanged();
+        resetInternalData();
+        if (!m_livePreview) {
+            qCDebug(lcQMPMDK) << "Stopped.";
+        }
+        // Continue a load that was waiting for the previous media to stop.
+        QMetaObject::invokeMethod(this, &MDKPlayer::startPendingLoad, Qt::QueuedConnection);
+    }
+}
+
+quint64 MDKPlayer::setActiveTrackAsync(const TrackType type, const int value)
+{
+    const quint64 id = createRequestId();
+    if (!isLoaded()) {
+        qCWarning(lcQMPMDK) << "Setting active track before the media is loaded has no effect."
+                            << "Please try again later when the media has been loaded successfully.";
+        finishRequest(id, false);
+        return id;
+    }
+    // MDK applies the track selection immediately.
+    switch (type) {
+    case TrackType::Video:
+        setActiveVideoTrack(value);
+        finishRequest(id, true, m_activeVideoTrack);
+        break;
+    case TrackType::Audio:
+        setActiveAudioTrack(value);
+        finishRequest(id, true, m_activeAudioTrack);
+        break;
+    case TrackType::Subtitle:
+        setActiveSubtitleTrack(value);
+        finishRequest(id, true, m_activeSubtitleTrack);
+        break;
+    }
+    return id;
+}
+
+quint64 MDKPlayer::setPropertyAsync(const QString &name, const QVariant &value)
+{
+    const quint64 id = createRequestId();
+    if (name.isEmpty() || !value.isValid()) {
+        finishRequest(id, false);
+        return id;
+    }
+    if (!m_livePreview) {
+        qCDebug(lcQMPMDK) << name << "-->" << value;
+    }
+    m_player->setProperty(name.toStdString(), value.toString().toStdString());
+    finishRequest(id, true);
+    return id;
 }
 
 bool MDKPlayer::isLoaded() const
@@ -1167,6 +1886,75 @@ void MDKPlayer::scaleImage(const qreal value)
     m_player->scale(value, value);
 }
 
+QSharedPointer<const MDKPlayer::MediaInfoSnapshot> MDKPlayer::mediaInfoSnapshot() const
+{
+    return m_mediaInfoSnapshot;
+}
+
+void MDKPlayer::updateMediaInfoSnapshot()
+{
+    // Player::mediaInfo() converts the whole C struct every time it's called.
+    const auto &mi = m_player->mediaInfo();
+    const auto snapshot = QSharedPointer<MediaInfoSnapshot>::create();
+    snapshot->startTime = mi.start_time;
+    snapshot->duration = mi.duration;
+    const auto &vs = mi.video;
+    const auto &as = mi.audio;
+    if (!vs.empty()) {
+        const auto &vsf = vs.at(0);
+        snapshot->videoSize = {static_cast<qreal>(vsf.codec.width), static_cast<qreal>(vsf.codec.height)};
+        for (auto &&vsi : qAsConst(vs)) {
+            QVariantHash info = {};
+            info.insert(QStringLiteral("index"), vsi.index);
+            info.insert(QStringLiteral("start_time"), qint64(vsi.start_time));
+            info.insert(QStringLiteral("duration"), qint64(vsi.duration));
+            info.insert(QStringLiteral("frames"), qint64(vsi.frames));
+            info.insert(QStringLiteral("rotation"), vsi.rotation);
+            info.insert(QStringLiteral("width"), vsi.codec.width);
+            info.insert(QStringLiteral("height"), vsi.codec.height);
+            info.insert(QStringLiteral("frame_rate"), vsi.codec.frame_rate);
+            info.insert(QStringLiteral("bit_rate"), qint64(vsi.codec.bit_rate));
+            info.insert(QStringLiteral("codec"), QString::fromUtf8(vsi.codec.codec));
+            info.insert(QStringLiteral("format_name"), QString::fromUtf8(vsi.codec.format_name));
+            // What about metadata?
+            snapshot->mediaTracks.video.append(info);
+        }
+    }
+    if (!as.empty()) {
+        for (auto &&asi : qAsConst(as)) {
+            QVariantHash info = {};
+            info.insert(QStringLiteral("index"), asi.index);
+            info.insert(QStringLiteral("start_time"), qint64(asi.start_time));
+            info.insert(QStringLiteral("duration"), qint64(asi.duration));
+            info.insert(QStringLiteral("frames"), qint64(asi.frames));
+            info.insert(QStringLiteral("bit_rate"), qint64(asi.codec.bit_rate));
+            info.insert(QStringLiteral("frame_rate"), asi.codec.frame_rate);
+            info.insert(QStringLiteral("codec"), QString::fromUtf8(asi.codec.codec));
+            info.insert(QStringLiteral("channels"), asi.codec.channels);
+            info.insert(QStringLiteral("sample_rate"), asi.codec.sample_rate);
+            // What about metadata?
+            snapshot->mediaTracks.audio.append(info);
+        }
+    }
+    // TODO: subtitles
+    for (auto &&chapter : qAsConst(mi.chapters)) {
+        ChapterInfo info = {};
+        info.title = QString::fromStdString(chapter.title);
+        info.startTime = chapter.start_time;
+        info.endTime = chapter.end_time;
+        snapshot->chapters.append(info);
+    }
+    for (auto &&data : qAsConst(mi.metadata)) {
+        snapshot->metaData.insert(QString::fromStdString(data.first), QString::fromStdString(data.second));
+    }
+    m_mediaInfoSnapshot = snapshot;
+}
+
+void MDKPlayer::clearMediaInfoSnapshot()
+{
+    m_mediaInfoSnapshot.reset();
+}
+
 void MDKPlayer::resetInternalData()
 {
     m_lastPosition = 0;
@@ -25,13 +25,22 @@
 #pragma once
 
 #include "mdkbackend_global.h"
+#include "mdkyuvvideonode.h"
+#include "mdkeventqueue.h"
 #include <playerinterface.h>
+#include <snapshotwriter.h>
 #include "include/mdk/global.h"
 #include <QtCore/qurl.h>
-#include <QtCore/qtimer.h>
+#include <QtCore/qtemporaryfile.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtCore/qthread.h>
 
 MDK_NS_BEGIN
 class Player;
+class VideoFrame;
 MDK_NS_END
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
@@ -45,8 +54,12 @@ class MDKPlayer : public MediaPlayer
     QML_NAMED_ELEMENT(MediaPlayer)
 #endif
     Q_DISABLE_COPY_MOVE(MDKPlayer)
+    Q_PROPERTY(bool yuvRendering READ yuvRendering WRITE setYuvRendering NOTIFY yuvRenderingChanged FINAL)
+    Q_PROPERTY(int positionNotifyInterval READ positionNotifyInterval WRITE setPositionNotifyInterval NOTIFY positionNotifyIntervalChanged FINAL)
 
     friend class MDKVideoTextureNode;
+    friend class MDKYuvVideoNode;
+    friend class MDKPositionTicker;
 
 public:
     explicit MDKPlayer(QQuickItem *parent = nullptr);
@@ -135,6 +148,24 @@ public:
 
     Q_NODISCARD bool rendererReady() const override;
 
+    // The video can be shown by other items, see VideoMirror.
+    Q_NODISCARD bool isTextureProvider() const override;
+    Q_NODISCARD QSGTextureProvider *textureProvider() const override;
+
+    // Draw the decoded YUV planes directly instead of letting MDK render an
+    // RGBA texture first. Only takes effect with OpenGL, the other graphics
+    // APIs keep using the regular renderer.
+    Q_NODISCARD bool yuvRendering() const;
+    void setYuvRendering(const bool value);
+
+    // How often positionChanged is emitted at most during playback, in
+    // milliseconds. Nothing is emitted while paused or stopped.
+    Q_NODISCARD int positionNotifyInterval() const;
+    void setPositionNotifyInterval(const int value);
+
+    bool addFrameTap(const QSharedPointer<FrameTap> &tap) override;
+    void removeFrameTap(const QSharedPointer<FrameTap> &tap) override;
+
 public Q_SLOTS:
     void play() override;
     void pause() override;
@@ -150,7 +181,18 @@ public:
     Q_NODISCARD Q_INVOKABLE bool isPaused() const override;
     Q_NODISCARD Q_INVOKABLE bool isStopped() const override;
 
+    Q_NODISCARD Q_INVOKABLE quint64 loadAsync(const QUrl &url) override;
+    Q_NODISCARD Q_INVOKABLE quint64 seekAsync(const qint64 value) override;
+    Q_NODISCARD Q_INVOKABLE quint64 setActiveTrackAsync(const TrackType type, const int value) override;
+    Q_NODISCARD Q_INVOKABLE quint64 setPropertyAsync(const QString &name, const QVariant &value) override;
+
+    Q_INVOKABLE void setSourceDevice(QIODevice *device, const QString &name = {}) override;
+
+    Q_NODISCARD Q_INVOKABLE quint64 grabFrame(const QSize &size = {}) override;
+
 protected:
+    void applyVideoSuspension(const bool suspend) override;
+
     Q_NODISCARD QSGNode *updatePaintNode(QSGNode *node, UpdatePaintNodeData *data) override;
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
     void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
@@ -169,10 +211,80 @@ private:
     void initMdkHandlers();
     void resetInternalData();
 
+    Q_NODISCARD bool isSourceSupported(const QUrl &value) const;
+    // A resource or device being copied to a temporary file by a worker thread.
+    struct Extraction
+    {
+        QScopedPointer<QTemporaryFile> file;
+        // The embedded resource, empty for a device.
+        QUrl resource = {};
+        QAtomicInt canceled = 0;
+        bool succeeded = false;
+    };
+    void startExtraction(QIODevice *device, const QUrl &resource, const QString &name, const quint64 id);
+    void finishExtraction(const QSharedPointer<Extraction> &extraction, const quint64 id);
+    void cancelExtraction();
+    void retireExtractedFile();
+    void releaseRetiredFiles();
+    void startLoad(const QUrl &value, const quint64 id);
+    void startPendingLoad();
+    void openMedia(const QUrl &value, const quint64 id);
+    void doSeek(const qint64 value, const quint64 id);
+    bool queueSeek(const qint64 value, const MDK_NS_PREPEND(SeekFlag) flags, const quint64 id);
+    void failPendingSeeks();
+    void updateFrameCallback();
+    void storePlanarFrame(MDK_NS_PREPEND(VideoFrame) &frame);
+    void tapFrame(MDK_NS_PREPEND(VideoFrame) &frame);
+    void updatePositionTicking();
+    void postMdkEvent(const MDKEvent &event);
+    void drainMdkEvents();
+    void handlePlaybackStateChanged(const MDK_NS_PREPEND(PlaybackState) pbs);
+    void handleMediaStatusChanged(const MDK_NS_PREPEND(MediaStatus) ms);
+    void handleCurrentMediaChanged();
+
+    // Either a grabFrame() request or a snapshot() to be written to disk.
+    struct FrameGrab
+    {
+        quint64 id = 0;
+        QSize size = {};
+        SnapshotTemplate::Context context = {};
+    };
+    void requestFrameGrab(const FrameGrab &grab);
+    void finishFrameGrabs(const QImage &image, const qreal frameTime);
+    Q_NODISCARD QString snapshotFilePath(const SnapshotTemplate::Context &context) const;
+    void notifyPosition(const qint64 timestamp);
+    void updatePosition();
+
+    // Everything the getters need from MDK's media info, converted once when
+    // the media has been prepared. Never modified after it's been published,
+    // getters can keep using their copy while a new one is taken.
+    struct MediaInfoSnapshot
+    {
+        qint64 startTime = 0;
+        qint64 duration = 0;
+        QSizeF videoSize = {};
+        Chapters chapters = {};
+        MetaData metaData = {};
+        MediaTracks mediaTracks = {};
+    };
+    Q_NODISCARD QSharedPointer<const MediaInfoSnapshot> mediaInfoSnapshot() const;
+    void updateMediaInfoSnapshot();
+    void clearMediaInfoSnapshot();
+
+Q_SIGNALS:
+    void yuvRenderingChanged();
+    void positionNotifyIntervalChanged();
+
 private:
     MDKVideoTextureNode *m_node = nullptr;
+    MDKYuvVideoNode *m_yuvNode = nullptr;
 
-    QTimer m_timer;
+    // Must outlive the player, MDK's callbacks push into it until the end.
+    MDKEventQueue m_mdkEvents;
+    // Reused by every drain to avoid allocations.
+    MDKEventList m_drainedMdkEvents = {};
+    // The last state handled on the GUI thread.
+    MDK_NS_PREPEND(PlaybackState) m_reportedState = MDK_NS_PREPEND(PlaybackState)::Stopped;
 
     QSharedPointer<MDK_NS_PREPEND(Player)> m_player;
 
@@ -185,21 +297,70 @@ private:
 
     QUrl m_snapshotDirectory = {};
     QString m_snapshotFormat = QStringLiteral("png");
-    QString m_snapshotTemplate = QStringLiteral("${filename}_${datetime}_${frametime}");
+    SnapshotTemplate m_snapshotTemplate{QStringLiteral("${filename}_${datetime}_${frametime}")};
+    // MDK only keeps one snapshot callback, all requests made until it has
+    // been invoked get the same frame.
+    QList<FrameGrab> m_pendingFrameGrabs = {};
+    bool m_frameGrabInFlight = false;
+    // Identifies the snapshot in flight, so a late answer can be told apart.
+    quint64 m_frameGrabSerial = 0;
 
     FillMode m_fillMode = FillMode::PreserveAspectFit;
     MediaStatus m_mediaStatus = {};
 
     qint64 m_lastPosition = 0;
+    int m_positionNotifyInterval = 100;
+    // When the shared ticker notified the position last, see MDKPositionTicker::now().
+    qint64 m_lastPositionNotify = 0;
+    bool m_positionTicking = false;
+    // Set whenever MDK has a new video frame, the position can't have moved
+    // without one.
+    QAtomicInt m_positionFrameDirty = 0;
 
     int m_activeVideoTrack = 0;
     int m_activeAudioTrack = 0;
     int m_activeSubtitleTrack = 0;
 
     QUrl m_cachedUrl = {};
+    // MDK can't read from Qt's I/O classes, embedded resources and devices
+    // are copied to a temporary file which is kept until the next one replaces it.
+    QScopedPointer<QTemporaryFile> m_extractedFile;
+    QUrl m_extractedSource = {};
+    // Replaced copies MDK may still have open, removed once it has let go of them.
+    QList<QTemporaryFile *> m_retiredExtractedFiles = {};
+    QSharedPointer<Extraction> m_extraction = {};
+    QPointer<QThread> m_extractionThread = {};
+    quint64 m_extractionId = 0;
+    quint64 m_cachedRequestId = 0;
+    // The source to open once the current media has been stopped.
+    QUrl m_pendingLoadUrl = {};
+    quint64 m_pendingLoadId = 0;
+    // The ids of the seeks MDK hasn't finished yet, oldest first. Seeks
+    // nobody waits for are queued as 0, see queueSeek().
+    QList<quint64> m_pendingSeeks = {};
+    // Bumped whenever the pending seeks are dropped, see failPendingSeeks().
+    quint64 m_seekGeneration = 0;
     bool m_rendererReady = false;
+    // Set by MDK's render callback when the video needs to be drawn again.
+    QAtomicInt m_videoFrameDirty = 1;
+
+    bool m_yuvRendering = false;
+    // Whether the YUV node is the one on screen, the frame callback does
+    // nothing otherwise.
+    QAtomicInt m_yuvNodeActive = 0;
+    // Only touched by MDK's frame callback, reused to avoid reallocations.
+    MDKPlanarFrame m_planarWriteFrame = {};
+    // The latest frame for the YUV node, swapped in and out under the mutex.
+    QMutex m_planarFrameMutex;
+    MDKPlanarFrame m_planarFrame = {};
+    bool m_planarFrameFresh = false;
+
+    // Copied by the frame callback, so a tap can be removed while it runs.
+    QMutex m_frameTapMutex;
+    QList<QSharedPointer<FrameTap>> m_frameTaps = {};
 
     bool m_loaded = false;
+    QSharedPointer<const MediaInfoSnapshot> m_mediaInfoSnapshot;
 };
 
 QTMEDIAPLAYER_END_NAMESPACE
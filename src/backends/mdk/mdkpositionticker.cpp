@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mdkpositionticker.h"
+#include "mdkplayer.h"
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+Q_GLOBAL_STATIC(MDKPositionTicker, mdkPositionTickerInstance)
+
+MDKPositionTicker::MDKPositionTicker()
+{
+    m_timer.setTimerType(Qt::CoarseTimer);
+    QObject::connect(&m_timer, &QTimer::timeout, &m_timer, [this](){
+        tick();
+    });
+    m_clock.start();
+}
+
+MDKPositionTicker::~MDKPositionTicker() = default;
+
+MDKPositionTicker *MDKPositionTicker::instance()
+{
+    return mdkPositionTickerInstance();
+}
+
+void MDKPositionTicker::subscribe(MDKPlayer *player)
+{
+    Q_ASSERT(player);
+    if (!player) {
+        return;
+    }
+    if (m_players.contains(player)) {
+        return;
+    }
+    m_players.append(player);
+    updateInterval();
+}
+
+void MDKPositionTicker::unsubscribe(MDKPlayer *player)
+{
+    Q_ASSERT(player);
+    if (!player) {
+        return;
+    }
+    if (!m_players.removeOne(player)) {
+        return;
+    }
+    updateInterval();
+}
+
+void MDKPositionTicker::updateInterval()
+{
+    if (m_players.isEmpty()) {
+        m_timer.stop();
+        return;
+    }
+    int interval = m_players.first()->positionNotifyInterval();
+    for (auto &&player : qAsConst(m_players)) {
+        interval = qMin(interval, player->positionNotifyInterval());
+    }
+    if (m_timer.isActive() && (m_timer.interval() == interval)) {
+        return;
+    }
+    m_timer.start(interval);
+}
+
+qint64 MDKPositionTicker::now() const
+{
+    return m_clock.elapsed();
+}
+
+void MDKPositionTicker::tick()
+{
+    const qint64 timestamp = now();
+    // A player may unsubscribe itself while being notified.
+    const QList<MDKPlayer *> players = m_players;
+    for (auto &&player : qAsConst(players)) {
+        if (m_players.contains(player)) {
+            player->notifyPosition(timestamp);
+        }
+    }
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mdkbackend_global.h"
+#include <QtCore/qtimer.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qlist.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+class MDKPlayer;
+
+// One coarse timer shared by all playing MDK players to report their position.
+// Players only subscribe while they are playing, so the timer doesn't run at
+// all once every player is paused or stopped. It ticks at the shortest notify
+// interval of its subscribers. Must only be used from the GUI thread.
+class MDKPositionTicker
+{
+    Q_DISABLE_COPY_MOVE(MDKPositionTicker)
+
+public:
+    explicit MDKPositionTicker();
+    ~MDKPositionTicker();
+
+    Q_NODISCARD static MDKPositionTicker *instance();
+
+    void subscribe(MDKPlayer *player);
+    void unsubscribe(MDKPlayer *player);
+
+    // Call when the notify interval of a subscribed player has changed.
+    void updateInterval();
+
+    // Milliseconds since the ticker was created.
+    Q_NODISCARD qint64 now() const;
+
+private:
+    void tick();
+
+private:
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    QList<MDKPlayer *> m_players = {};
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -72,11 +72,19 @@ void MDKVideoTextureNode::sync()
     // effectiveDevicePixelRatio() will always give the correct result even if QQuickWindow is not available.
     const auto dpr = m_window->effectiveDevicePixelRatio();
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
-    const QSize newSize = QSizeF(m_item->size() * dpr).toSize();
+    const QSize pixelSize = QSizeF(m_item->size() * dpr).toSize();
 #else
-    const QSize newSize = {qRound(m_item->width() * dpr), qRound(m_item->height() * dpr)};
+    const QSize pixelSize = {qRound(m_item->width() * dpr), qRound(m_item->height() * dpr)};
 #endif
-    if (texture() && (newSize == m_size)) {
+    // Never render above the native video size, the scene graph scales up.
+    // MDK renders into the surface size, so this also limits its scaler.
+    const QSize newSize = m_item->videoRenderSize(pixelSize);
+    // Safe to touch the item here: the GUI thread is blocked during sync().
+    if (m_item->m_videoFrameDirty.fetchAndStoreAcquire(0) != 0) {
+        markFrameDirty();
+    }
+    const QSize targetSize = chooseRenderTargetSize(m_targetSize, newSize);
+    if (texture() && (newSize == m_size) && (targetSize == m_targetSize)) {
         return;
     }
     const auto player = m_player.lock();
@@ -84,27 +92,51 @@ void MDKVideoTextureNode::sync()
         return;
     }
     m_size = newSize;
-    const auto tex = ensureTexture(player.data(), m_size);
-    if (!tex) {
-        return;
+    if (!texture() || (targetSize != m_targetSize)) {
+        const auto tex = ensureTexture(player.data(), targetSize);
+        if (!tex) {
+            return;
+        }
+        m_targetSize = targetSize;
+        delete texture();
+        presentTexture(tex);
+        // MUST set when texture() is available
+        setTextureCoordinatesTransform(m_transformMode);
+        setFiltering(QSGTexture::Linear);
     }
-    delete texture();
-    setTexture(tex);
-    // MUST set when texture() is available
-    setTextureCoordinatesTransform(m_transformMode);
-    setFiltering(QSGTexture::Linear);
+    // MDK draws into the surface size, which is only the top-left part of the target.
+    setSourceRect(0, 0, m_size.width(), m_size.height());
+    // Either the target is new or the video has to be laid out again.
+    markFrameDirty();
     // Qt's own API will apply correct DPR automatically. Don't double scale.
     setRect(0, 0, m_item->width(), m_item->height());
     // if qsg render loop is threaded, a new render thread will be created when item's window changes, so mdk vo_opaque parameter must be bound to item window
     player->setVideoSurfaceSize(m_size.width(), m_size.height(), this);
 }
 
+void MDKVideoTextureNode::applyRenderAPI(void *player, mdk::RenderAPI *api)
+{
+    Q_ASSERT(player);
+    Q_ASSERT(api);
+    if (!player || !api) {
+        return;
+    }
+    static_cast<mdk::Player *>(player)->setRenderAPI(api, this);
+    QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
+}
+
 // This is hooked up to beforeRendering() so we can start our own render
 // command encoder. If we instead wanted to use the scenegraph's render command
 // encoder (targeting the window), it should be connected to
 // beforeRenderPassRecording() instead.
 void MDKVideoTextureNode::render()
 {
+    // The window also repaints for reasons that have nothing to do with the
+    // video (animations of other items, for example). The texture still holds
+    // the last frame, only render again if MDK asked for it.
+    if (!takeFrameDirty()) {
+        return;
+    }
     const auto player = m_player.lock();
     if (!player) {
         return;
@@ -30,6 +30,7 @@
 namespace mdk
 {
 class Player;
+struct RenderAPI;
 }
 
 QT_BEGIN_NAMESPACE
@@ -54,11 +55,19 @@ public:
 protected Q_SLOTS:
     void render() override;
 
+protected:
+    // Hands the render API of a new render target over to the player given
+    // to ensureTexture().
+    void applyRenderAPI(void *player, mdk::RenderAPI *api);
+
 protected:
     TextureCoordinatesTransformMode m_transformMode = TextureCoordinatesTransformFlag::NoTransform;
     QQuickWindow *m_window = nullptr;
     MDKPlayer *m_item = nullptr;
+    // Size of the video, in pixels.
     QSize m_size = {};
+    // Size of the render target, which is usually a bit larger than the video.
+    QSize m_targetSize = {};
 
 private:
     QWeakPointer<mdk::Player> m_player;
@@ -23,6 +23,8 @@
  */
 
 #include "mdkvideotexturenode.h"
+#include "mdkvideowall.h"
+#include "mdkvideowallnode.h"
 #include "mdkplayer.h"
 #include <cstring>
 #include <QtQuick/qquickwindow.h>
@@ -68,57 +70,101 @@
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
 
-class MDKVideoTextureNodeImpl final : public MDKVideoTextureNode
+#if QT_CONFIG(opengl)
+static constexpr const char kOpenGLTargetKind[] = "mdk/opengl";
+
+class MDKOpenGLRenderTarget final : public VideoRenderTarget
 {
-    Q_OBJECT
-    Q_DISABLE_COPY_MOVE(MDKVideoTextureNodeImpl)
+    Q_DISABLE_COPY_MOVE(MDKOpenGLRenderTarget)
 
 public:
-    explicit MDKVideoTextureNodeImpl(QQuickItem *item) : MDKVideoTextureNode(item)
-    {
-        Q_ASSERT(item);
-        if (!item) {
-            qFatal("null mdk player item.");
-        }
-    }
+    explicit MDKOpenGLRenderTarget(const QSize &size)
+        : VideoRenderTarget(kOpenGLTargetKind, size), fbo(new QOpenGLFramebufferObject(size)) {}
+    ~MDKOpenGLRenderTarget() override = default;
 
-    ~MDKVideoTextureNodeImpl() override
-    {
-        // Release gfx resources
-#if QT_CONFIG(opengl)
-        fbo_gl.reset();
-#endif
-#if (QT_CONFIG(vulkan) && __has_include(<vulkan/vulkan.h>))
-        freeTexture();
+    QScopedPointer<QOpenGLFramebufferObject> fbo;
+};
 #endif
-    }
 
-protected:
-    QSGTexture *ensureTexture(void *player, const QSize &size) override;
+#ifdef Q_OS_WINDOWS
+static constexpr const char kD3D11TargetKind[] = "mdk/d3d11";
 
-private:
-#if (QT_CONFIG(vulkan) && __has_include(<vulkan/vulkan.h>))
-    bool buildTexture(const QSize &size);
-    void freeTexture();
-#endif
+class MDKD3D11RenderTarget final : public VideoRenderTarget
+{
+    Q_DISABLE_COPY_MOVE(MDKD3D11RenderTarget)
 
-private:
-#if QT_CONFIG(opengl)
-    QScopedPointer<QOpenGLFramebufferObject> fbo_gl;
-#endif
-#ifdef Q_OS_WINDOWS
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_texture_d3d11 = nullptr;
+public:
+    explicit MDKD3D11RenderTarget(const QSize &size) : VideoRenderTarget(kD3D11TargetKind, size) {}
+    ~MDKD3D11RenderTarget() override = default;
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> texture = nullptr;
+};
 #endif
+
 #ifdef Q_OS_MACOS
-    id<MTLTexture> m_texture_mtl = nil;
+static constexpr const char kMetalTargetKind[] = "mdk/metal";
+
+class MDKMetalRenderTarget final : public VideoRenderTarget
+{
+    Q_DISABLE_COPY_MOVE(MDKMetalRenderTarget)
+
+public:
+    explicit MDKMetalRenderTarget(const QSize &size) : VideoRenderTarget(kMetalTargetKind, size) {}
+    ~MDKMetalRenderTarget() override = default;
+
+    id<MTLTexture> texture = nil;
+};
 #endif
+
 #if (QT_CONFIG(vulkan) && __has_include(<vulkan/vulkan.h>))
-    VkImage m_texture_vk = VK_NULL_HANDLE;
-    VkDeviceMemory m_textureMemory = VK_NULL_HANDLE;
+static constexpr const char kVulkanTargetKind[] = "mdk/vulkan";
+
+class MDKVulkanRenderTarget final : public VideoRenderTarget
+{
+    Q_DISABLE_COPY_MOVE(MDKVulkanRenderTarget)
+
+public:
+    explicit MDKVulkanRenderTarget(const QSize &size, QVulkanInstance *inst, VkPhysicalDevice physDev,
+                                   VkDevice dev, QVulkanDeviceFunctions *devFuncs)
+        : VideoRenderTarget(kVulkanTargetKind, size), m_inst(inst), m_physDev(physDev), m_dev(dev), m_devFuncs(devFuncs) {}
+    ~MDKVulkanRenderTarget() override;
+
+    Q_NODISCARD bool build();
+    Q_NODISCARD VkDevice device() const { return m_dev; }
+
+    VkImage image = VK_NULL_HANDLE;
+
+private:
+    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    QVulkanInstance *m_inst = nullptr;
     VkPhysicalDevice m_physDev = VK_NULL_HANDLE;
     VkDevice m_dev = VK_NULL_HANDLE;
     QVulkanDeviceFunctions *m_devFuncs = nullptr;
+};
 #endif
+
+// Creates the render targets for the graphics API of the window. Shared by
+// the nodes of the player and the video wall, which only differ in how the
+// render API is handed over to MDK (see their applyRenderAPI()).
+template<class Node>
+class MDKVideoTextureNodeImpl final : public Node
+{
+    Q_DISABLE_COPY_MOVE(MDKVideoTextureNodeImpl)
+
+public:
+    explicit MDKVideoTextureNodeImpl(QQuickItem *item) : Node(item)
+    {
+        Q_ASSERT(item);
+        if (!item) {
+            qFatal("null mdk player item.");
+        }
+    }
+
+    // The gfx resources are owned by the render target, which goes back to the pool.
+    ~MDKVideoTextureNodeImpl() override = default;
+
+protected:
+    QSGTexture *ensureTexture(void *player, const QSize &size) override;
 };
 
 [[nodiscard]] MDKVideoTextureNode *createNode(MDKPlayer *item)
@@ -127,18 +173,27 @@ private:
     if (!item) {
         return nullptr;
     }
-    return new MDKVideoTextureNodeImpl(item);
+    return new MDKVideoTextureNodeImpl<MDKVideoTextureNode>(item);
+}
+
+[[nodiscard]] MDKVideoWallNode *createWallNode(MDKVideoWall *item)
+{
+    Q_ASSERT(item);
+    if (!item) {
+        return nullptr;
+    }
+    return new MDKVideoTextureNodeImpl<MDKVideoWallNode>(item);
 }
 
-QSGTexture *MDKVideoTextureNodeImpl::ensureTexture(void *player, const QSize &size)
+template<class Node>
+QSGTexture *MDKVideoTextureNodeImpl<Node>::ensureTexture(void *player, const QSize &size)
 {
-    Q_ASSERT(player);
-    Q_ASSERT(m_window);
-    if (!player || !m_window) {
+    Q_ASSERT(this->m_window);
+    if (!this->m_window) {
         return nullptr;
     }
 
-    const QSGRendererInterface *rif = m_window->rendererInterface();
+    const QSGRendererInterface *rif = this->m_window->rendererInterface();
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
     intmax_t nativeObj = 0;
     int nativeLayout = 0;
@@ -152,21 +207,24 @@ QSGTexture *MDKVideoTextureNodeImpl::ensureTexture(void *player, const QSize &si
 #endif // (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
     {
 #if QT_CONFIG(opengl)
-        m_transformMode = TextureCoordinatesTransformFlag::MirrorVertically;
-        fbo_gl.reset(new QOpenGLFramebufferObject(size));
+        this->m_transformMode = TextureCoordinatesTransformFlag::MirrorVertically;
+        auto target = static_cast<MDKOpenGLRenderTarget *>(this->recycleRenderTarget(kOpenGLTargetKind, size));
+        if (!target) {
+            target = new MDKOpenGLRenderTarget(size);
+        }
+        this->setRenderTarget(target);
         MDK_NS_PREPEND(GLRenderAPI) ra = {};
-        ra.fbo = fbo_gl->handle();
-        static_cast<MDK_NS_PREPEND(Player) *>(player)->setRenderAPI(&ra, this);
-        QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
-        const auto tex = fbo_gl->texture();
+        ra.fbo = target->fbo->handle();
+        this->applyRenderAPI(player, &ra);
+        const auto tex = target->fbo->texture();
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
         nativeObj = static_cast<decltype(nativeObj)>(tex);
 #if (QT_VERSION <= QT_VERSION_CHECK(5, 14, 0))
-        return m_window->createTextureFromId(tex, size);
+        return this->m_window->createTextureFromId(tex, size);
 #endif // (QT_VERSION <= QT_VERSION_CHECK(5, 14, 0))
 #else // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
         if (tex) {
-            return QNativeInterface::QSGOpenGLTexture::fromNative(tex, m_window, size, QQuickWindow::TextureHasAlphaChannel);
+            return QNativeInterface::QSGOpenGLTexture::fromNative(tex, this->m_window, size, QQuickWindow::TextureHasAlphaChannel);
         }
 #endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
 #else // QT_CONFIG(opengl)
@@ -181,27 +239,32 @@ QSGTexture *MDKVideoTextureNodeImpl::ensureTexture(void *player, const QSize &si
 #endif // (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
     {
 #ifdef Q_OS_WINDOWS
-        const auto dev = static_cast<ID3D11Device *>(rif->getResource(m_window, QSGRendererInterface::DeviceResource));
+        const auto dev = static_cast<ID3D11Device *>(rif->getResource(this->m_window, QSGRendererInterface::DeviceResource));
         if (!dev) {
             qCCritical(lcQMPMDK) << "Failed to acquire D3D11 device resource.";
             return nullptr;
         }
-        const auto desc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_R8G8B8A8_UNORM, size.width(), size.height(), 1, 1,
-                                             D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET,
-                                             D3D11_USAGE_DEFAULT, 0, 1, 0, 0);
-        if (FAILED(dev->CreateTexture2D(&desc, nullptr, &m_texture_d3d11))) {
-            qCCritical(lcQMPMDK) << "Failed to create D3D11 2D texture.";
-            return nullptr;
+        auto target = static_cast<MDKD3D11RenderTarget *>(this->recycleRenderTarget(kD3D11TargetKind, size));
+        if (!target) {
+            QScopedPointer<MDKD3D11RenderTarget> newTarget(new MDKD3D11RenderTarget(size));
+            const auto desc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_R8G8B8A8_UNORM, size.width(), size.height(), 1, 1,
+                                                 D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET,
+                                                 D3D11_USAGE_DEFAULT, 0, 1, 0, 0);
+            if (FAILED(dev->CreateTexture2D(&desc, nullptr, &newTarget->texture))) {
+                qCCritical(lcQMPMDK) << "Failed to create D3D11 2D texture.";
+                return nullptr;
+            }
+            target = newTarget.take();
         }
+        this->setRenderTarget(target);
         MDK_NS_PREPEND(D3D11RenderAPI) ra = {};
-        ra.rtv = m_texture_d3d11.Get();
-        static_cast<MDK_NS_PREPEND(Player) *>(player)->setRenderAPI(&ra, this);
-        QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
+        ra.rtv = target->texture.Get();
+        this->applyRenderAPI(player, &ra);
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        nativeObj = reinterpret_cast<decltype(nativeObj)>(m_texture_d3d11.Get());
+        nativeObj = reinterpret_cast<decltype(nativeObj)>(target->texture.Get());
 #else // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        if (m_texture_d3d11) {
-            return QNativeInterface::QSGD3D11Texture::fromNative(m_texture_d3d11.Get(), m_window, size, QQuickWindow::TextureHasAlphaChannel);
+        if (target->texture) {
+            return QNativeInterface::QSGD3D11Texture::fromNative(target->texture.Get(), this->m_window, size, QQuickWindow::TextureHasAlphaChannel);
         }
 #endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
 #else // defined(Q_OS_WINDOWS)
@@ -215,30 +278,34 @@ QSGTexture *MDKVideoTextureNodeImpl::ensureTexture(void *player, const QSize &si
 #endif // (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
     {
 #ifdef Q_OS_MACOS
-        auto dev = (__bridge id<MTLDevice>)rif->getResource(m_window, QSGRendererInterface::DeviceResource);
+        auto dev = (__bridge id<MTLDevice>)rif->getResource(this->m_window, QSGRendererInterface::DeviceResource);
         Q_ASSERT(dev);
 
-        MTLTextureDescriptor *desc = [[MTLTextureDescriptor alloc] init];
-        desc.textureType = MTLTextureType2D;
-        desc.pixelFormat = MTLPixelFormatRGBA8Unorm;
-        desc.width = size.width();
-        desc.height = size.height();
-        desc.mipmapLevelCount = 1;
-        desc.resourceOptions = MTLResourceStorageModePrivate;
-        desc.storageMode = MTLStorageModePrivate;
-        desc.usage = MTLTextureUsageShaderRead | MTLTextureUsageRenderTarget;
-        m_texture_mtl = [dev newTextureWithDescriptor: desc];
+        auto target = static_cast<MDKMetalRenderTarget *>(this->recycleRenderTarget(kMetalTargetKind, size));
+        if (!target) {
+            MTLTextureDescriptor *desc = [[MTLTextureDescriptor alloc] init];
+            desc.textureType = MTLTextureType2D;
+            desc.pixelFormat = MTLPixelFormatRGBA8Unorm;
+            desc.width = size.width();
+            desc.height = size.height();
+            desc.mipmapLevelCount = 1;
+            desc.resourceOptions = MTLResourceStorageModePrivate;
+            desc.storageMode = MTLStorageModePrivate;
+            desc.usage = MTLTextureUsageShaderRead | MTLTextureUsageRenderTarget;
+            target = new MDKMetalRenderTarget(size);
+            target->texture = [dev newTextureWithDescriptor: desc];
+        }
+        this->setRenderTarget(target);
         MDK_NS_PREPEND(MetalRenderAPI) ra = {};
-        ra.texture = (__bridge void*)m_texture_mtl;
+        ra.texture = (__bridge void*)target->texture;
         ra.device = (__bridge void*)dev;
-        ra.cmdQueue = rif->getResource(m_window, QSGRendererInterface::CommandQueueResource);
-        static_cast<MDK_NS_PREPEND(Player) *>(player)->setRenderAPI(&ra, this);
-        QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
+        ra.cmdQueue = rif->getResource(this->m_window, QSGRendererInterface::CommandQueueResource);
+        this->applyRenderAPI(player, &ra);
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
         nativeObj = decltype(nativeObj)(ra.texture);
 #else // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        if (m_texture_mtl) {
-            return QNativeInterface::QSGMetalTexture::fromNative(m_texture_mtl, m_window, size, QQuickWindow::TextureHasAlphaChannel);
+        if (target->texture) {
+            return QNativeInterface::QSGMetalTexture::fromNative(target->texture, this->m_window, size, QQuickWindow::TextureHasAlphaChannel);
         }
 #endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
 #else // defined(Q_OS_MACOS)
@@ -255,28 +322,36 @@ QSGTexture *MDKVideoTextureNodeImpl::ensureTexture(void *player, const QSize &si
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
         nativeLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 #endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        const auto inst = reinterpret_cast<QVulkanInstance *>(rif->getResource(m_window, QSGRendererInterface::VulkanInstanceResource));
-        m_physDev = *static_cast<VkPhysicalDevice *>(rif->getResource(m_window, QSGRendererInterface::PhysicalDeviceResource));
-        const auto newDev = *static_cast<VkDevice *>(rif->getResource(m_window, QSGRendererInterface::DeviceResource));
-        // TODO: why m_dev is 0 if device lost
-        freeTexture();
-        m_dev = newDev;
-        m_devFuncs = inst->deviceFunctions(m_dev);
-
-        buildTexture(size);
+        const auto inst = reinterpret_cast<QVulkanInstance *>(rif->getResource(this->m_window, QSGRendererInterface::VulkanInstanceResource));
+        const auto physDev = *static_cast<VkPhysicalDevice *>(rif->getResource(this->m_window, QSGRendererInterface::PhysicalDeviceResource));
+        const auto dev = *static_cast<VkDevice *>(rif->getResource(this->m_window, QSGRendererInterface::DeviceResource));
+        auto target = static_cast<MDKVulkanRenderTarget *>(this->recycleRenderTarget(kVulkanTargetKind, size));
+        // TODO: why the device is 0 if device lost
+        if (target && (target->device() != dev)) {
+            delete target;
+            target = nullptr;
+        }
+        if (!target) {
+            QScopedPointer<MDKVulkanRenderTarget> newTarget(new MDKVulkanRenderTarget(size, inst, physDev, dev, inst->deviceFunctions(dev)));
+            if (!newTarget->build()) {
+                return nullptr;
+            }
+            target = newTarget.take();
+        }
+        this->setRenderTarget(target);
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        nativeObj = reinterpret_cast<decltype(nativeObj)>(m_texture_vk);
+        nativeObj = reinterpret_cast<decltype(nativeObj)>(target->image);
 #endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
 
         MDK_NS_PREPEND(VulkanRenderAPI) ra = {};
-        ra.device = m_dev;
-        ra.phy_device = m_physDev;
+        ra.device = dev;
+        ra.phy_device = physDev;
         ra.opaque = this;
-        ra.rt = m_texture_vk;
+        ra.rt = target->image;
         ra.renderTargetInfo = [](void *opaque, int *w, int *h, VkFormat *fmt, VkImageLayout *layout) {
             const auto node = static_cast<MDKVideoTextureNodeImpl *>(opaque);
-            *w = node->m_size.width();
-            *h = node->m_size.height();
+            *w = node->m_targetSize.width();
+            *h = node->m_targetSize.height();
             *fmt = VK_FORMAT_R8G8B8A8_UNORM;
             *layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
             return 1;
@@ -287,11 +362,10 @@ QSGTexture *MDKVideoTextureNodeImpl::ensureTexture(void *player, const QSize &si
             const auto cmdBuf = *static_cast<VkCommandBuffer *>(rif->getResource(node->m_window, QSGRendererInterface::CommandListResource));
             return cmdBuf;
         };
-        static_cast<MDK_NS_PREPEND(Player) *>(player)->setRenderAPI(&ra, this);
-        QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
+        this->applyRenderAPI(player, &ra);
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
-        if (m_texture_vk) {
-            return QNativeInterface::QSGVulkanTexture::fromNative(m_texture_vk, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_window, size, QQuickWindow::TextureHasAlphaChannel);
+        if (target->image) {
+            return QNativeInterface::QSGVulkanTexture::fromNative(target->image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, this->m_window, size, QQuickWindow::TextureHasAlphaChannel);
         }
 #endif // (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
 #else // QT_CONFIG(vulkan) && __has_include(<vulkan/vulkan.h>)
@@ -311,7 +385,7 @@ QSGTexture *MDKVideoTextureNodeImpl::ensureTexture(void *player, const QSize &si
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
     if (nativeObj) {
-        return m_window->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture, &nativeObj, nativeLayout, size, QQuickWindow::TextureHasAlphaChannel);
+        return this->m_window->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture, &nativeObj, nativeLayout, size, QQuickWindow::TextureHasAlphaChannel);
     }
 #endif // (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
 #endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
@@ -319,16 +393,17 @@ QSGTexture *MDKVideoTextureNodeImpl::ensureTexture(void *player, const QSize &si
 }
 
 #if (QT_CONFIG(vulkan) && __has_include(<vulkan/vulkan.h>))
-bool MDKVideoTextureNodeImpl::buildTexture(const QSize &size)
+bool MDKVulkanRenderTarget::build()
 {
+    const QSize targetSize = size();
     VkImageCreateInfo imageInfo;
     std::memset(&imageInfo, 0, sizeof(imageInfo));
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.flags = 0;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM; // Qt Quick hardcoded
-    imageInfo.extent.width = static_cast<uint32_t>(size.width());
-    imageInfo.extent.height = static_cast<uint32_t>(size.height());
+    imageInfo.extent.width = static_cast<uint32_t>(targetSize.width());
+    imageInfo.extent.height = static_cast<uint32_t>(targetSize.height());
     imageInfo.extent.depth = 1;
     imageInfo.mipLevels = 1;
     imageInfo.arrayLayers = 1;
@@ -337,17 +412,14 @@ bool MDKVideoTextureNodeImpl::buildTexture(const QSize &size)
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
     imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-    VkImage image = VK_NULL_HANDLE;
     VK_ENSURE(m_devFuncs->vkCreateImage(m_dev, &imageInfo, nullptr, &image), false);
 
-    m_texture_vk = image;
-
     VkMemoryRequirements memReq;
     m_devFuncs->vkGetImageMemoryRequirements(m_dev, image, &memReq);
 
     quint32 memIndex = 0;
     VkPhysicalDeviceMemoryProperties physDevMemProps;
-    m_window->vulkanInstance()->functions()->vkGetPhysicalDeviceMemoryProperties(m_physDev, &physDevMemProps);
+    m_inst->functions()->vkGetPhysicalDeviceMemoryProperties(m_physDev, &physDevMemProps);
     for (uint32_t i = 0; i != physDevMemProps.memoryTypeCount; ++i) {
         if (!(memReq.memoryTypeBits & (1 << i))) {
             continue;
@@ -362,25 +434,25 @@ bool MDKVideoTextureNodeImpl::buildTexture(const QSize &size)
         memIndex
     };
 
-    VK_ENSURE(m_devFuncs->vkAllocateMemory(m_dev, &allocInfo, nullptr, &m_textureMemory), false);
-    VK_ENSURE(m_devFuncs->vkBindImageMemory(m_dev, image, m_textureMemory, 0), false);
+    VK_ENSURE(m_devFuncs->vkAllocateMemory(m_dev, &allocInfo, nullptr, &m_memory), false);
+    VK_ENSURE(m_devFuncs->vkBindImageMemory(m_dev, image, m_memory, 0), false);
 
     return true;
 }
 
-void MDKVideoTextureNodeImpl::freeTexture()
+MDKVulkanRenderTarget::~MDKVulkanRenderTarget()
 {
-    if (!m_texture_vk) {
+    if (!image) {
         return;
     }
     VK_WARN(m_devFuncs->vkDeviceWaitIdle(m_dev));
-    m_devFuncs->vkFreeMemory(m_dev, m_textureMemory, nullptr);
-    m_textureMemory = VK_NULL_HANDLE;
-    m_devFuncs->vkDestroyImage(m_dev, m_texture_vk, nullptr);
-    m_texture_vk = VK_NULL_HANDLE;
+    if (m_memory) {
+        m_devFuncs->vkFreeMemory(m_dev, m_memory, nullptr);
+        m_memory = VK_NULL_HANDLE;
+    }
+    m_devFuncs->vkDestroyImage(m_dev, image, nullptr);
+    image = VK_NULL_HANDLE;
 }
 #endif
 
 QTMEDIAPLAYER_END_NAMESPACE
-
-#include "mdkvideotexturenode_impl.moc"
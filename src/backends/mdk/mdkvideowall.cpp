@@ -0,0 +1,378 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mdkvideowall.h"
+#include "mdkvideowallnode.h"
+#include "mdkqthelper.h"
+#include "include/mdk/Player.h"
+#include <QtCore/qdir.h>
+#include <QtCore/qmath.h>
+#include <QtQuick/qquickwindow.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+[[nodiscard]] extern MDKVideoWallNode *createWallNode(MDKVideoWall *item);
+
+[[nodiscard]] static inline QString urlToString(const QUrl &value)
+{
+    if (!value.isValid()) {
+        return {};
+    }
+    return (value.isLocalFile() ? QDir::toNativeSeparators(value.toLocalFile()) : value.toString());
+}
+
+MDKVideoWall::MDKVideoWall(QQuickItem *parent) : QQuickItem(parent)
+{
+    if (!MDK::Qt::isMDKAvailable()) {
+        qFatal("MDK is not available.");
+    }
+    // Without this flag, our item won't draw anything. It must be set.
+    setFlag(ItemHasContents);
+    connect(this, &MDKVideoWall::windowChanged, this, [this](QQuickWindow *window){
+        disconnect(m_invalidatedConnection);
+        m_invalidatedConnection = {};
+        if (window) {
+            m_invalidatedConnection = connect(window, &QQuickWindow::sceneGraphInvalidated,
+                                              this, &MDKVideoWall::invalidateSceneGraph, Qt::DirectConnection);
+        }
+    });
+    // Repainting the whole window on every new frame of a capped tile would
+    // defeat the limit, such tiles are only checked at their frame rate.
+    connect(&m_frameRateTimer, &QTimer::timeout, this, [this](){
+        for (auto &&tile : qAsConst(m_tiles)) {
+            if (tile->capped.loadAcquire() && tile->frameDirty.loadAcquire()) {
+                update();
+                return;
+            }
+        }
+    });
+}
+
+MDKVideoWall::~MDKVideoWall()
+{
+    for (auto &&tile : qAsConst(m_tiles)) {
+        destroyTile(tile);
+    }
+}
+
+QList<QUrl> MDKVideoWall::sources() const
+{
+    QList<QUrl> result = {};
+    for (auto &&tile : qAsConst(m_tiles)) {
+        result.append(tile->source);
+    }
+    return result;
+}
+
+void MDKVideoWall::setSources(const QList<QUrl> &value)
+{
+    if (sources() == value) {
+        return;
+    }
+    // Tiles that keep their source keep playing.
+    QList<QSharedPointer<MDKVideoWallTile>> tiles = {};
+    for (int i = 0; i != value.size(); ++i) {
+        if ((i < m_tiles.size()) && (m_tiles.at(i)->source == value.at(i))) {
+            tiles.append(m_tiles.at(i));
+        } else {
+            if (i < m_tiles.size()) {
+                destroyTile(m_tiles.at(i));
+            }
+            tiles.append(createTile(value.at(i)));
+        }
+    }
+    for (int i = value.size(); i < m_tiles.size(); ++i) {
+        destroyTile(m_tiles.at(i));
+    }
+    m_tiles = tiles;
+    updateTileSize();
+    updateFrameRateTimer();
+    update();
+    Q_EMIT sourcesChanged();
+}
+
+int MDKVideoWall::columns() const
+{
+    return m_columns;
+}
+
+void MDKVideoWall::setColumns(const int value)
+{
+    const int columns = qMax(value, 0);
+    if (m_columns == columns) {
+        return;
+    }
+    m_columns = columns;
+    updateTileSize();
+    update();
+    Q_EMIT columnsChanged();
+}
+
+qreal MDKVideoWall::spacing() const
+{
+    return m_spacing;
+}
+
+void MDKVideoWall::setSpacing(const qreal value)
+{
+    const qreal spacing = qMax(value, 0.0);
+    if (qFuzzyCompare(m_spacing, spacing)) {
+        return;
+    }
+    m_spacing = spacing;
+    updateTileSize();
+    update();
+    Q_EMIT spacingChanged();
+}
+
+QSizeF MDKVideoWall::tileSize() const
+{
+    return m_tileSize;
+}
+
+qreal MDKVideoWall::tileFrameRate() const
+{
+    return m_tileFrameRate;
+}
+
+void MDKVideoWall::setTileFrameRate(const qreal value)
+{
+    const qreal frameRate = qMax(value, 0.0);
+    if (qFuzzyCompare(m_tileFrameRate, frameRate)) {
+        return;
+    }
+    m_tileFrameRate = frameRate;
+    updateFrameRateTimer();
+    update();
+    Q_EMIT tileFrameRateChanged();
+}
+
+bool MDKVideoWall::rendererReady() const
+{
+    return m_rendererReady;
+}
+
+qreal MDKVideoWall::frameRateAt(const int index) const
+{
+    if ((index < 0) || (index >= m_tiles.size())) {
+        return 0.0;
+    }
+    const qreal frameRate = m_tiles.at(index)->frameRate;
+    return ((frameRate < 0.0) ? m_tileFrameRate : frameRate);
+}
+
+void MDKVideoWall::setFrameRateAt(const int index, const qreal value)
+{
+    if ((index < 0) || (index >= m_tiles.size())) {
+        qCWarning(lcQMPMDK) << "No video wall tile at index" << index;
+        return;
+    }
+    m_tiles.at(index)->frameRate = ((value < 0.0) ? -1.0 : value);
+    updateFrameRateTimer();
+    update();
+}
+
+QRectF MDKVideoWall::tileRect(const int index) const
+{
+    const int count = m_tiles.size();
+    if ((index < 0) || (index >= count)) {
+        return {};
+    }
+    const int columns = columnCount();
+    const int rows = ((count + columns - 1) / columns);
+    const qreal tileWidth = ((width() - (m_spacing * (columns - 1))) / columns);
+    const qreal tileHeight = ((height() - (m_spacing * (rows - 1))) / rows);
+    if ((tileWidth <= 0.0) || (tileHeight <= 0.0)) {
+        return {};
+    }
+    return {(index % columns) * (tileWidth + m_spacing), (index / columns) * (tileHeight + m_spacing), tileWidth, tileHeight};
+}
+
+void MDKVideoWall::play()
+{
+    m_playbackState = MDK_NS_PREPEND(PlaybackState)::Playing;
+    for (auto &&tile : qAsConst(m_tiles)) {
+        tile->player->set(m_playbackState);
+    }
+}
+
+void MDKVideoWall::pause()
+{
+    m_playbackState = MDK_NS_PREPEND(PlaybackState)::Paused;
+    for (auto &&tile : qAsConst(m_tiles)) {
+        tile->player->set(m_playbackState);
+    }
+}
+
+void MDKVideoWall::stop()
+{
+    m_playbackState = MDK_NS_PREPEND(PlaybackState)::Stopped;
+    for (auto &&tile : qAsConst(m_tiles)) {
+        tile->player->set(m_playbackState);
+    }
+}
+
+void MDKVideoWall::invalidateSceneGraph() // Called on the render thread when the scenegraph is invalidated.
+{
+    // The scene graph has deleted the node by now, with the graphics context
+    // still current, which released the render target and the renderers of
+    // all tiles. A new node has to hand out a new render API.
+    m_node = nullptr;
+    QMetaObject::invokeMethod(this, "setRendererReady", Qt::QueuedConnection, Q_ARG(bool, false));
+}
+
+void MDKVideoWall::setRendererReady(const bool value)
+{
+    if (m_rendererReady == value) {
+        return;
+    }
+    m_rendererReady = value;
+    Q_EMIT rendererReadyChanged();
+}
+
+void MDKVideoWall::releaseResources() // Called on the gui thread if the item is removed from scene.
+{
+    m_node = nullptr;
+}
+
+QSGNode *MDKVideoWall::updatePaintNode(QSGNode *node, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data);
+    auto n = static_cast<MDKVideoWallNode *>(node);
+    if (!n && ((width() <= 0) || (height() <= 0))) {
+        return nullptr;
+    }
+    if (!n) {
+        n = createWallNode(this);
+    }
+    m_node = n;
+    n->sync();
+    window()->update(); // Ensure getting to beforeRendering() at some point.
+    return n;
+}
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+void MDKVideoWall::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+#else
+void MDKVideoWall::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+#endif
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+#else
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+#endif
+    if (newGeometry.size() != oldGeometry.size()) {
+        updateTileSize();
+        update();
+    }
+}
+
+QSharedPointer<MDKVideoWallTile> MDKVideoWall::createTile(const QUrl &source)
+{
+    const auto tile = QSharedPointer<MDKVideoWallTile>::create();
+    tile->source = source;
+    tile->player.reset(new MDK_NS_PREPEND(Player));
+    tile->player->setMute(true);
+    tile->player->setDecoders(MDK_NS_PREPEND(MediaType)::Video, {"FFmpeg"});
+    tile->wall = this;
+    // The tile outlives the callback, see the order of its members. The
+    // callback is never replaced: MDK could still be running the old one.
+    MDKVideoWallTile * const rawTile = tile.data();
+    tile->player->setRenderCallback([rawTile](void *){
+        // Picked up by the node in its next render().
+        rawTile->frameDirty.storeRelease(1);
+        if (rawTile->capped.loadAcquire()) {
+            return;
+        }
+        const QMutexLocker locker(&rawTile->wallMutex);
+        if (rawTile->wall) {
+            QMetaObject::invokeMethod(rawTile->wall, "update");
+        }
+    });
+    if (source.isValid()) {
+        tile->player->setMedia(qUtf8Printable(urlToString(source)));
+        // It's necessary to call "prepare()", otherwise we'll get no picture.
+        tile->player->prepare();
+        tile->player->set(m_playbackState);
+    }
+    return tile;
+}
+
+void MDKVideoWall::destroyTile(const QSharedPointer<MDKVideoWallTile> &tile)
+{
+    Q_ASSERT(tile);
+    if (!tile) {
+        return;
+    }
+    {
+        // Waits for a render callback that is using the wall right now.
+        const QMutexLocker locker(&tile->wallMutex);
+        tile->wall = nullptr;
+    }
+    tile->player->set(MDK_NS_PREPEND(PlaybackState)::Stopped);
+    // The node releases the renderer and drops the last reference in its next sync().
+}
+
+int MDKVideoWall::columnCount() const
+{
+    const int count = m_tiles.size();
+    if (count <= 0) {
+        return 1;
+    }
+    if (m_columns > 0) {
+        return qMin(m_columns, count);
+    }
+    return qCeil(qSqrt(qreal(count)));
+}
+
+void MDKVideoWall::updateTileSize()
+{
+    const QSizeF size = tileRect(0).size();
+    if (m_tileSize == size) {
+        return;
+    }
+    m_tileSize = size;
+    Q_EMIT tileSizeChanged();
+}
+
+void MDKVideoWall::updateFrameRateTimer()
+{
+    qreal highest = 0.0;
+    for (int i = 0; i != m_tiles.size(); ++i) {
+        const qreal frameRate = frameRateAt(i);
+        m_tiles.at(i)->capped.storeRelease((frameRate > 0.0) ? 1 : 0);
+        highest = qMax(highest, frameRate);
+    }
+    if (highest <= 0.0) {
+        m_frameRateTimer.stop();
+        return;
+    }
+    const int interval = qMax(qRound(1000.0 / highest), 1);
+    if (!m_frameRateTimer.isActive() || (m_frameRateTimer.interval() != interval)) {
+        m_frameRateTimer.start(interval);
+    }
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
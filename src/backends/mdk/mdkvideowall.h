@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mdkbackend_global.h"
+#include "include/mdk/global.h"
+#include <QtCore/qurl.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtQuick/qquickitem.h>
+
+MDK_NS_BEGIN
+class Player;
+MDK_NS_END
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+class MDKVideoWall;
+class MDKVideoWallNode;
+
+// One stream of the wall. Shared with the node, which keeps the player alive
+// until it has released the renderer in its graphics context.
+struct MDKVideoWallTile
+{
+    // MDK's render callback runs on one of its threads and only reaches the
+    // wall through this pointer, under the mutex. Cleared when the tile is
+    // removed from the wall.
+    QMutex wallMutex;
+    MDKVideoWall *wall = nullptr;
+    QUrl source = {};
+    // Frames per second, zero means no limit and a negative value follows
+    // the tileFrameRate of the wall.
+    qreal frameRate = -1.0;
+    // Whether the effective frame rate is limited. The wall's timer asks for
+    // the repaints of such tiles, not the render callback.
+    QAtomicInt capped = 0;
+    // Set by MDK's render callback, cleared when the node has drawn the tile.
+    QAtomicInt frameDirty = 1;
+    // Declared last to be destroyed first: MDK's threads, which may still be
+    // running the render callback, are gone before the members above.
+    QSharedPointer<MDK_NS_PREPEND(Player)> player;
+};
+
+// Plays many streams at once, like a CCTV wall. Instead of one item, render
+// target and render pass per stream, all tiles are drawn into a single
+// shared texture, each into the part of it that is shown on screen, and the
+// wall is a single scene graph node. The tiles are laid out in a grid and
+// muted. Their frame rate can be limited to save GPU time.
+class MDKVideoWall : public QQuickItem
+{
+    Q_OBJECT
+#ifdef QML_NAMED_ELEMENT
+    QML_NAMED_ELEMENT(VideoWall)
+#endif
+    Q_DISABLE_COPY_MOVE(MDKVideoWall)
+    Q_PROPERTY(QList<QUrl> sources READ sources WRITE setSources NOTIFY sourcesChanged FINAL)
+    Q_PROPERTY(int columns READ columns WRITE setColumns NOTIFY columnsChanged FINAL)
+    Q_PROPERTY(qreal spacing READ spacing WRITE setSpacing NOTIFY spacingChanged FINAL)
+    Q_PROPERTY(QSizeF tileSize READ tileSize NOTIFY tileSizeChanged FINAL)
+    Q_PROPERTY(qreal tileFrameRate READ tileFrameRate WRITE setTileFrameRate NOTIFY tileFrameRateChanged FINAL)
+    Q_PROPERTY(bool rendererReady READ rendererReady NOTIFY rendererReadyChanged FINAL)
+
+    friend class MDKVideoWallNode;
+
+public:
+    explicit MDKVideoWall(QQuickItem *parent = nullptr);
+    ~MDKVideoWall() override;
+
+    Q_NODISCARD QList<QUrl> sources() const;
+    void setSources(const QList<QUrl> &value);
+
+    // Zero picks about as many columns as rows.
+    Q_NODISCARD int columns() const;
+    void setColumns(const int value);
+
+    Q_NODISCARD qreal spacing() const;
+    void setSpacing(const qreal value);
+
+    // The size of each tile on screen, the tiles also render at this size.
+    Q_NODISCARD QSizeF tileSize() const;
+
+    // The frame rate limit of all tiles, zero (the default) means no limit.
+    Q_NODISCARD qreal tileFrameRate() const;
+    void setTileFrameRate(const qreal value);
+
+    Q_NODISCARD bool rendererReady() const;
+
+    // The frame rate limit of a single tile, a negative value goes back to
+    // tileFrameRate.
+    Q_NODISCARD Q_INVOKABLE qreal frameRateAt(const int index) const;
+    Q_INVOKABLE void setFrameRateAt(const int index, const qreal value);
+
+    // Where the tile is shown, in item coordinates.
+    Q_NODISCARD Q_INVOKABLE QRectF tileRect(const int index) const;
+
+public Q_SLOTS:
+    void play();
+    void pause();
+    void stop();
+
+protected:
+    Q_NODISCARD QSGNode *updatePaintNode(QSGNode *node, UpdatePaintNodeData *data) override;
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+#else
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+#endif
+
+private Q_SLOTS:
+    void invalidateSceneGraph();
+    void setRendererReady(const bool value);
+
+private:
+    void releaseResources() override;
+
+    Q_NODISCARD QSharedPointer<MDKVideoWallTile> createTile(const QUrl &source);
+    void destroyTile(const QSharedPointer<MDKVideoWallTile> &tile);
+    Q_NODISCARD int columnCount() const;
+    void updateTileSize();
+    void updateFrameRateTimer();
+
+Q_SIGNALS:
+    void sourcesChanged();
+    void columnsChanged();
+    void spacingChanged();
+    void tileSizeChanged();
+    void tileFrameRateChanged();
+    void rendererReadyChanged();
+
+private:
+    MDKVideoWallNode *m_node = nullptr;
+    QList<QSharedPointer<MDKVideoWallTile>> m_tiles = {};
+    MDK_NS_PREPEND(PlaybackState) m_playbackState = MDK_NS_PREPEND(PlaybackState)::Playing;
+    int m_columns = 0;
+    qreal m_spacing = 0.0;
+    QSizeF m_tileSize = {};
+    qreal m_tileFrameRate = 0.0;
+    bool m_rendererReady = false;
+    // Runs at the highest frame rate limit while any tile is capped.
+    QTimer m_frameRateTimer;
+    QMetaObject::Connection m_invalidatedConnection = {};
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,241 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mdkvideowallnode.h"
+#include "mdkvideowall.h"
+#include "include/mdk/Player.h"
+#include <QtQuick/qquickwindow.h>
+#include <QtQuick/qsggeometry.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+MDKVideoWallNode::MDKVideoWallNode(QQuickItem *item) : VideoTextureNode(item)
+{
+    Q_ASSERT(item);
+    if (!item) {
+        qFatal("null mdk video wall item.");
+    }
+    m_item = static_cast<MDKVideoWall *>(item);
+    m_window = m_item->window();
+    // Replaces the single rectangle of QSGSimpleTextureNode: one quad per tile.
+    m_geometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 0);
+    m_geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+    setGeometry(m_geometry);
+    setFlag(OwnsGeometry);
+    setFlag(UsePreprocess);
+    connect(m_window, &QQuickWindow::beforeRendering, this, &MDKVideoWallNode::render);
+}
+
+MDKVideoWallNode::~MDKVideoWallNode()
+{
+    const auto tex = texture();
+    if (tex) {
+        delete tex;
+    }
+    // We hold the last references to removed tiles, their players are still alive.
+    for (auto &&state : qAsConst(m_tiles)) {
+        state.tile->player->setVideoSurfaceSize(-1, -1, this);
+    }
+    qCDebug(lcQMPMDK) << "Video wall renderer destroyed.";
+}
+
+void MDKVideoWallNode::sync()
+{
+    Q_ASSERT(m_item);
+    Q_ASSERT(m_window);
+    if (!m_item || !m_window) {
+        return;
+    }
+
+    const auto dpr = m_window->effectiveDevicePixelRatio();
+    const QSize pixelSize = QSizeF(m_item->size() * dpr).toSize();
+    if (pixelSize.isEmpty()) {
+        return;
+    }
+
+    // Safe to touch the item here: the GUI thread is blocked during sync().
+    const QList<QSharedPointer<MDKVideoWallTile>> &tiles = m_item->m_tiles;
+    bool tilesChanged = (tiles.size() != m_tiles.size());
+    for (int i = 0; !tilesChanged && (i != tiles.size()); ++i) {
+        tilesChanged = (tiles.at(i) != m_tiles.at(i).tile);
+    }
+    if (tilesChanged) {
+        // The renderers of removed tiles have to be released in our graphics context.
+        for (auto &&state : qAsConst(m_tiles)) {
+            if (!tiles.contains(state.tile)) {
+                state.tile->player->setVideoSurfaceSize(-1, -1, this);
+            }
+        }
+        QList<TileState> states = {};
+        for (auto &&tile : qAsConst(tiles)) {
+            TileState state = {};
+            state.tile = tile;
+            states.append(state);
+        }
+        m_tiles = states;
+    }
+
+    const QSize targetSize = chooseRenderTargetSize(m_targetSize, pixelSize);
+    const bool newTarget = (!texture() || (targetSize != m_targetSize) || tilesChanged);
+    if (newTarget) {
+        // This also hands the render API over to the new tiles.
+        const auto tex = ensureTexture(nullptr, targetSize);
+        if (!tex) {
+            return;
+        }
+        m_targetSize = targetSize;
+        delete texture();
+        presentTexture(tex);
+        setFiltering(QSGTexture::Linear);
+    }
+
+    const bool relayout = (newTarget || (pixelSize != m_size));
+    m_size = pixelSize;
+    const QRect surfaceRect = {QPoint(0, 0), m_size};
+    for (int i = 0; i != m_tiles.size(); ++i) {
+        TileState &state = m_tiles[i];
+        state.frameRate = m_item->frameRateAt(i);
+        const QRectF rect = m_item->tileRect(i);
+        if (!relayout && (rect == state.rect)) {
+            continue;
+        }
+        state.rect = rect;
+        state.pixelRect = QRectF(rect.topLeft() * dpr, rect.size() * dpr).toAlignedRect().intersected(surfaceRect);
+        state.drawn = false;
+        m_geometryDirty = true;
+        if (state.pixelRect.isEmpty()) {
+            continue;
+        }
+        const auto &player = state.tile->player;
+        // If the player has no renderer for us yet, this creates it.
+        player->setVideoSurfaceSize(m_size.width(), m_size.height(), this);
+        const auto surfaceWidth = static_cast<float>(m_size.width());
+        const auto surfaceHeight = static_cast<float>(m_size.height());
+        player->setVideoViewport(static_cast<float>(state.pixelRect.x()) / surfaceWidth,
+                                 static_cast<float>(state.pixelRect.y()) / surfaceHeight,
+                                 static_cast<float>(state.pixelRect.width()) / surfaceWidth,
+                                 static_cast<float>(state.pixelRect.height()) / surfaceHeight, this);
+        // The tiles share the surface: MDK must neither clear it nor leave
+        // parts of the tile empty, which would show whatever was there before.
+        player->setBackgroundColor(-1.0f, -1.0f, -1.0f, -1.0f, this);
+        player->setAspectRatio(MDK_NS_PREPEND(IgnoreAspectRatio), this);
+        state.tile->frameDirty.storeRelease(1);
+    }
+}
+
+void MDKVideoWallNode::preprocess()
+{
+    if (!m_geometryDirty) {
+        return;
+    }
+    m_geometryDirty = false;
+    updateGeometry();
+}
+
+// This is hooked up to beforeRendering(), which comes before preprocess(),
+// so tiles drawn for the first time become visible in the same frame.
+void MDKVideoWallNode::render()
+{
+    for (auto &state : m_tiles) {
+        if (state.pixelRect.isEmpty() || !state.tile->frameDirty.loadAcquire()) {
+            continue;
+        }
+        if (state.drawn && (state.frameRate > 0.0) && state.lastRender.isValid()) {
+            // The wall's timer fires at about the frame rate and the window
+            // only renders on the next vsync, so allow for some jitter.
+            const auto interval = qint64(1000000000.0 / state.frameRate);
+            if (state.lastRender.nsecsElapsed() < (interval - (interval / 4))) {
+                // Too early for this tile, the timer asks again.
+                continue;
+            }
+        }
+        state.tile->frameDirty.storeRelease(0);
+        if (state.tile->player->renderVideo(this) < 0.0) {
+            continue;
+        }
+        state.lastRender.start();
+        if (!state.drawn) {
+            state.drawn = true;
+            m_geometryDirty = true;
+        }
+    }
+}
+
+void MDKVideoWallNode::applyRenderAPI(void *player, mdk::RenderAPI *api)
+{
+    Q_UNUSED(player);
+    Q_ASSERT(api);
+    if (!api) {
+        return;
+    }
+    for (auto &&state : qAsConst(m_tiles)) {
+        state.tile->player->setRenderAPI(api, this);
+    }
+    QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
+}
+
+void MDKVideoWallNode::updateGeometry()
+{
+    int count = 0;
+    for (auto &&state : qAsConst(m_tiles)) {
+        if (state.drawn) {
+            ++count;
+        }
+    }
+    m_geometry->allocate(count * 6);
+    if ((count > 0) && !m_targetSize.isEmpty()) {
+        QSGGeometry::TexturedPoint2D *vertices = m_geometry->vertexDataAsTexturedPoint2D();
+        const auto targetWidth = static_cast<float>(m_targetSize.width());
+        const auto targetHeight = static_cast<float>(m_targetSize.height());
+        const bool mirrored = m_transformMode.testFlag(TextureCoordinatesTransformFlag::MirrorVertically);
+        for (auto &&state : qAsConst(m_tiles)) {
+            if (!state.drawn) {
+                continue;
+            }
+            const QRect &pixels = state.pixelRect;
+            const float left = (static_cast<float>(pixels.x()) / targetWidth);
+            const float right = (static_cast<float>(pixels.x() + pixels.width()) / targetWidth);
+            // The surface covers the top-left part of the target, OpenGL
+            // stores it upside down.
+            const int surfaceTop = (mirrored ? (m_size.height() - pixels.y()) : pixels.y());
+            const int surfaceBottom = (mirrored ? (surfaceTop - pixels.height()) : (surfaceTop + pixels.height()));
+            const float top = (static_cast<float>(surfaceTop) / targetHeight);
+            const float bottom = (static_cast<float>(surfaceBottom) / targetHeight);
+            const auto x1 = static_cast<float>(state.rect.left());
+            const auto y1 = static_cast<float>(state.rect.top());
+            const auto x2 = static_cast<float>(state.rect.right());
+            const auto y2 = static_cast<float>(state.rect.bottom());
+            vertices[0].set(x1, y1, left, top);
+            vertices[1].set(x2, y1, right, top);
+            vertices[2].set(x1, y2, left, bottom);
+            vertices[3].set(x2, y1, right, top);
+            vertices[4].set(x2, y2, right, bottom);
+            vertices[5].set(x1, y2, left, bottom);
+            vertices += 6;
+        }
+    }
+    markDirty(DirtyGeometry);
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mdkbackend_global.h"
+#include <texturenodeinterface.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qsharedpointer.h>
+
+namespace mdk
+{
+struct RenderAPI;
+}
+
+QT_BEGIN_NAMESPACE
+QT_FORWARD_DECLARE_CLASS(QQuickWindow)
+QT_FORWARD_DECLARE_CLASS(QSGGeometry)
+QT_END_NAMESPACE
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+class MDKVideoWall;
+struct MDKVideoWallTile;
+
+// Draws all tiles of a video wall into one render target: every player
+// renders into its own viewport of the same surface. Only the tiles that
+// have been drawn since the target was (re)created are part of the geometry,
+// so the rest of the target never shows up.
+class MDKVideoWallNode : public VideoTextureNode
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(MDKVideoWallNode)
+
+public:
+    explicit MDKVideoWallNode(QQuickItem *item);
+    ~MDKVideoWallNode() override;
+
+    void sync() override;
+    void preprocess() override;
+
+protected Q_SLOTS:
+    void render() override;
+
+protected:
+    // Hands the render API of a new render target over to all tiles, the
+    // player argument is not used.
+    void applyRenderAPI(void *player, mdk::RenderAPI *api);
+
+protected:
+    TextureCoordinatesTransformMode m_transformMode = TextureCoordinatesTransformFlag::NoTransform;
+    QQuickWindow *m_window = nullptr;
+    MDKVideoWall *m_item = nullptr;
+    // Size of the surface all tiles render into, in pixels.
+    QSize m_size = {};
+    // Size of the render target, which is usually a bit larger than the surface.
+    QSize m_targetSize = {};
+
+private:
+    void updateGeometry();
+
+private:
+    struct TileState
+    {
+        QSharedPointer<MDKVideoWallTile> tile;
+        // In item coordinates.
+        QRectF rect = {};
+        // In the surface, in pixels.
+        QRect pixelRect = {};
+        qreal frameRate = 0.0;
+        QElapsedTimer lastRender;
+        bool drawn = false;
+    };
+    QList<TileState> m_tiles = {};
+    QSGGeometry *m_geometry = nullptr;
+    bool m_geometryDirty = true;
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
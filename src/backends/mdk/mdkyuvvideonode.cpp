@@ -0,0 +1,449 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mdkyuvvideonode.h"
+#include "mdkplayer.h"
+#include "include/mdk/Player.h"
+#include <cstring>
+#include <QtCore/qmutex.h>
+#include <QtGui/qvector2d.h>
+#include <QtQuick/qquickwindow.h>
+#include <QtQuick/qsgmaterial.h>
+#if QT_CONFIG(opengl)
+#include <QtGui/qopenglcontext.h>
+#include <QtGui/qopenglfunctions.h>
+#include <QtGui/qopenglshaderprogram.h>
+#endif
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+#include <QtQuick/qquickopenglutils.h>
+#include <QtQuick/qsgtexture_platform.h>
+#endif
+
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+#ifndef GL_RG
+#define GL_RG 0x8227
+#endif
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+#ifndef GL_RG8
+#define GL_RG8 0x822B
+#endif
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// Size of the uniform block of the Qt 6 shaders: qt_Matrix, colorMatrix,
+// vSelect and qt_Opacity with std140 layout.
+static constexpr const int kUniformBufferSize = 144;
+
+// The frames don't carry their color space, so guess it like most players
+// do: BT.709 for HD content, BT.601 for everything smaller. Limited range.
+// The result maps (Y, U, V, 1) to (R, G, B, 1).
+[[nodiscard]] static inline QMatrix4x4 yuvToRgbMatrix(const int height)
+{
+    const bool hd = (height >= 720);
+    const float kr = (hd ? 0.2126f : 0.299f);
+    const float kb = (hd ? 0.0722f : 0.114f);
+    const float kg = (1.0f - kr - kb);
+    const float ys = (255.0f / 219.0f);
+    const float cs = (255.0f / 224.0f);
+    const float yo = (-16.0f / 255.0f * ys);
+    const float co = (128.0f / 255.0f);
+    const float rv = (2.0f * (1.0f - kr) * cs);
+    const float gu = (-2.0f * (1.0f - kb) * kb / kg * cs);
+    const float gv = (-2.0f * (1.0f - kr) * kr / kg * cs);
+    const float bu = (2.0f * (1.0f - kb) * cs);
+    return QMatrix4x4(ys, 0.0f, rv, (yo - (rv * co)),
+                      ys, gu, gv, (yo - ((gu + gv) * co)),
+                      ys, bu, 0.0f, (yo - (bu * co)),
+                      0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+class MDKYuvVideoMaterial : public QSGMaterial
+{
+public:
+    explicit MDKYuvVideoMaterial() = default;
+    ~MDKYuvVideoMaterial() override = default;
+
+    Q_NODISCARD QSGMaterialType *type() const override
+    {
+        static QSGMaterialType type;
+        return &type;
+    }
+
+    Q_NODISCARD int compare(const QSGMaterial *other) const override
+    {
+        const auto material = static_cast<const MDKYuvVideoMaterial *>(other);
+        return std::memcmp(textures, material->textures, sizeof(textures));
+    }
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    Q_NODISCARD QSGMaterialShader *createShader(QSGRendererInterface::RenderMode renderMode) const override;
+#else
+    Q_NODISCARD QSGMaterialShader *createShader() const override;
+#endif
+
+public:
+    // Y, U and V. NV12 frames use the same UV texture twice.
+    uint textures[3] = {};
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    QSGTexture *planes[3] = {};
+#endif
+    QMatrix4x4 colorMatrix = {};
+    // Which channel of the V texture holds V: red for I420, green for NV12.
+    QVector2D vSelect = {1.0f, 0.0f};
+};
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+class MDKYuvVideoShader : public QSGMaterialShader
+{
+public:
+    explicit MDKYuvVideoShader()
+    {
+        setShaderFileName(VertexStage, QStringLiteral(":/qtmediaplayer/mdk/shaders/yuv.vert.qsb"));
+        setShaderFileName(FragmentStage, QStringLiteral(":/qtmediaplayer/mdk/shaders/yuv.frag.qsb"));
+    }
+
+    ~MDKYuvVideoShader() override = default;
+
+    bool updateUniformData(RenderState &state, QSGMaterial *newMaterial, QSGMaterial *oldMaterial) override
+    {
+        Q_UNUSED(oldMaterial);
+        const auto material = static_cast<MDKYuvVideoMaterial *>(newMaterial);
+        QByteArray * const buffer = state.uniformData();
+        Q_ASSERT(buffer->size() >= kUniformBufferSize);
+        char * const data = buffer->data();
+        if (state.isMatrixDirty()) {
+            const QMatrix4x4 matrix = state.combinedMatrix();
+            std::memcpy(data, matrix.constData(), 64);
+        }
+        std::memcpy(data + 64, material->colorMatrix.constData(), 64);
+        const float vSelect[2] = {material->vSelect.x(), material->vSelect.y()};
+        std::memcpy(data + 128, vSelect, 8);
+        if (state.isOpacityDirty()) {
+            const float opacity = state.opacity();
+            std::memcpy(data + 136, &opacity, 4);
+        }
+        return true;
+    }
+
+    void updateSampledImage(RenderState &state, int binding, QSGTexture **texture,
+                            QSGMaterial *newMaterial, QSGMaterial *oldMaterial) override
+    {
+        Q_UNUSED(state);
+        Q_UNUSED(oldMaterial);
+        if ((binding < 1) || (binding > 3)) {
+            return;
+        }
+        *texture = static_cast<MDKYuvVideoMaterial *>(newMaterial)->planes[binding - 1];
+    }
+};
+
+QSGMaterialShader *MDKYuvVideoMaterial::createShader(QSGRendererInterface::RenderMode renderMode) const
+{
+    Q_UNUSED(renderMode);
+    return new MDKYuvVideoShader;
+}
+#else // (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+class MDKYuvVideoShader : public QSGMaterialShader
+{
+public:
+    explicit MDKYuvVideoShader() = default;
+    ~MDKYuvVideoShader() override = default;
+
+    Q_NODISCARD const char *vertexShader() const override
+    {
+        return "attribute highp vec4 qt_VertexPosition;\n"
+               "attribute highp vec2 qt_VertexTexCoord;\n"
+               "uniform highp mat4 qt_Matrix;\n"
+               "varying highp vec2 texCoord;\n"
+               "void main() {\n"
+               "    texCoord = qt_VertexTexCoord;\n"
+               "    gl_Position = qt_Matrix * qt_VertexPosition;\n"
+               "}\n";
+    }
+
+    Q_NODISCARD const char *fragmentShader() const override
+    {
+        return "uniform sampler2D yTexture;\n"
+               "uniform sampler2D uTexture;\n"
+               "uniform sampler2D vTexture;\n"
+               "uniform mediump mat4 colorMatrix;\n"
+               "uniform mediump vec2 vSelect;\n"
+               "uniform lowp float qt_Opacity;\n"
+               "varying highp vec2 texCoord;\n"
+               "void main() {\n"
+               "    mediump float y = texture2D(yTexture, texCoord).r;\n"
+               "    mediump float u = texture2D(uTexture, texCoord).r;\n"
+               "    mediump float v = dot(texture2D(vTexture, texCoord).rg, vSelect);\n"
+               "    mediump vec4 rgb = colorMatrix * vec4(y, u, v, 1.0);\n"
+               "    gl_FragColor = vec4(clamp(rgb.rgb, 0.0, 1.0), 1.0) * qt_Opacity;\n"
+               "}\n";
+    }
+
+    Q_NODISCARD char const *const *attributeNames() const override
+    {
+        static const char *names[] = {"qt_VertexPosition", "qt_VertexTexCoord", nullptr};
+        return names;
+    }
+
+    void updateState(const RenderState &state, QSGMaterial *newMaterial, QSGMaterial *oldMaterial) override
+    {
+        Q_UNUSED(oldMaterial);
+        const auto material = static_cast<MDKYuvVideoMaterial *>(newMaterial);
+        QOpenGLFunctions * const functions = state.context()->functions();
+        // Bind in reverse order, so that unit 0 is active again afterwards.
+        for (int i = 2; i >= 0; --i) {
+            functions->glActiveTexture(GL_TEXTURE0 + i);
+            functions->glBindTexture(GL_TEXTURE_2D, material->textures[i]);
+        }
+        program()->setUniformValue(m_yTexture, 0);
+        program()->setUniformValue(m_uTexture, 1);
+        program()->setUniformValue(m_vTexture, 2);
+        program()->setUniformValue(m_colorMatrix, material->colorMatrix);
+        program()->setUniformValue(m_vSelect, material->vSelect);
+        if (state.isMatrixDirty()) {
+            program()->setUniformValue(m_matrix, state.combinedMatrix());
+        }
+        if (state.isOpacityDirty()) {
+            program()->setUniformValue(m_opacity, state.opacity());
+        }
+    }
+
+protected:
+    void initialize() override
+    {
+        m_matrix = program()->uniformLocation("qt_Matrix");
+        m_opacity = program()->uniformLocation("qt_Opacity");
+        m_colorMatrix = program()->uniformLocation("colorMatrix");
+        m_vSelect = program()->uniformLocation("vSelect");
+        m_yTexture = program()->uniformLocation("yTexture");
+        m_uTexture = program()->uniformLocation("uTexture");
+        m_vTexture = program()->uniformLocation("vTexture");
+    }
+
+private:
+    int m_matrix = -1;
+    int m_opacity = -1;
+    int m_colorMatrix = -1;
+    int m_vSelect = -1;
+    int m_yTexture = -1;
+    int m_uTexture = -1;
+    int m_vTexture = -1;
+};
+
+QSGMaterialShader *MDKYuvVideoMaterial::createShader() const
+{
+    return new MDKYuvVideoShader;
+}
+#endif // (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+
+MDKYuvVideoNode::MDKYuvVideoNode(QQuickItem *item)
+{
+    Q_ASSERT(item);
+    if (!item) {
+        qFatal("null mdk player item.");
+    }
+    m_item = static_cast<MDKPlayer *>(item);
+    m_window = m_item->window();
+    m_player = m_item->m_player;
+    setGeometry(new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 4));
+    setFlag(OwnsGeometry);
+    m_material = new MDKYuvVideoMaterial;
+    setMaterial(m_material);
+    setFlag(OwnsMaterial);
+    // Nothing to draw before the first frame has been uploaded.
+    updateGeometry();
+    connect(m_window, &QQuickWindow::beforeRendering, this, &MDKYuvVideoNode::upload);
+    QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
+}
+
+MDKYuvVideoNode::~MDKYuvVideoNode()
+{
+    releaseTextures();
+    const auto player = m_player.lock();
+    if (player) {
+        player->setVideoSurfaceSize(-1, -1, this);
+    }
+    qCDebug(lcQMPMDK) << "YUV renderer destroyed.";
+}
+
+bool MDKYuvVideoNode::isSupported(QQuickWindow *window)
+{
+#if QT_CONFIG(opengl)
+    Q_ASSERT(window);
+    if (!window) {
+        return false;
+    }
+    // With Qt 5 this is the direct OpenGL renderer, its RHI variant (OpenGLRhi)
+    // can't use the OpenGL shader. With Qt 6 it is the RHI on OpenGL.
+    if (window->rendererInterface()->graphicsApi() != QSGRendererInterface::OpenGL) {
+        return false;
+    }
+    const QOpenGLContext * const context = QOpenGLContext::currentContext();
+    if (!context) {
+        return false;
+    }
+    // Single and two channel textures (GL_R8, GL_RG8) need OpenGL (ES) 3.
+    return (context->format().majorVersion() >= 3);
+#else
+    Q_UNUSED(window);
+    return false;
+#endif
+}
+
+void MDKYuvVideoNode::sync()
+{
+    // Safe to touch the item here: the GUI thread is blocked during sync().
+    {
+        QMutexLocker locker(&m_item->m_planarFrameMutex);
+        if (m_item->m_planarFrameFresh) {
+            std::swap(m_frame, m_item->m_planarFrame);
+            m_item->m_planarFrameFresh = false;
+            m_frameFresh = true;
+        }
+    }
+    const QRectF rect = m_item->boundingRect();
+    const int fillMode = static_cast<int>(m_item->fillMode());
+    const QSizeF videoSize = (m_frame.size.isEmpty() ? m_item->videoSize() : QSizeF(m_frame.size));
+    if ((rect != m_rect) || (fillMode != m_fillMode) || (videoSize != m_videoSize)) {
+        m_rect = rect;
+        m_fillMode = fillMode;
+        m_videoSize = videoSize;
+        updateGeometry();
+    }
+    const auto player = m_player.lock();
+    if (!player) {
+        return;
+    }
+    // MDK still needs a video surface to deliver the frames and to call the
+    // render callback, but renderVideo() is never called: the frames come
+    // from the frame callback and MDK's own renderer stays idle.
+    const qreal dpr = m_window->effectiveDevicePixelRatio();
+    player->setVideoSurfaceSize(qRound(rect.width() * dpr), qRound(rect.height() * dpr), this);
+}
+
+void MDKYuvVideoNode::updateGeometry()
+{
+    QRectF target = m_rect;
+    QRectF source = {0.0, 0.0, 1.0, 1.0};
+    if (m_videoSize.isEmpty() || m_rect.isEmpty() || !m_textures[0]) {
+        target = {};
+    } else if (m_fillMode == static_cast<int>(FillMode::PreserveAspectFit)) {
+        const QSizeF size = m_videoSize.scaled(m_rect.size(), Qt::KeepAspectRatio);
+        target = QRectF(QPointF(m_rect.center().x() - (size.width() / 2.0),
+                                m_rect.center().y() - (size.height() / 2.0)), size);
+    } else if (m_fillMode == static_cast<int>(FillMode::PreserveAspectCrop)) {
+        // Cut the overflowing part off through the texture coordinates.
+        const QSizeF size = m_videoSize.scaled(m_rect.size(), Qt::KeepAspectRatioByExpanding);
+        const qreal width = (m_rect.width() / size.width());
+        const qreal height = (m_rect.height() / size.height());
+        source = QRectF((1.0 - width) / 2.0, (1.0 - height) / 2.0, width, height);
+    }
+    QSGGeometry::updateTexturedRectGeometry(geometry(), target, source);
+    markDirty(DirtyGeometry);
+}
+
+void MDKYuvVideoNode::upload()
+{
+#if QT_CONFIG(opengl)
+    if (!m_frameFresh || (m_frame.planeCount <= 0)) {
+        return;
+    }
+    m_frameFresh = false;
+    QOpenGLContext * const context = QOpenGLContext::currentContext();
+    if (!context) {
+        return;
+    }
+    QOpenGLFunctions * const functions = context->functions();
+    const QSize planeSizes[3] = {m_frame.size, m_frame.chromaSize, m_frame.chromaSize};
+    // NV12 stores U and V interleaved in a two channel texture.
+    const GLenum planeFormats[3] = {GL_RED, (m_frame.nv12 ? GL_RG : GL_RED), GL_RED};
+    const GLint internalFormats[3] = {GL_R8, (m_frame.nv12 ? GL_RG8 : GL_R8), GL_R8};
+    if (!m_textures[0] || (m_textureSize != m_frame.size) || (m_textureNv12 != m_frame.nv12)) {
+        releaseTextures();
+        functions->glGenTextures(m_frame.planeCount, m_textures);
+        for (int i = 0; i != m_frame.planeCount; ++i) {
+            functions->glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+            functions->glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], planeSizes[i].width(), planeSizes[i].height(),
+                                    0, planeFormats[i], GL_UNSIGNED_BYTE, nullptr);
+            functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        m_textureSize = m_frame.size;
+        m_textureNv12 = m_frame.nv12;
+        for (int i = 0; i != 3; ++i) {
+            m_material->textures[i] = m_textures[qMin(i, m_frame.planeCount - 1)];
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+            m_material->planes[i] = QNativeInterface::QSGOpenGLTexture::fromNative(m_material->textures[i], m_window, planeSizes[i]);
+            m_material->planes[i]->setFiltering(QSGTexture::Linear);
+#endif
+        }
+        m_material->colorMatrix = yuvToRgbMatrix(m_frame.size.height());
+        m_material->vSelect = (m_frame.nv12 ? QVector2D(0.0f, 1.0f) : QVector2D(1.0f, 0.0f));
+        markDirty(DirtyMaterial);
+        updateGeometry();
+    }
+    functions->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i != m_frame.planeCount; ++i) {
+        functions->glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+        functions->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, planeSizes[i].width(), planeSizes[i].height(),
+                                   planeFormats[i], GL_UNSIGNED_BYTE, m_frame.planes[i].constData());
+    }
+    functions->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    functions->glBindTexture(GL_TEXTURE_2D, 0);
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    QQuickOpenGLUtils::resetOpenGLState();
+#else
+    m_window->resetOpenGLState();
+#endif
+#endif // QT_CONFIG(opengl)
+}
+
+void MDKYuvVideoNode::releaseTextures()
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    // The same wrapper may be used for U and V.
+    for (int i = 0; i != 3; ++i) {
+        if (m_material->planes[i] && ((i == 0) || (m_material->planes[i] != m_material->planes[i - 1]))) {
+            delete m_material->planes[i];
+        }
+        m_material->planes[i] = nullptr;
+    }
+#endif
+    std::memset(m_material->textures, 0, sizeof(m_material->textures));
+#if QT_CONFIG(opengl)
+    QOpenGLContext * const context = QOpenGLContext::currentContext();
+    if (context && m_textures[0]) {
+        context->functions()->glDeleteTextures(3, m_textures);
+    }
+#endif
+    std::memset(m_textures, 0, sizeof(m_textures));
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
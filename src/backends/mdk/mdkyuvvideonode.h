@@ -0,0 +1,102 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mdkbackend_global.h"
+#include <QtCore/qobject.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qsize.h>
+#include <QtGui/qmatrix4x4.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtQuick/qsgnode.h>
+
+namespace mdk
+{
+class Player;
+}
+
+QT_BEGIN_NAMESPACE
+QT_FORWARD_DECLARE_CLASS(QQuickItem)
+QT_FORWARD_DECLARE_CLASS(QQuickWindow)
+QT_END_NAMESPACE
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+class MDKPlayer;
+class MDKYuvVideoMaterial;
+
+// A decoded frame in host memory, copied out of MDK's frame callback. The
+// planes are tightly packed: Y, U, V for I420 and Y, interleaved UV for NV12.
+struct MDKPlanarFrame
+{
+    QSize size = {};
+    QSize chromaSize = {};
+    bool nv12 = false;
+    int planeCount = 0;
+    QByteArray planes[3] = {};
+};
+
+// Draws MDKPlanarFrames directly: the planes are uploaded as textures and the
+// material converts them to RGB while the scene graph draws the item, so
+// there is no intermediate RGBA render target and no extra full size pass.
+// Only for OpenGL, see isSupported().
+class MDKYuvVideoNode : public QObject, public QSGGeometryNode
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(MDKYuvVideoNode)
+
+public:
+    explicit MDKYuvVideoNode(QQuickItem *item);
+    ~MDKYuvVideoNode() override;
+
+    // Whether the window can use this node, must be called on the render thread.
+    Q_NODISCARD static bool isSupported(QQuickWindow *window);
+
+    void sync();
+
+private Q_SLOTS:
+    void upload();
+
+private:
+    void updateGeometry();
+    void releaseTextures();
+
+private:
+    MDKPlayer *m_item = nullptr;
+    QQuickWindow *m_window = nullptr;
+    QWeakPointer<mdk::Player> m_player;
+    MDKYuvVideoMaterial *m_material = nullptr;
+    // The latest frame handed over by the player, uploaded in upload().
+    MDKPlanarFrame m_frame = {};
+    bool m_frameFresh = false;
+    QSize m_textureSize = {};
+    bool m_textureNv12 = false;
+    uint m_textures[3] = {};
+    QRectF m_rect = {};
+    QSizeF m_videoSize = {};
+    int m_fillMode = 0;
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
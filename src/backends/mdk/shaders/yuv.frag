@@ -0,0 +1,26 @@
+#version 440
+
+layout(location = 0) in vec2 texCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    mat4 colorMatrix;
+    vec2 vSelect;
+    float qt_Opacity;
+};
+
+layout(binding = 1) uniform sampler2D yTexture;
+layout(binding = 2) uniform sampler2D uTexture;
+layout(binding = 3) uniform sampler2D vTexture;
+
+void main()
+{
+    float y = texture(yTexture, texCoord).r;
+    float u = texture(uTexture, texCoord).r;
+    // I420 keeps V in its own texture, NV12 in the green channel of the UV texture.
+    float v = dot(texture(vTexture, texCoord).rg, vSelect);
+    vec4 rgb = colorMatrix * vec4(y, u, v, 1.0);
+    fragColor = vec4(clamp(rgb.rgb, 0.0, 1.0), 1.0) * qt_Opacity;
+}
@@ -27,8 +27,15 @@
 #include <QtCore/qfile.h>
 #include <QtCore/qtextstream.h>
 #include <QtCore/qscopeguard.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qsettings.h>
+#include <QtCore/qstandardpaths.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qdatetime.h>
 #include <QtQuick/qquickwindow.h>
 #include <backendinterface.h>
+#include <videomirror.h>
 #include "mpvplayer.h"
 #include "mpvqthelper.h"
 
@@ -45,12 +52,14 @@ Q_LOGGING_CATEGORY(lcQMPMPV, "wangwenx190.qtmediaplayer.mpv")
 
 static const QString kUnknown = QStringLiteral("Unknown");
 
-[[nodiscard]] static inline QVariant mpvGetProperty(const QString &name)
+struct FFmpegInfo
+{
+    QString version = {};
+    QString configuration = {};
+};
+
+[[nodiscard]] static inline FFmpegInfo probeFFmpegInfo()
 {
-    Q_ASSERT(!name.isEmpty());
-    if (name.isEmpty()) {
-        return {};
-    }
     // If libmpv is not available, no need to continue executing.
     if (!MPV::Qt::isLibmpvAvailable()) {
         return {};
@@ -71,13 +80,155 @@ static const QString kUnknown = QStringLiteral("Unknown");
         qCCritical(lcQMPMPV) << "Failed to initialize the mpv player.";
         return {};
     }
-    const QVariant result = MPV::Qt::get_property(mpv, name);
-    const int errorCode = MPV::Qt::get_error(result);
-    if (!result.isValid() || (errorCode < 0)) {
-        qCWarning(lcQMPMPV) << "Failed to query property" << name << ':' << mpv_error_string(errorCode);
-        return {};
+    const auto getProperty = [mpv](const QString &name) -> QString {
+        const QVariant result = MPV::Qt::get_property(mpv, name);
+        const int errorCode = MPV::Qt::get_error(result);
+        if (!result.isValid() || (errorCode < 0)) {
+            qCWarning(lcQMPMPV) << "Failed to query property" << name << ':' << mpv_error_string(errorCode);
+            return {};
+        }
+        return result.toString();
+    };
+    FFmpegInfo info = {};
+    info.version = getProperty(QStringLiteral("ffmpeg-version"));
+    // libmpv doesn't seem to provide the FFmpeg configuration parameters
+    // , so just return mpv's own configuration parameters instead.
+    info.configuration = getProperty(QStringLiteral("mpv-configuration"));
+    return info;
+}
+
+// Probing needs a whole mpv core, which is way too expensive to do during
+// the application startup, or to wait for on the GUI thread. The result only depends on the libmpv binary, so
+// it's persisted to disk, keyed by the library's path and modification time,
+// and only probed again when the library changes.
+class FFmpegInfoProbe
+{
+    Q_DISABLE_COPY_MOVE(FFmpegInfoProbe)
+
+public:
+    explicit FFmpegInfoProbe() = default;
+
+    ~FFmpegInfoProbe()
+    {
+        if (m_thread) {
+            m_thread->wait();
+            delete m_thread;
+            m_thread = nullptr;
+        }
     }
-    return result;
+
+    void start()
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_thread || m_done) {
+            return;
+        }
+        m_thread = QThread::create([this](){
+            const FFmpegInfo info = load();
+            QMutexLocker locker(&m_mutex);
+            m_info = info;
+            m_done = true;
+        });
+        m_thread->setObjectName(QStringLiteral("MPVFFmpegInfoProbe"));
+        m_thread->start(QThread::LowPriority);
+    }
+
+    // Never waits for the probe, the information is empty until it's done.
+    [[nodiscard]] FFmpegInfo get()
+    {
+        start();
+        QMutexLocker locker(&m_mutex);
+        return m_info;
+    }
+
+    void notify(const QObject *receiver, const std::function<void()> &function)
+    {
+        Q_ASSERT(receiver);
+        Q_ASSERT(function);
+        if (!receiver || !function) {
+            return;
+        }
+        start();
+        QMutexLocker locker(&m_mutex);
+        // The probe sets the flag before its thread finishes, so nothing is
+        // missed as long as we connect while holding the lock.
+        if (m_done || !m_thread) {
+            return;
+        }
+        QObject::connect(m_thread, &QThread::finished, receiver, function);
+    }
+
+private:
+    [[nodiscard]] static QString cacheFilePath()
+    {
+        const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (dir.isEmpty()) {
+            return {};
+        }
+        return (dir + QStringLiteral("/qtmediaplayer_mpv.ini"));
+    }
+
+    [[nodiscard]] static FFmpegInfo load()
+    {
+        const QFileInfo libraryInfo(MPV::Qt::getLibmpvFilePath());
+        const QString cachePath = cacheFilePath();
+        // Without a real file there's nothing we can reliably key the cache on.
+        if (!libraryInfo.isFile() || cachePath.isEmpty()) {
+            return probeFFmpegInfo();
+        }
+        const QString libraryPath = libraryInfo.canonicalFilePath();
+        const qint64 libraryTime = libraryInfo.lastModified().toMSecsSinceEpoch();
+        QSettings cache(cachePath, QSettings::IniFormat);
+        if ((cache.value(QStringLiteral("libmpv/path")).toString() == libraryPath)
+            && (cache.value(QStringLiteral("libmpv/mtime")).toLongLong() == libraryTime)) {
+            FFmpegInfo info = {};
+            info.version = cache.value(QStringLiteral("ffmpeg/version")).toString();
+            info.configuration = cache.value(QStringLiteral("ffmpeg/configuration")).toString();
+            if (!info.version.isEmpty()) {
+                return info;
+            }
+        }
+        const FFmpegInfo info = probeFFmpegInfo();
+        if (!info.version.isEmpty()) {
+            cache.setValue(QStringLiteral("libmpv/path"), libraryPath);
+            cache.setValue(QStringLiteral("libmpv/mtime"), libraryTime);
+            cache.setValue(QStringLiteral("ffmpeg/version"), info.version);
+            cache.setValue(QStringLiteral("ffmpeg/configuration"), info.configuration);
+        }
+        return info;
+    }
+
+private:
+    QMutex m_mutex;
+    QThread *m_thread = nullptr;
+    bool m_done = false;
+    FFmpegInfo m_info = {};
+};
+
+Q_GLOBAL_STATIC(FFmpegInfoProbe, ffmpegInfoProbe)
+
+QString ffmpegInfo_mpv(const QString &key)
+{
+    if (!MPV::Qt::isLibmpvAvailable()) {
+        return kUnknown;
+    }
+    const FFmpegInfo info = ffmpegInfoProbe()->get();
+    // Still probing, the caller will be notified through notifyFFmpegInfo_mpv().
+    QString result = {};
+    if (key == kFFmpegVersion) {
+        result = info.version;
+    } else if (key == kFFmpegConfiguration) {
+        result = info.configuration;
+    }
+    return (result.isEmpty() ? kUnknown : result);
+}
+
+void notifyFFmpegInfo_mpv(const QObject *receiver, const std::function<void()> &function)
+{
+    if (!MPV::Qt::isLibmpvAvailable()) {
+        return;
+    }
+    ffmpegInfoProbe()->notify(receiver, function);
 }
 
 [[nodiscard]] const QVariantHash &metaData_mpv()
@@ -119,27 +270,21 @@ static const QString kUnknown = QStringLiteral("Unknown");
          }()},
         {kHomepage, QStringLiteral("https://mpv.io/")},
         {kLastModifyTime, QString::fromUtf8(__DATE__ __TIME__)},
-        {kLogo, {}}, // ### TODO
-        {kFFmpegVersion, []() -> QString {
-             if (!MPV::Qt::isLibmpvAvailable()) {
-                 return kUnknown;
-             }
-             const QString ver = mpvGetProperty(QStringLiteral("ffmpeg-version")).toString();
-             return (ver.isEmpty() ? kUnknown : ver);
-         }()},
-        {kFFmpegConfiguration, []() -> QString {
-             if (!MPV::Qt::isLibmpvAvailable()) {
-                 return kUnknown;
-             }
-             // libmpv doesn't seem to provide the FFmpeg configuration parameters
-             // , so just return mpv's own configuration parameters instead.
-             const QString ver = mpvGetProperty(QStringLiteral("mpv-configuration")).toString();
-             return (ver.isEmpty() ? kUnknown : ver);
-         }()}
+        {kLogo, {}} // ### TODO
     };
     return result;
 }
 
+// Whether the application (or the user, through the environment) has already
+// selected a scene graph backend which we should not override.
+[[nodiscard]] static inline bool isSceneGraphBackendForced()
+{
+    if (qEnvironmentVariableIsSet("QT_QUICK_BACKEND") || qEnvironmentVariableIsSet("QSG_RHI_BACKEND")) {
+        return true;
+    }
+    return !QQuickWindow::sceneGraphBackend().isEmpty();
+}
+
 class MPVBackend final : public QMPBackend
 {
     Q_DISABLE_COPY_MOVE(MPVBackend)
@@ -171,6 +316,18 @@ public:
 #endif
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
         case QSGRendererInterface::OpenGLRhi: // Equal to QSGRendererInterface::OpenGL in Qt6.
+#endif
+        // Rendered by libmpv's software renderer and uploaded as an image.
+        case QSGRendererInterface::Software:
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+        case QSGRendererInterface::Direct3D11:
+        case QSGRendererInterface::Vulkan:
+        case QSGRendererInterface::Metal:
+#endif
+#if ((QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)) && (QT_VERSION < QT_VERSION_CHECK(6, 0, 0)))
+        case QSGRendererInterface::Direct3D11Rhi:
+        case QSGRendererInterface::VulkanRhi:
+        case QSGRendererInterface::MetalRhi:
 #endif
             return true;
         default:
@@ -202,32 +359,42 @@ public:
         // Qt sets the locale in the QGuiApplication constructor, but libmpv
         // requires the LC_NUMERIC category to be set to "C", so change it back.
         std::setlocale(LC_NUMERIC, "C");
-        // Currently the mpv backend only supports rendering in OpenGL.
+        // Nobody needs the FFmpeg information right now, get it ready in the background.
+        ffmpegInfoProbe()->start();
+        // OpenGL is the only hardware accelerated path of the mpv backend, other
+        // graphics APIs fall back to the (much slower) software renderer. So
+        // prefer OpenGL, unless the user has explicitly chosen something else.
+        if (!isSceneGraphBackendForced()) {
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
-        QQuickWindow::setGraphicsApi(QSGRendererInterface::OpenGL);
+            QQuickWindow::setGraphicsApi(QSGRendererInterface::OpenGL);
 #else
-        // Although there is "QSGRendererInterface::OpenGL", we still prefer
-        // the rhi enum value. They will go through different code paths inside
-        // Qt Quick's scenegraph engine. But there will be no difference between
-        // them since Qt6. It's the old Qt5 story.
-        QQuickWindow::setSceneGraphBackend(QSGRendererInterface::OpenGLRhi);
+            // Although there is "QSGRendererInterface::OpenGL", we still prefer
+            // the rhi enum value. They will go through different code paths inside
+            // Qt Quick's scenegraph engine. But there will be no difference between
+            // them since Qt6. It's the old Qt5 story.
+            QQuickWindow::setSceneGraphBackend(QSGRendererInterface::OpenGLRhi);
 #endif
+        }
         qRegisterMetaType<PlaybackState>();
         qRegisterMetaType<MediaStatusFlag>();
         qRegisterMetaType<MediaStatus>();
         qRegisterMetaType<LogLevel>();
         qRegisterMetaType<FillMode>();
+        qRegisterMetaType<TrackType>();
         qRegisterMetaType<ChapterInfo>();
         qRegisterMetaType<Chapters>();
         qRegisterMetaType<MetaData>();
         qRegisterMetaType<MediaTracks>();
         qRegisterMetaType<MediaInfo>();
+        qRegisterMetaType<PresentationClock>();
         qRegisterMetaType<MPVPlayer>();
         qRegisterMetaType<MPV::Qt::ErrorReturn>();
         qmlRegisterUncreatableMetaObject(staticMetaObject, QTMEDIAPLAYER_QML_URI, 1, 0, "QtMediaPlayer",
               QStringLiteral("QtMediaPlayer is not creatable, it's only used for accessing enums & flags."));
         qmlRegisterUncreatableType<MediaInfo>(QTMEDIAPLAYER_QML_URI, 1, 0, "MediaInfo", QStringLiteral("MediaInfo is not creatable."));
+        qmlRegisterUncreatableType<PresentationClock>(QTMEDIAPLAYER_QML_URI, 1, 0, "PresentationClock", QStringLiteral("PresentationClock is not creatable."));
         qmlRegisterType<MPVPlayer>(QTMEDIAPLAYER_QML_URI, 1, 0, "MediaPlayer");
+        qmlRegisterType<VideoMirror>(QTMEDIAPLAYER_QML_URI, 1, 0, "VideoMirror");
         qmlRegisterModule(QTMEDIAPLAYER_QML_URI, 1, 0);
         return true;
     }
@@ -25,10 +25,21 @@
 #pragma once
 
 #include "mpvbackend_global.h"
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QObject;
+QT_END_NAMESPACE
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
 class QMPBackend;
 [[nodiscard]] const QVariantHash &metaData_mpv();
+// kFFmpegVersion and kFFmpegConfiguration are not part of metaData_mpv(),
+// querying them needs a running mpv core, so they are probed in the
+// background. "Unknown" is returned until the probe has finished, the
+// function is then called in the receiver's thread.
+[[nodiscard]] QString ffmpegInfo_mpv(const QString &key);
+void notifyFFmpegInfo_mpv(const QObject *receiver, const std::function<void()> &function);
 QTMEDIAPLAYER_END_NAMESPACE
 
 #ifdef QTMEDIAPLAYER_PLUGIN_STATIC
@@ -0,0 +1,332 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpveventthread.h"
+#include "mpvplayer.h"
+#include "mpvqthelper.h"
+#include "mpvnodedecoder.h"
+#include <logsink.h>
+#include <cstring>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+[[nodiscard]] static inline MPVEvent decodeEvent(mpv_handle *mpv, const mpv_event *event)
+{
+    Q_ASSERT(event);
+    MPVEvent result = {};
+    if (!event) {
+        return result;
+    }
+    result.id = event->event_id;
+    result.error = event->error;
+    result.replyUserdata = event->reply_userdata;
+    switch (event->event_id) {
+    case MPV_EVENT_PROPERTY_CHANGE: {
+        const auto prop = static_cast<const mpv_event_property *>(event->data);
+        if (!prop) {
+            break;
+        }
+        // The format is MPV_FORMAT_NONE if the property is not available at
+        // the moment (for example, "duration" when nothing is loaded).
+        result.format = (prop->data ? prop->format : MPV_FORMAT_NONE);
+        switch (result.format) {
+        case MPV_FORMAT_DOUBLE:
+            result.realValue = *static_cast<const double *>(prop->data);
+            break;
+        case MPV_FORMAT_INT64:
+            result.int64Value = *static_cast<const int64_t *>(prop->data);
+            break;
+        case MPV_FORMAT_FLAG:
+            result.boolValue = (*static_cast<const int *>(prop->data) != 0);
+            break;
+        case MPV_FORMAT_STRING:
+            result.stringValue = QString::fromUtf8(*static_cast<char * const *>(prop->data));
+            break;
+        case MPV_FORMAT_NODE: {
+            const auto node = static_cast<const mpv_node *>(prop->data);
+            // The big lists are decoded into the player types right here, so
+            // the GUI thread doesn't have to walk them a second time.
+            if (std::strcmp(prop->name, "track-list") == 0) {
+                result.nodeValue = QVariant::fromValue(mediaTracksFromMpvNode(node));
+            } else if (std::strcmp(prop->name, "chapter-list") == 0) {
+                result.nodeValue = QVariant::fromValue(chaptersFromMpvNode(node));
+            } else if (std::strcmp(prop->name, "metadata") == 0) {
+                result.nodeValue = QVariant::fromValue(metaDataFromMpvNode(node));
+            } else {
+                result.nodeValue = MPV::Qt::node_to_variant(node);
+            }
+        } break;
+        default:
+            result.format = MPV_FORMAT_NONE;
+            break;
+        }
+    } break;
+    case MPV_EVENT_END_FILE: {
+        const auto end = static_cast<const mpv_event_end_file *>(event->data);
+        if (!end) {
+            break;
+        }
+        result.endFileReason = end->reason;
+        if (end->reason == MPV_END_FILE_REASON_ERROR) {
+            result.error = end->error;
+        }
+    } break;
+    case MPV_EVENT_COMMAND_REPLY: {
+        const auto command = static_cast<const mpv_event_command *>(event->data);
+        if (!command) {
+            break;
+        }
+        // Only "screenshot-raw" replies with a map containing the pixels.
+        if (command->result.format == MPV_FORMAT_NODE_MAP) {
+            result.image = imageFromMpvNode(&command->result);
+        }
+    } break;
+    case MPV_EVENT_PLAYBACK_RESTART: {
+        // The "time-pos" change usually arrives after the restart, so the
+        // position the seek landed on is read right here.
+        double timePos = 0.0;
+        if (mpv_get_property(mpv, "time-pos", MPV_FORMAT_DOUBLE, &timePos) >= 0) {
+            result.format = MPV_FORMAT_DOUBLE;
+            result.realValue = timePos;
+        }
+    } break;
+    case MPV_EVENT_HOOK: {
+        const auto hook = static_cast<const mpv_event_hook *>(event->data);
+        if (!hook) {
+            break;
+        }
+        result.hookId = hook->id;
+        // The only hook is "on_preloaded": the tracks are known, but the
+        // video size isn't. Read them here, not on the GUI thread.
+        mpv_node tracks = {};
+        if (mpv_get_property(mpv, "track-list", MPV_FORMAT_NODE, &tracks) >= 0) {
+            result.nodeValue = QVariant::fromValue(mediaTracksFromMpvNode(&tracks));
+            mpv_free_node_contents(&tracks);
+        }
+    } break;
+    default:
+        break;
+    }
+    return result;
+}
+
+[[nodiscard]] static inline QtMsgType logMessageType(const mpv_log_level level)
+{
+    switch (level) {
+    case MPV_LOG_LEVEL_WARN:
+        return QtWarningMsg;
+    case MPV_LOG_LEVEL_ERROR:
+    case MPV_LOG_LEVEL_FATAL:
+        return QtCriticalMsg;
+    case MPV_LOG_LEVEL_INFO:
+        return QtInfoMsg;
+    default:
+        break;
+    }
+    return QtDebugMsg;
+}
+
+// Log messages don't need the GUI thread at all, they go straight to the
+// log sink, which copies the raw bytes and formats them on its own thread.
+static inline void postLogMessage(const mpv_event *event, const MPVPlayer *player)
+{
+    const auto msg = static_cast<const mpv_event_log_message *>(event->data);
+    if (!msg) {
+        return;
+    }
+    const QtMsgType type = logMessageType(msg->log_level);
+    if (!LogSink::isEnabled(lcQMPMPV(), type)) {
+        return;
+    }
+    LogSink::instance()->post(lcQMPMPV(), type, msg->prefix, msg->text, reinterpret_cast<quintptr>(player));
+}
+
+static inline void appendEvent(MPVEventList &events, MPVPropertyIndex &index, MPVEvent &&event)
+{
+    // Only the latest value of a property is interesting, so a property that
+    // changed several times since the last wake up is only delivered once.
+    // The new value takes the place of the old one, the order relative to
+    // the other events in the batch is kept.
+    if (event.id == MPV_EVENT_PROPERTY_CHANGE) {
+        const auto it = index.constFind(event.replyUserdata);
+        if (it != index.constEnd()) {
+            events[it.value()] = std::move(event);
+            return;
+        }
+        index.insert(event.replyUserdata, events.size());
+    }
+    events.append(std::move(event));
+}
+
+QVariant MPVEvent::value() const
+{
+    switch (format) {
+    case MPV_FORMAT_DOUBLE:
+        return realValue;
+    case MPV_FORMAT_INT64:
+        return int64Value;
+    case MPV_FORMAT_FLAG:
+        return boolValue;
+    case MPV_FORMAT_STRING:
+        return stringValue;
+    case MPV_FORMAT_NODE:
+        return nodeValue;
+    default:
+        break;
+    }
+    return {};
+}
+
+MPVEventThread::MPVEventThread(mpv_handle *mpv, MPVPlayer *player, QObject *parent) : QThread(parent)
+{
+    Q_ASSERT(mpv);
+    Q_ASSERT(player);
+    m_mpv = mpv;
+    m_player = player;
+    setObjectName(QStringLiteral("MPVEventThread"));
+}
+
+MPVEventThread::~MPVEventThread()
+{
+    stop();
+}
+
+void MPVEventThread::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+    requestInterruption();
+    // If nobody is waiting at the moment, the next mpv_wait_event() call
+    // will return immediately, so there's no race here.
+    mpv_wakeup(m_mpv);
+    wait();
+}
+
+MPVEventList MPVEventThread::takePendingEvents()
+{
+    const QMutexLocker locker(&m_mutex);
+    MPVEventList events = {};
+    events.swap(m_pendingEvents);
+    m_pendingPropertyIndex.clear();
+    // Cleared while holding the lock, so events appended after this point
+    // always post a new drain.
+    m_drainPending.storeRelease(0);
+    return events;
+}
+
+void MPVEventThread::continueHook(const quint64 id)
+{
+    {
+        const QMutexLocker locker(&m_mutex);
+        m_pendingHooks.append(id);
+    }
+    mpv_wakeup(m_mpv);
+}
+
+quint64 MPVEventThread::postedWakeups() const
+{
+    return m_postedWakeups.loadRelaxed();
+}
+
+quint64 MPVEventThread::coalescedWakeups() const
+{
+    return m_coalescedWakeups.loadRelaxed();
+}
+
+void MPVEventThread::postEvents(MPVEventList &&events, MPVPropertyIndex &&index)
+{
+    {
+        const QMutexLocker locker(&m_mutex);
+        if (m_pendingEvents.isEmpty()) {
+            m_pendingEvents = std::move(events);
+            m_pendingPropertyIndex = std::move(index);
+        } else {
+            for (auto &&event : events) {
+                appendEvent(m_pendingEvents, m_pendingPropertyIndex, std::move(event));
+            }
+        }
+    }
+    // Only one drain may be queued at any time, the GUI thread picks up
+    // everything that has been collected when it gets to it.
+    if (!m_drainPending.testAndSetAcquire(0, 1)) {
+        m_coalescedWakeups.fetchAndAddRelaxed(1);
+        return;
+    }
+    m_postedWakeups.fetchAndAddRelaxed(1);
+    QMetaObject::invokeMethod(m_player, &MPVPlayer::drainMpvEvents, Qt::QueuedConnection);
+}
+
+void MPVEventThread::continuePendingHooks()
+{
+    QVector<quint64> hooks = {};
+    {
+        const QMutexLocker locker(&m_mutex);
+        hooks.swap(m_pendingHooks);
+    }
+    for (auto &&id : qAsConst(hooks)) {
+        mpv_hook_continue(m_mpv, id);
+    }
+}
+
+void MPVEventThread::run()
+{
+    Q_ASSERT(m_mpv);
+    Q_ASSERT(m_player);
+    if (!m_mpv || !m_player) {
+        return;
+    }
+    while (!isInterruptionRequested()) {
+        // Block until something happens. A negative timeout means no timeout.
+        const mpv_event *event = mpv_wait_event(m_mpv, -1);
+        if (!event) {
+            break;
+        }
+        continuePendingHooks();
+        // Drain everything that is already queued, so the GUI thread only
+        // gets one batch per wake up.
+        MPVEventList events = {};
+        MPVPropertyIndex index = {};
+        bool shutdown = false;
+        while (event && (event->event_id != MPV_EVENT_NONE)) {
+            if (event->event_id == MPV_EVENT_SHUTDOWN) {
+                shutdown = true;
+            }
+            if (event->event_id == MPV_EVENT_LOG_MESSAGE) {
+                postLogMessage(event, m_player);
+            } else {
+                appendEvent(events, index, decodeEvent(m_mpv, event));
+            }
+            event = mpv_wait_event(m_mpv, 0);
+        }
+        if (!events.isEmpty()) {
+            postEvents(std::move(events), std::move(index));
+        }
+        if (shutdown) {
+            break;
+        }
+    }
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
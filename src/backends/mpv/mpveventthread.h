@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mpvbackend_global.h"
+#include "include/mpv/client.h"
+#include <QtCore/qthread.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qvector.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qatomic.h>
+#include <QtGui/qimage.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+class MPVPlayer;
+
+// The event returned by mpv_wait_event() is only valid until the next call of
+// it, so everything the player needs is copied out on the event thread.
+struct MPVEvent
+{
+    mpv_event_id id = MPV_EVENT_NONE;
+    int error = 0;
+    quint64 replyUserdata = 0;
+
+    // MPV_EVENT_PROPERTY_CHANGE, identified by replyUserdata, and the
+    // position of MPV_EVENT_PLAYBACK_RESTART.
+    mpv_format format = MPV_FORMAT_NONE;
+    qreal realValue = 0.0;
+    qint64 int64Value = 0;
+    bool boolValue = false;
+    QString stringValue = {};
+    QVariant nodeValue = {};
+
+    // MPV_EVENT_END_FILE
+    mpv_end_file_reason endFileReason = MPV_END_FILE_REASON_EOF;
+
+    // MPV_EVENT_HOOK, must be passed back to mpv_hook_continue(). The track
+    // list is in nodeValue.
+    quint64 hookId = 0;
+
+    // MPV_EVENT_COMMAND_REPLY of "screenshot-raw", converted here so the GUI
+    // thread doesn't have to copy the pixels.
+    QImage image = {};
+
+    [[nodiscard]] QVariant value() const;
+};
+
+using MPVEventList = QVector<MPVEvent>;
+// Where the property change of each observed property sits in a batch.
+using MPVPropertyIndex = QHash<quint64, int>;
+
+class MPVEventThread : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(MPVEventThread)
+
+public:
+    explicit MPVEventThread(mpv_handle *mpv, MPVPlayer *player, QObject *parent = nullptr);
+    ~MPVEventThread() override;
+
+    void stop();
+
+    // Called on the GUI thread by the queued drain. Returns everything that
+    // has been collected since the last call and allows a new drain to be
+    // posted.
+    Q_NODISCARD MPVEventList takePendingEvents();
+
+    // Called on the GUI thread once a hook has been handled. The hook is
+    // continued on the event thread, mpv_hook_continue() waits for the core.
+    void continueHook(const quint64 id);
+
+    // Diagnostics: how many wake ups posted a drain to the GUI thread and how
+    // many were merged into a drain that was still pending.
+    Q_NODISCARD quint64 postedWakeups() const;
+    Q_NODISCARD quint64 coalescedWakeups() const;
+
+protected:
+    void run() override;
+
+private:
+    void postEvents(MPVEventList &&events, MPVPropertyIndex &&index);
+    void continuePendingHooks();
+
+private:
+    mpv_handle *m_mpv = nullptr;
+    MPVPlayer *m_player = nullptr;
+    QMutex m_mutex;
+    MPVEventList m_pendingEvents = {};
+    MPVPropertyIndex m_pendingPropertyIndex = {};
+    QVector<quint64> m_pendingHooks = {};
+    QAtomicInt m_drainPending = 0;
+    QAtomicInteger<quint64> m_postedWakeups = 0;
+    QAtomicInteger<quint64> m_coalescedWakeups = 0;
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,359 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvnodedecoder.h"
+#include "mpvqthelper.h"
+#include "include/mpv/client.h"
+#include <cstring>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+enum class TrackKind
+{
+    Unknown,
+    Video,
+    Audio,
+    Subtitle
+};
+
+// Keys of a "track-list" entry we are interested in, in the order of the
+// trackKeys table below.
+enum TrackKey : int
+{
+    kTrackId = 0,
+    kTrackType,
+    kTrackSrcId,
+    kTrackLang,
+    kTrackTitle,
+    kTrackDefault,
+    kTrackForced,
+    kTrackCodec,
+    kTrackExternal,
+    kTrackExternalFilename,
+    kTrackSelected,
+    kTrackDecoderDesc,
+    kTrackAlbumArt,
+    kTrackImage,
+    kTrackMainSelection,
+    kTrackFFIndex,
+    kTrackDemuxW,
+    kTrackDemuxH,
+    kTrackDemuxFps,
+    kTrackDemuxRotation,
+    kTrackDemuxPar,
+    kTrackDemuxChannelCount,
+    kTrackDemuxChannels,
+    kTrackDemuxSampleRate,
+    kTrackDemuxBitrate,
+    kTrackKeyCount
+};
+
+// Which kind of track a key is reported for. Common keys use Unknown.
+struct TrackKeyInfo
+{
+    const char *name;
+    TrackKind kind;
+};
+
+static constexpr const TrackKeyInfo trackKeys[] = {
+    {"id", TrackKind::Unknown},
+    {"type", TrackKind::Unknown},
+    {"src-id", TrackKind::Unknown},
+    {"lang", TrackKind::Unknown},
+    {"title", TrackKind::Unknown},
+    {"default", TrackKind::Unknown},
+    {"forced", TrackKind::Unknown},
+    {"codec", TrackKind::Unknown},
+    {"external", TrackKind::Unknown},
+    {"external-filename", TrackKind::Unknown},
+    {"selected", TrackKind::Unknown},
+    {"decoder-desc", TrackKind::Unknown},
+    {"albumart", TrackKind::Unknown},
+    {"image", TrackKind::Unknown},
+    {"main-selection", TrackKind::Unknown},
+    {"ff-index", TrackKind::Unknown},
+    {"demux-w", TrackKind::Video},
+    {"demux-h", TrackKind::Video},
+    {"demux-fps", TrackKind::Video},
+    {"demux-rotation", TrackKind::Video},
+    {"demux-par", TrackKind::Video},
+    {"demux-channel-count", TrackKind::Audio},
+    {"demux-channels", TrackKind::Audio},
+    {"demux-samplerate", TrackKind::Audio},
+    {"demux-bitrate", TrackKind::Audio}
+};
+static_assert((sizeof(trackKeys) / sizeof(trackKeys[0])) == kTrackKeyCount);
+
+[[nodiscard]] static inline const QString *trackKeyStrings()
+{
+    // Built once, so the resulting hashes share the key strings.
+    static const QString strings[kTrackKeyCount] = {
+        QStringLiteral("id"), QStringLiteral("type"), QStringLiteral("src-id"),
+        QStringLiteral("lang"), QStringLiteral("title"), QStringLiteral("default"),
+        QStringLiteral("forced"), QStringLiteral("codec"), QStringLiteral("external"),
+        QStringLiteral("external-filename"), QStringLiteral("selected"),
+        QStringLiteral("decoder-desc"), QStringLiteral("albumart"), QStringLiteral("image"),
+        QStringLiteral("main-selection"), QStringLiteral("ff-index"),
+        QStringLiteral("demux-w"), QStringLiteral("demux-h"), QStringLiteral("demux-fps"),
+        QStringLiteral("demux-rotation"), QStringLiteral("demux-par"),
+        QStringLiteral("demux-channel-count"), QStringLiteral("demux-channels"),
+        QStringLiteral("demux-samplerate"), QStringLiteral("demux-bitrate")
+    };
+    return strings;
+}
+
+[[nodiscard]] static inline int trackKeyFromName(const char *name)
+{
+    for (int i = 0; i != kTrackKeyCount; ++i) {
+        if (std::strcmp(trackKeys[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+[[nodiscard]] static inline TrackKind trackKindFromName(const char *name)
+{
+    if (std::strcmp(name, "video") == 0) {
+        return TrackKind::Video;
+    }
+    if (std::strcmp(name, "audio") == 0) {
+        return TrackKind::Audio;
+    }
+    if (std::strcmp(name, "sub") == 0) {
+        return TrackKind::Subtitle;
+    }
+    return TrackKind::Unknown;
+}
+
+[[nodiscard]] static inline QVariant scalarNodeToVariant(const mpv_node *node)
+{
+    switch (node->format) {
+    case MPV_FORMAT_STRING:
+        return QString::fromUtf8(node->u.string);
+    case MPV_FORMAT_FLAG:
+        return static_cast<bool>(node->u.flag);
+    case MPV_FORMAT_INT64:
+        return static_cast<qint64>(node->u.int64);
+    case MPV_FORMAT_DOUBLE:
+        return static_cast<qreal>(node->u.double_);
+    default:
+        break;
+    }
+    // Not expected for the lists we decode, but don't lose the data.
+    return MPV::Qt::node_to_variant(node);
+}
+
+[[nodiscard]] static inline bool isNodeList(const mpv_node *node, const mpv_format format)
+{
+    return (node && (node->format == format) && node->u.list);
+}
+
+MediaTracks mediaTracksFromMpvNode(const mpv_node *node)
+{
+    if (!isNodeList(node, MPV_FORMAT_NODE_ARRAY)) {
+        return {};
+    }
+    const QString *keyStrings = trackKeyStrings();
+    MediaTracks result = {};
+    const mpv_node_list *list = node->u.list;
+    for (int i = 0; i != list->num; ++i) {
+        const mpv_node *track = &list->values[i];
+        if (!isNodeList(track, MPV_FORMAT_NODE_MAP) || (track->u.list->num <= 0)) {
+            continue;
+        }
+        const mpv_node_list *map = track->u.list;
+        QVariant values[kTrackKeyCount] = {};
+        TrackKind kind = TrackKind::Unknown;
+        for (int j = 0; j != map->num; ++j) {
+            const int key = trackKeyFromName(map->keys[j]);
+            if (key < 0) {
+                continue;
+            }
+            const mpv_node *value = &map->values[j];
+            if (key == kTrackType) {
+                if (value->format == MPV_FORMAT_STRING) {
+                    kind = trackKindFromName(value->u.string);
+                }
+                continue;
+            }
+            values[key] = scalarNodeToVariant(value);
+        }
+        if (kind == TrackKind::Unknown) {
+            continue;
+        }
+        switch (kind) {
+        case TrackKind::Video:
+            values[kTrackType] = QStringLiteral("video");
+            break;
+        case TrackKind::Audio:
+            values[kTrackType] = QStringLiteral("audio");
+            break;
+        case TrackKind::Subtitle:
+            values[kTrackType] = QStringLiteral("sub");
+            break;
+        case TrackKind::Unknown:
+            break;
+        }
+        const QString lang = values[kTrackLang].toString();
+        values[kTrackLang] = lang;
+        if (values[kTrackTitle].toString().isEmpty()) {
+            if (lang != QStringLiteral("und")) {
+                values[kTrackTitle] = lang;
+            } else if (!values[kTrackExternal].toBool()) {
+                values[kTrackTitle] = QStringLiteral("[internal]");
+            } else {
+                values[kTrackTitle] = QStringLiteral("[untitled]");
+            }
+        }
+        QVariantHash info = {};
+        info.reserve(kTrackKeyCount);
+        for (int key = 0; key != kTrackKeyCount; ++key) {
+            if ((trackKeys[key].kind != TrackKind::Unknown) && (trackKeys[key].kind != kind)) {
+                continue;
+            }
+            info.insert(keyStrings[key], values[key]);
+        }
+        switch (kind) {
+        case TrackKind::Video:
+            result.video.append(info);
+            break;
+        case TrackKind::Audio:
+            result.audio.append(info);
+            break;
+        case TrackKind::Subtitle:
+            result.subtitle.append(info);
+            break;
+        case TrackKind::Unknown:
+            break;
+        }
+    }
+    return result;
+}
+
+Chapters chaptersFromMpvNode(const mpv_node *node)
+{
+    if (!isNodeList(node, MPV_FORMAT_NODE_ARRAY)) {
+        return {};
+    }
+    Chapters result = {};
+    const mpv_node_list *list = node->u.list;
+    result.reserve(list->num);
+    for (int i = 0; i != list->num; ++i) {
+        const mpv_node *chapter = &list->values[i];
+        if (!isNodeList(chapter, MPV_FORMAT_NODE_MAP) || (chapter->u.list->num <= 0)) {
+            continue;
+        }
+        const mpv_node_list *map = chapter->u.list;
+        ChapterInfo info = {};
+        for (int j = 0; j != map->num; ++j) {
+            const char *key = map->keys[j];
+            const mpv_node *value = &map->values[j];
+            if (std::strcmp(key, "title") == 0) {
+                if (value->format == MPV_FORMAT_STRING) {
+                    info.title = QString::fromUtf8(value->u.string);
+                }
+            } else if (std::strcmp(key, "time") == 0) {
+                if (value->format == MPV_FORMAT_DOUBLE) {
+                    info.startTime = qRound64(value->u.double_ * 1000.0);
+                } else if (value->format == MPV_FORMAT_INT64) {
+                    info.startTime = static_cast<qint64>(value->u.int64) * 1000;
+                }
+            }
+        }
+        info.endTime = 0; // ### FIXME
+        result.append(info);
+    }
+    return result;
+}
+
+MetaData metaDataFromMpvNode(const mpv_node *node)
+{
+    if (!isNodeList(node, MPV_FORMAT_NODE_MAP)) {
+        return {};
+    }
+    MetaData result = {};
+    const mpv_node_list *map = node->u.list;
+    result.reserve(map->num);
+    for (int i = 0; i != map->num; ++i) {
+        result.insert(QString::fromUtf8(map->keys[i]), scalarNodeToVariant(&map->values[i]));
+    }
+    return result;
+}
+
+QImage imageFromMpvNode(const mpv_node *node)
+{
+    if (!isNodeList(node, MPV_FORMAT_NODE_MAP)) {
+        return {};
+    }
+    const mpv_node_list *map = node->u.list;
+    qint64 width = 0;
+    qint64 height = 0;
+    qint64 stride = 0;
+    const char *format = nullptr;
+    const mpv_byte_array *data = nullptr;
+    for (int i = 0; i != map->num; ++i) {
+        const char *key = map->keys[i];
+        const mpv_node *value = &map->values[i];
+        if (value->format == MPV_FORMAT_INT64) {
+            if (std::strcmp(key, "w") == 0) {
+                width = value->u.int64;
+            } else if (std::strcmp(key, "h") == 0) {
+                height = value->u.int64;
+            } else if (std::strcmp(key, "stride") == 0) {
+                stride = value->u.int64;
+            }
+        } else if ((value->format == MPV_FORMAT_STRING) && (std::strcmp(key, "format") == 0)) {
+            format = value->u.string;
+        } else if ((value->format == MPV_FORMAT_BYTE_ARRAY) && (std::strcmp(key, "data") == 0)) {
+            data = value->u.ba;
+        }
+    }
+    if ((width <= 0) || (height <= 0) || (stride <= 0) || !format || !data || !data->data) {
+        return {};
+    }
+    if (static_cast<qint64>(data->size) < (stride * height)) {
+        return {};
+    }
+    // The byte order is fixed, these match on little endian machines only
+    // for the 32-bit formats.
+    QImage::Format imageFormat = QImage::Format_Invalid;
+    if (std::strcmp(format, "bgr0") == 0) {
+        imageFormat = QImage::Format_RGB32;
+    } else if (std::strcmp(format, "bgra") == 0) {
+        imageFormat = QImage::Format_ARGB32_Premultiplied;
+    } else if (std::strcmp(format, "rgba") == 0) {
+        imageFormat = QImage::Format_RGBA8888_Premultiplied;
+    } else if (std::strcmp(format, "rgba64") == 0) {
+        imageFormat = QImage::Format_RGBA64_Premultiplied;
+    }
+    if (imageFormat == QImage::Format_Invalid) {
+        return {};
+    }
+    // mpv frees the data together with the event.
+    return QImage(static_cast<const uchar *>(data->data), static_cast<int>(width), static_cast<int>(height),
+                  static_cast<int>(stride), imageFormat).copy();
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,46 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mpvbackend_global.h"
+#include <playertypes.h>
+#include <QtGui/qimage.h>
+
+struct mpv_node;
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// Decoders that walk the mpv_node trees of "track-list", "chapter-list" and
+// "metadata" once and fill the player types directly, without building the
+// generic QVariantList/QVariantMap representation first.
+[[nodiscard]] MediaTracks mediaTracksFromMpvNode(const mpv_node *node);
+[[nodiscard]] Chapters chaptersFromMpvNode(const mpv_node *node);
+[[nodiscard]] MetaData metaDataFromMpvNode(const mpv_node *node);
+
+// The reply of the "screenshot-raw" command, copied into an image that owns
+// its data. Null if the node isn't a raw screenshot.
+[[nodiscard]] QImage imageFromMpvNode(const mpv_node *node);
+
+QTMEDIAPLAYER_END_NAMESPACE
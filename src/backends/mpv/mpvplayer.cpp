@@ -25,26 +25,113 @@
 #include "mpvplayer.h"
 #include "mpvbackend.h"
 #include "mpvqthelper.h"
+#include "mpveventthread.h"
+#include "mpvstreamsource.h"
 #include "mpvvideotexturenode.h"
 #include <backendinterface.h>
 #include "include/mpv/render.h"
 #include <QtCore/qdebug.h>
 #include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
 #include <QtQuick/qquickwindow.h>
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
 
-static inline void wakeup(void *ctx)
-{
-    Q_ASSERT(ctx);
-    if (!ctx) {
-        return;
+// The observed properties are registered with their index in this table as
+// reply_userdata, so a property change can be dispatched without looking at
+// its name.
+enum ObservedPropertyId : quint64
+{
+    kPropDWidth,
+    kPropDHeight,
+    kPropDuration,
+    kPropTimePos,
+    kPropVolume,
+    kPropMute,
+    kPropSeekable,
+    kPropHwdec,
+    kPropHwdecCurrent,
+    kPropAspect,
+    kPropSpeed,
+    kPropFileName,
+    kPropScreenshotFormat,
+    kPropScreenshotTemplate,
+    kPropScreenshotDirectory,
+    kPropPath,
+    kPropPause,
+    kPropIdleActive,
+    kPropTrackList,
+    kPropChapterList,
+    kPropMetaData,
+    kPropVideoUnscaled,
+    kPropKeepAspect,
+    kPropVid,
+    kPropAid,
+    kPropSid,
+    kPropSkipLoopFilter,
+    kPropLavcFast,
+    kPropCount
+};
+
+struct ObservedProperty
+{
+    const char *name = nullptr;
+    // The native format the value is delivered in. MPV_FORMAT_NONE means the
+    // property is only used as a change notification.
+    mpv_format format = MPV_FORMAT_NONE;
+    // nullptr if the property is only cached.
+    void (MediaPlayer::*notifySignal)() = nullptr;
+    // These properties are changing all the time during the playback process.
+    // So we don't output them, otherwise we'll get huge message floods.
+    bool noisy = false;
+};
+
+static constexpr const ObservedProperty observedProperties[] =
+{
+    {"dwidth", MPV_FORMAT_INT64, &MediaPlayer::videoSizeChanged, false},
+    {"dheight", MPV_FORMAT_INT64, &MediaPlayer::videoSizeChanged, false},
+    {"duration", MPV_FORMAT_DOUBLE, &MediaPlayer::durationChanged, false},
+    {"time-pos", MPV_FORMAT_DOUBLE, &MediaPlayer::positionChanged, true},
+    {"volume", MPV_FORMAT_DOUBLE, &MediaPlayer::volumeChanged, false},
+    {"mute", MPV_FORMAT_FLAG, &MediaPlayer::muteChanged, false},
+    {"seekable", MPV_FORMAT_FLAG, &MediaPlayer::seekableChanged, false},
+    {"hwdec", MPV_FORMAT_NONE, &MediaPlayer::hardwareDecodingChanged, false},
+    {"hwdec-current", MPV_FORMAT_STRING, &MediaPlayer::hardwareDecodingChanged, false},
+    {"video-out-params/aspect", MPV_FORMAT_DOUBLE, &MediaPlayer::aspectRatioChanged, false},
+    {"speed", MPV_FORMAT_DOUBLE, &MediaPlayer::playbackRateChanged, false},
+    {"filename", MPV_FORMAT_STRING, &MediaPlayer::fileNameChanged, false},
+    {"screenshot-format", MPV_FORMAT_STRING, &MediaPlayer::snapshotFormatChanged, false},
+    {"screenshot-template", MPV_FORMAT_STRING, &MediaPlayer::snapshotTemplateChanged, false},
+    {"screenshot-directory", MPV_FORMAT_STRING, &MediaPlayer::snapshotDirectoryChanged, false},
+    {"path", MPV_FORMAT_STRING, &MediaPlayer::filePathChanged, false},
+    {"pause", MPV_FORMAT_FLAG, &MediaPlayer::playbackStateChanged, false},
+    {"idle-active", MPV_FORMAT_FLAG, &MediaPlayer::playbackStateChanged, false},
+    {"track-list", MPV_FORMAT_NODE, &MediaPlayer::mediaTracksChanged, false},
+    {"chapter-list", MPV_FORMAT_NODE, &MediaPlayer::chaptersChanged, false},
+    {"metadata", MPV_FORMAT_NODE, &MediaPlayer::metaDataChanged, false},
+    {"video-unscaled", MPV_FORMAT_STRING, &MediaPlayer::fillModeChanged, false},
+    {"keepaspect", MPV_FORMAT_FLAG, &MediaPlayer::fillModeChanged, false},
+    {"vid", MPV_FORMAT_INT64, &MediaPlayer::activeVideoTrackChanged, false},
+    {"aid", MPV_FORMAT_INT64, &MediaPlayer::activeAudioTrackChanged, false},
+    {"sid", MPV_FORMAT_INT64, &MediaPlayer::activeSubtitleTrackChanged, false},
+    {"vd-lavc-skiploopfilter", MPV_FORMAT_STRING, nullptr, false},
+    {"vd-lavc-fast", MPV_FORMAT_FLAG, nullptr, false}
+};
+
+static_assert((sizeof(observedProperties) / sizeof(observedProperties[0])) == kPropCount);
+
+// reply_userdata of the "on_preloaded" hook.
+static constexpr const quint64 kAdaptiveResolutionHook = 1;
+
+[[nodiscard]] static inline QSizeF videoSizeFromTracks(const MediaTracks &tracks)
+{
+    for (auto &&track : qAsConst(tracks.video)) {
+        if (track.value(QStringLiteral("albumart")).toBool()) {
+            continue;
+        }
+        return {track.value(QStringLiteral("demux-w")).toReal(), track.value(QStringLiteral("demux-h")).toReal()};
     }
-    // This callback is invoked from any mpv thread (but possibly also
-    // recursively from a thread that is calling the mpv API). Just notify
-    // the Qt GUI thread to wake up (so that it can process events with
-    // mpv_wait_event()), and return as quickly as possible.
-    QMetaObject::invokeMethod(static_cast<MPVPlayer *>(ctx), "hasMpvEvents", Qt::QueuedConnection);
+    return {};
 }
 
 MPVPlayer::MPVPlayer(QQuickItem *parent) : MediaPlayer(parent)
@@ -112,28 +199,36 @@ void MPVPlayer::initialize()
         qCWarning(lcQMPMPV) << "Failed to set \"hwdec\" to \"no\".";
     }
 
-    auto it = properties.constBegin();
-    while (it != properties.constEnd()) {
-        const QString propName = it.key();
-        if (!mpvObserveProperty(propName)) {
-            qCWarning(lcQMPMPV) << "Failed to observe property" << propName;
+    for (quint64 id = 0; id != kPropCount; ++id) {
+        if (!mpvObserveProperty(id)) {
+            qCWarning(lcQMPMPV) << "Failed to observe property" << observedProperties[id].name;
         }
-        ++it;
     }
 
-    // From this point on, the wakeup function will be called. The callback
-    // can come from any thread, so we use the QueuedConnection mechanism to
-    // relay the wakeup in a thread-safe way.
-    connect(this, &MPVPlayer::hasMpvEvents, this, &MPVPlayer::handleMpvEvents, Qt::QueuedConnection);
-
-    mpv_set_wakeup_callback(m_mpv, wakeup, this);
-
     if (mpv_initialize(m_mpv) < 0) {
         qFatal("Failed to initialize the mpv player.");
     }
 
+    if (!MPVStreamSource::registerProtocols(m_mpv)) {
+        qCWarning(lcQMPMPV) << "Failed to register the custom stream protocols.";
+    }
+
+    // The tracks are known at this point, but no decoder has been created yet.
+    if (mpv_hook_add(m_mpv, kAdaptiveResolutionHook, "on_preloaded", 0) < 0) {
+        qCWarning(lcQMPMPV) << "Failed to add the \"on_preloaded\" hook.";
+    }
+
+    // The events are drained on a dedicated thread which blocks in
+    // mpv_wait_event(), and delivered to the GUI thread in batches.
+    m_eventThread.reset(new MPVEventThread(m_mpv, this));
+    m_eventThread->start();
+
     connect(this, &MPVPlayer::onUpdate, this, &MPVPlayer::doUpdate, Qt::QueuedConnection);
 
+    notifyFFmpegInfo_mpv(this, [this](){
+        Q_EMIT ffmpegInfoChanged();
+    });
+
     connect(this, &MPVPlayer::playbackStateChanged, this, [this](){
         if (isPlaying()) {
             Q_EMIT playing();
@@ -142,21 +237,24 @@ void MPVPlayer::initialize()
             Q_EMIT paused();
         }
         if (isStopped()) {
-            m_loaded = false;
-            m_mediaStatus = {};
-            const QUrl url = m_source;
-            const qint64 pos = m_lastPosition;
-            Q_EMIT stopped();
-            Q_EMIT stoppedWithPosition(url, pos);
-            m_source.clear();
-            Q_EMIT sourceChanged();
-            m_lastPosition = 0;
+            notifyStopped();
         }
     });
     connect(this, &MPVPlayer::positionChanged, this, [this](){
         m_lastPosition = position();
     });
 
+    // How much the video is scaled down depends on all of these.
+    connect(this, &MPVPlayer::adaptiveResolutionChanged, this, [this](){
+        applyAdaptiveResolution(videoSize());
+    });
+    connect(this, &MPVPlayer::videoSizeChanged, this, [this](){
+        applyAdaptiveResolution(videoSize());
+    });
+    connect(this, &MPVPlayer::fillModeChanged, this, [this](){
+        applyAdaptiveResolution(videoSize());
+    });
+
     connect(this, &MPVPlayer::rendererReadyChanged, this, [this](){
         if (!m_rendererReady) {
             return;
@@ -164,8 +262,11 @@ void MPVPlayer::initialize()
         if (!m_cachedUrl.isValid()) {
             return;
         }
-        setSource(m_cachedUrl);
+        const QUrl url = m_cachedUrl;
+        const quint64 id = m_cachedRequestId;
         m_cachedUrl.clear();
+        m_cachedRequestId = 0;
+        startLoad(url, id);
     });
 }
 
@@ -174,6 +275,23 @@ void MPVPlayer::deinitialize()
     if (!isStopped()) {
         stop();
     }
+    if (!m_livePreview) {
+        qCDebug(lcQMPMPV) << "Video frames:" << renderedFrames() << "rendered,"
+                          << renderRingUnderruns() << "delayed by a full render ring.";
+    }
+    // The event thread must not wait on a destroyed handle.
+    if (m_eventThread) {
+        m_eventThread->stop();
+        if (!m_livePreview) {
+            qCDebug(lcQMPMPV) << "mpv wake ups:" << m_eventThread->postedWakeups() << "posted,"
+                              << m_eventThread->coalescedWakeups() << "coalesced.";
+        }
+        m_eventThread.reset();
+    }
+    if (m_deviceUrl.isValid()) {
+        MPVStreamSource::unregisterDevice(m_deviceUrl);
+        m_deviceUrl.clear();
+    }
     // Only initialized if something got drawn
     if (m_mpv_gl) {
         mpv_render_context_free(m_mpv_gl);
@@ -229,12 +347,12 @@ QString MPVPlayer::backendHomepage() const
 
 QString MPVPlayer::ffmpegVersion() const
 {
-    return metaData_mpv().value(kFFmpegVersion).toString();
+    return ffmpegInfo_mpv(kFFmpegVersion);
 }
 
 QString MPVPlayer::ffmpegConfiguration() const
 {
-    return metaData_mpv().value(kFFmpegConfiguration).toString();
+    return ffmpegInfo_mpv(kFFmpegConfiguration);
 }
 
 // Connected to onUpdate() signal makes sure it runs on the GUI thread
@@ -243,63 +361,182 @@ void MPVPlayer::doUpdate()
     update();
 }
 
-void MPVPlayer::processMpvLogMessage(void *event)
+void MPVPlayer::notifyStopped()
 {
-    Q_ASSERT(event);
-    if (!event) {
-        return;
+    m_loaded = false;
+    m_mediaStatus = {};
+    finishPendingRequests(m_seekingRequests, false);
+    finishPendingRequests(m_restartingRequests, false);
+    const QUrl url = m_source;
+    const qint64 pos = m_lastPosition;
+    Q_EMIT stopped();
+    Q_EMIT stoppedWithPosition(url, pos);
+    m_source.clear();
+    Q_EMIT sourceChanged();
+    m_lastPosition = 0;
+}
+
+void MPVPlayer::finishPendingRequests(QList<quint64> &ids, const bool success, const QVariant &result)
+{
+    for (auto &&id : qAsConst(ids)) {
+        finishRequest(id, success, result);
+    }
+    ids.clear();
+}
+
+void MPVPlayer::failPendingLoads()
+{
+    // Including the loads whose "loadfile" reply hasn't arrived yet, their
+    // reply is ignored once they are no longer pending.
+    for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end();) {
+        if (it.value() == RequestType::Load) {
+            finishRequest(it.key(), false);
+            it = m_pendingRequests.erase(it);
+        } else {
+            ++it;
+        }
     }
-    if (m_livePreview) {
+    finishPendingRequests(m_loadingRequests, false);
+    finishPendingRequests(m_openingRequests, false);
+}
+
+void MPVPlayer::processMpvReply(const MPVEvent &event)
+{
+    const quint64 id = event.replyUserdata;
+    if ((id == 0) || !m_pendingRequests.contains(id)) {
         return;
     }
-    const auto e = static_cast<mpv_event_log_message *>(event);
-    // The log message from libmpv contains new line. Remove it.
-    const QString message = QString::fromUtf8(e->text).trimmed();
-    if (message.isEmpty()) {
+    const RequestType type = m_pendingRequests.take(id);
+    const QSize frameGrabSize = m_frameGrabSizes.take(id);
+    if (event.error < 0) {
+        finishRequest(id, false, QString::fromUtf8(mpv_error_string(event.error)));
         return;
     }
-    switch (e->log_level) {
-    case MPV_LOG_LEVEL_V:
-    case MPV_LOG_LEVEL_DEBUG:
-    case MPV_LOG_LEVEL_TRACE:
-        qCDebug(lcQMPMPV) << message;
+    switch (type) {
+    case RequestType::Load:
+        // The "loadfile" command only queues the file. Everything mpv reports
+        // from now on until MPV_EVENT_START_FILE is about the previous file.
+        m_loadingRequests.append(id);
         break;
-    case MPV_LOG_LEVEL_WARN:
-        qCWarning(lcQMPMPV) << message;
+    case RequestType::Seek:
+        // The seek has only been queued, a playback restart before the seek
+        // has started belongs to something else.
+        m_seekingRequests.append(id);
         break;
-    case MPV_LOG_LEVEL_ERROR:
-    case MPV_LOG_LEVEL_FATAL:
-        qCCritical(lcQMPMPV) << message;
+    case RequestType::GrabFrame:
+        finishFrameGrab(id, event.image, frameGrabSize);
         break;
-    case MPV_LOG_LEVEL_INFO:
-        qCInfo(lcQMPMPV) << message;
-        break;
-    default:
-        qCDebug(lcQMPMPV) << message;
+    case RequestType::Other:
+        finishRequest(id, true);
         break;
     }
 }
 
-void MPVPlayer::processMpvPropertyChange(void *event)
+void MPVPlayer::processMpvPropertyChange(const MPVEvent &event)
 {
-    Q_ASSERT(event);
-    if (!event) {
+    const quint64 id = event.replyUserdata;
+    Q_ASSERT(id < kPropCount);
+    if (id >= kPropCount) {
         return;
     }
-    const auto e = static_cast<mpv_event_property *>(event);
-    const QString name = QString::fromUtf8(e->name);
-    if (!propertyBlackList.contains(name) && !m_livePreview) {
-        qCDebug(lcQMPMPV) << name << "-->" << mpvGetProperty(name, true);
+    const ObservedProperty &prop = observedProperties[id];
+    if (!prop.noisy && !m_livePreview) {
+        qCDebug(lcQMPMPV) << prop.name << "-->" << event.value();
     }
-    if (properties.contains(name)) {
-        const QByteArrayList signalNames = properties.value(name);
-        if (!signalNames.isEmpty()) {
-            for (auto &&signalName : qAsConst(signalNames)) {
-                if (!signalName.isEmpty()) {
-                    QMetaObject::invokeMethod(this, signalName.constData());
-                }
-            }
-        }
+    updatePropertyCache(event);
+    if (prop.notifySignal) {
+        Q_EMIT (this->*prop.notifySignal)();
+    }
+}
+
+void MPVPlayer::updatePropertyCache(const MPVEvent &event)
+{
+    // Unavailable properties are reported with MPV_FORMAT_NONE and reset the
+    // cached value to its default.
+    switch (event.replyUserdata) {
+    case kPropTimePos:
+        m_cache.timePos = event.realValue;
+        break;
+    case kPropDuration:
+        m_cache.duration = event.realValue;
+        break;
+    case kPropDWidth:
+        m_cache.dwidth = event.int64Value;
+        break;
+    case kPropDHeight:
+        m_cache.dheight = event.int64Value;
+        break;
+    case kPropVolume:
+        m_cache.volume = event.realValue;
+        break;
+    case kPropMute:
+        m_cache.mute = event.boolValue;
+        break;
+    case kPropSeekable:
+        m_cache.seekable = event.boolValue;
+        break;
+    case kPropHwdecCurrent:
+        m_cache.hwdecCurrent = event.stringValue;
+        break;
+    case kPropAspect:
+        m_cache.aspect = event.realValue;
+        break;
+    case kPropSpeed:
+        m_cache.speed = event.realValue;
+        break;
+    case kPropFileName:
+        m_cache.fileName = event.stringValue;
+        break;
+    case kPropScreenshotFormat:
+        m_cache.screenshotFormat = event.stringValue;
+        break;
+    case kPropScreenshotTemplate:
+        m_cache.screenshotTemplate = event.stringValue;
+        break;
+    case kPropScreenshotDirectory:
+        m_cache.screenshotDirectory = event.stringValue;
+        break;
+    case kPropPath:
+        m_cache.path = event.stringValue;
+        break;
+    case kPropPause:
+        m_cache.pause = event.boolValue;
+        break;
+    case kPropIdleActive:
+        m_cache.idleActive = ((event.format == MPV_FORMAT_FLAG) ? event.boolValue : true);
+        break;
+    case kPropTrackList:
+        m_cache.mediaTracks = event.nodeValue.value<MediaTracks>();
+        break;
+    case kPropChapterList:
+        m_cache.chapters = event.nodeValue.value<Chapters>();
+        break;
+    case kPropMetaData:
+        m_cache.metaData = event.nodeValue.value<MetaData>();
+        break;
+    case kPropVideoUnscaled:
+        m_cache.videoUnscaled = event.stringValue;
+        break;
+    case kPropKeepAspect:
+        m_cache.keepaspect = ((event.format == MPV_FORMAT_FLAG) ? event.boolValue : true);
+        break;
+    case kPropVid:
+        m_cache.vid = event.int64Value;
+        break;
+    case kPropAid:
+        m_cache.aid = event.int64Value;
+        break;
+    case kPropSid:
+        m_cache.sid = event.int64Value;
+        break;
+    case kPropSkipLoopFilter:
+        m_cache.skipLoopFilter = event.stringValue;
+        break;
+    case kPropLavcFast:
+        m_cache.lavcFast = event.boolValue;
+        break;
+    default:
+        break;
     }
 }
 
@@ -366,6 +603,51 @@ void MPVPlayer::audioReconfig()
     // TODO
 }
 
+void MPVPlayer::applyAdaptiveResolution(const QSizeF &sourceSize)
+{
+    // Nothing is known about the video yet, keep the current settings.
+    if (adaptiveResolution() && sourceSize.isEmpty()) {
+        return;
+    }
+    // Always 1 while adaptiveResolution is off, so the decoder options are
+    // only ever touched after it has been turned on.
+    const int downscale = adaptiveDownscale(sourceSize);
+    if (downscale == m_adaptiveDownscale) {
+        return;
+    }
+    if (m_adaptiveDownscale == 1) {
+        // Whatever the application has set, restored at the full size.
+        m_userSkipLoopFilter = m_cache.skipLoopFilter;
+        m_userLavcFast = m_cache.lavcFast;
+    }
+    m_adaptiveDownscale = downscale;
+    // Skipping the loop filter trades some blocking artifacts, which are
+    // invisible at the reduced size, for a much cheaper decode. A "vf" scale
+    // is not used on purpose: the full frame would still be decoded and
+    // videoSize would report the scaled size.
+    QString skipLoopFilter = m_userSkipLoopFilter;
+    bool fast = m_userLavcFast;
+    if (downscale >= 4) {
+        skipLoopFilter = QStringLiteral("all");
+        fast = true;
+    } else if (downscale >= 2) {
+        skipLoopFilter = QStringLiteral("nonref");
+        fast = true;
+    }
+    // The decoder reads them when it's created: right away from the
+    // "on_preloaded" hook, otherwise with the next file or track switch.
+    if (!skipLoopFilter.isEmpty() && !mpvSetPropertyAsync(QStringLiteral("vd-lavc-skiploopfilter"), skipLoopFilter, 0)) {
+        qCWarning(lcQMPMPV) << "Failed to set \"vd-lavc-skiploopfilter\" to" << skipLoopFilter;
+    }
+    if (!mpvSetPropertyAsync(QStringLiteral("vd-lavc-fast"), fast, 0)) {
+        qCWarning(lcQMPMPV) << "Failed to set \"vd-lavc-fast\" to" << fast;
+    }
+    if ((downscale > 1) && !m_livePreview) {
+        qCDebug(lcQMPMPV) << "The video of size" << sourceSize << "is shown" << downscale
+                          << "times smaller, using the fast decoder settings.";
+    }
+}
+
 bool MPVPlayer::mpvSendCommand(const QVariant &arguments)
 {
     Q_ASSERT(m_mpv);
@@ -385,6 +667,25 @@ bool MPVPlayer::mpvSendCommand(const QVariant &arguments)
     return (errorCode >= 0);
 }
 
+bool MPVPlayer::mpvSendCommandAsync(const QVariant &arguments, const quint64 id)
+{
+    Q_ASSERT(m_mpv);
+    if (!m_mpv) {
+        return false;
+    }
+    if (!arguments.isValid()) {
+        return false;
+    }
+    if (!m_livePreview) {
+        qCDebug(lcQMPMPV) << "Asynchronous command:" << arguments;
+    }
+    const int errorCode = MPV::Qt::command_async(m_mpv, arguments, id);
+    if ((errorCode < 0) && !m_livePreview) {
+        qCWarning(lcQMPMPV) << "Failed to send command" << arguments << ':' << mpv_error_string(errorCode);
+    }
+    return (errorCode >= 0);
+}
+
 bool MPVPlayer::mpvSetProperty(const QString &name, const QVariant &value)
 {
     Q_ASSERT(m_mpv);
@@ -405,6 +706,26 @@ bool MPVPlayer::mpvSetProperty(const QString &name, const QVariant &value)
     return (errorCode >= 0);
 }
 
+bool MPVPlayer::mpvSetPropertyAsync(const QString &name, const QVariant &value, const quint64 id)
+{
+    Q_ASSERT(m_mpv);
+    if (!m_mpv) {
+        return false;
+    }
+    if (name.isEmpty() || !value.isValid()) {
+        return false;
+    }
+    if (!m_livePreview) {
+        qCDebug(lcQMPMPV) << name << "-->" << value << "(asynchronous)";
+    }
+    const int errorCode = MPV::Qt::set_property_async(m_mpv, name, value, id);
+    if ((errorCode < 0) && !m_livePreview) {
+        qCWarning(lcQMPMPV) << "Failed to change property" << name
+                            << "to" << value << ':' << mpv_error_string(errorCode);
+    }
+    return (errorCode >= 0);
+}
+
 QVariant MPVPlayer::mpvGetProperty(const QString &name, const bool silent, bool *ok) const
 {
     Q_ASSERT(m_mpv);
@@ -434,18 +755,20 @@ QVariant MPVPlayer::mpvGetProperty(const QString &name, const bool silent, bool
     return result;
 }
 
-bool MPVPlayer::mpvObserveProperty(const QString &name)
+bool MPVPlayer::mpvObserveProperty(const quint64 id)
 {
     Q_ASSERT(m_mpv);
     if (!m_mpv) {
         return false;
     }
-    if (name.isEmpty()) {
+    Q_ASSERT(id < kPropCount);
+    if (id >= kPropCount) {
         return false;
     }
-    const int errorCode = mpv_observe_property(m_mpv, 0, qUtf8Printable(name), MPV_FORMAT_NONE);
+    const ObservedProperty &prop = observedProperties[id];
+    const int errorCode = mpv_observe_property(m_mpv, id, prop.name, prop.format);
     if ((errorCode < 0) && !m_livePreview) {
-        qCWarning(lcQMPMPV) << "Failed to observe property" << name << ':' << mpv_error_string(errorCode);
+        qCWarning(lcQMPMPV) << "Failed to observe property" << prop.name << ':' << mpv_error_string(errorCode);
     }
     return (errorCode >= 0);
 }
@@ -457,7 +780,7 @@ QUrl MPVPlayer::source() const
 
 QString MPVPlayer::fileName() const
 {
-    return (isStopped() ? QString{} : mpvGetProperty(QStringLiteral("filename")).toString());
+    return (isStopped() ? QString{} : m_cache.fileName);
 }
 
 QSizeF MPVPlayer::videoSize() const
@@ -465,15 +788,13 @@ QSizeF MPVPlayer::videoSize() const
     if (isStopped()) {
         return {};
     }
-    return {mpvGetProperty(QStringLiteral("video-out-params/dw")).toReal(),
-            mpvGetProperty(QStringLiteral("video-out-params/dh")).toReal()};
+    return {static_cast<qreal>(m_cache.dwidth), static_cast<qreal>(m_cache.dheight)};
 }
 
 PlaybackState MPVPlayer::playbackState() const
 {
-    const bool stopped = mpvGetProperty(QStringLiteral("idle-active")).toBool();
-    const bool paused = mpvGetProperty(QStringLiteral("pause")).toBool();
-    return (stopped ? PlaybackState::Stopped : (paused ? PlaybackState::Paused : PlaybackState::Playing));
+    return (m_cache.idleActive ? PlaybackState::Stopped
+                               : (m_cache.pause ? PlaybackState::Paused : PlaybackState::Playing));
 }
 
 MediaStatus MPVPlayer::mediaStatus() const
@@ -483,7 +804,7 @@ MediaStatus MPVPlayer::mediaStatus() const
 
 LogLevel MPVPlayer::logLevel() const
 {
-    const QString level = mpvGetProperty(QStringLiteral("msg-level")).toString();
+    const QString level = m_cache.msgLevel;
     if (level.isEmpty() || (level == QStringLiteral("no")) || (level == QStringLiteral("off"))) {
         return LogLevel::Off;
     }
@@ -513,139 +834,116 @@ LogLevel MPVPlayer::logLevel() const
 
 qint64 MPVPlayer::duration() const
 {
-    return (isStopped() ? 0 : (mpvGetProperty(QStringLiteral("duration")).toLongLong() * 1000));
+    return (isStopped() ? 0 : qRound64(m_cache.duration * 1000.0));
 }
 
 qint64 MPVPlayer::position() const
 {
-    return (isStopped() ? 0 : (mpvGetProperty(QStringLiteral("time-pos")).toLongLong() * 1000));
+    return (isStopped() ? 0 : qRound64(m_cache.timePos * 1000.0));
+}
+
+void MPVPlayer::applyVideoSuspension(const bool suspend)
+{
+    if (suspend) {
+        m_suspendedVideoTrack = m_cache.vid;
+        // mpv stops decoding and tears down the video chain, no more render
+        // updates will arrive. Audio and the clock are not affected.
+        if (!mpvSetPropertyAsync(QStringLiteral("vid"), QStringLiteral("no"), 0)) {
+            qCWarning(lcQMPMPV) << "Failed to set \"vid\" to \"no\".";
+        }
+        if (!m_livePreview) {
+            qCDebug(lcQMPMPV) << "Video suspended.";
+        }
+        return;
+    }
+    const QVariant track = ((m_suspendedVideoTrack > 0) ? QVariant(m_suspendedVideoTrack) : QVariant(QStringLiteral("auto")));
+    if (!mpvSetPropertyAsync(QStringLiteral("vid"), track, 0)) {
+        qCWarning(lcQMPMPV) << "Failed to set \"vid\" to" << track;
+    }
+    if (isStopped()) {
+        return;
+    }
+    // A key frame seek brings the picture back quickly, an exact one would
+    // have to decode everything since the previous key frame first. mpv
+    // handles the asynchronous requests in order, so it comes after "vid".
+    if (!mpvSendCommandAsync(QVariantList{QStringLiteral("seek"), static_cast<qreal>(position()) / 1000.0,
+                                          QStringLiteral("absolute+keyframes")}, 0)) {
+        qCWarning(lcQMPMPV) << "Failed to send command \"seek\".";
+    }
+    if (!m_livePreview) {
+        qCDebug(lcQMPMPV) << "Video resumed.";
+    }
+}
+
+qreal MPVPlayer::precisePosition() const
+{
+    return (isStopped() ? 0.0 : (m_cache.timePos * 1000.0));
 }
 
 qreal MPVPlayer::volume() const
 {
-    return (mpvGetProperty(QStringLiteral("volume")).toReal() / 100.0);
+    return (m_cache.volume / 100.0);
 }
 
 bool MPVPlayer::mute() const
 {
-    return mpvGetProperty(QStringLiteral("mute")).toBool();
+    return m_cache.mute;
 }
 
 bool MPVPlayer::seekable() const
 {
-    return (isStopped() ? false : mpvGetProperty(QStringLiteral("seekable")).toBool());
+    return (isStopped() ? false : m_cache.seekable);
 }
 
 bool MPVPlayer::hardwareDecoding() const
 {
     // Querying "hwdec" itself will return empty string.
-    const QString hwdec = mpvGetProperty(QStringLiteral("hwdec-current")).toString();
+    const QString hwdec = m_cache.hwdecCurrent;
     return (!hwdec.isEmpty() && (hwdec != QStringLiteral("no")) && (hwdec != QStringLiteral("off")));
 }
 
 qreal MPVPlayer::aspectRatio() const
 {
-    const qreal result = mpvGetProperty(QStringLiteral("video-out-params/aspect")).toReal();
+    const qreal result = m_cache.aspect;
     return ((result > 0.0) ? result : (16.0 / 9.0));
 }
 
 qreal MPVPlayer::playbackRate() const
 {
-    return mpvGetProperty(QStringLiteral("speed")).toReal();
+    return m_cache.speed;
 }
 
 QString MPVPlayer::snapshotFormat() const
 {
-    return mpvGetProperty(QStringLiteral("screenshot-format")).toString();
+    return m_cache.screenshotFormat;
 }
 
 QString MPVPlayer::snapshotTemplate() const
 {
-    return mpvGetProperty(QStringLiteral("screenshot-template")).toString();
+    return m_cache.screenshotTemplate;
 }
 
 QUrl MPVPlayer::snapshotDirectory() const
 {
-    return QUrl(mpvGetProperty(QStringLiteral("screenshot-directory")).toString());
+    return QUrl(m_cache.screenshotDirectory);
 }
 
 QString MPVPlayer::filePath() const
 {
-    return (isStopped() ? QString{} : QDir::toNativeSeparators(mpvGetProperty(QStringLiteral("path")).toString()));
+    return (isStopped() ? QString{} : QDir::toNativeSeparators(m_cache.path));
 }
 
 MediaTracks MPVPlayer::mediaTracks() const
 {
-    if (isStopped()) {
-        return {};
-    }
-    const QVariantList trackList = mpvGetProperty(QStringLiteral("track-list")).toList();
-    if (trackList.isEmpty()) {
-        return {};
-    }
-    MediaTracks result = {};
-    for (auto &&track : qAsConst(trackList)) {
-        const QVariantMap trackInfo = track.toMap();
-        if (trackInfo.isEmpty()) {
-            continue;
-        }
-        const QString type = trackInfo.value(QStringLiteral("type")).toString();
-        if ((type != QStringLiteral("video"))
-            && (type != QStringLiteral("audio")) && (type != QStringLiteral("sub"))) {
-            continue;
-        }
-        QVariantHash info = {};
-        info.insert(QStringLiteral("id"), trackInfo.value(QStringLiteral("id")));
-        info.insert(QStringLiteral("type"), type);
-        info.insert(QStringLiteral("src-id"), trackInfo.value(QStringLiteral("src-id")));
-        const QString lang = trackInfo.value(QStringLiteral("lang")).toString();
-        info.insert(QStringLiteral("lang"), lang);
-        const QString title = trackInfo.value(QStringLiteral("title")).toString();
-        if (title.isEmpty()) {
-            if (lang != QStringLiteral("und")) {
-                info.insert(QStringLiteral("title"), lang);
-            } else if (!trackInfo.value(QStringLiteral("external")).toBool()) {
-                info.insert(QStringLiteral("title"), QStringLiteral("[internal]"));
-            } else {
-                info.insert(QStringLiteral("title"), QStringLiteral("[untitled]"));
-            }
-        } else {
-            info.insert(QStringLiteral("title"), title);
-        }
-        info.insert(QStringLiteral("default"), trackInfo.value(QStringLiteral("default")));
-        info.insert(QStringLiteral("forced"), trackInfo.value(QStringLiteral("forced")));
-        info.insert(QStringLiteral("codec"), trackInfo.value(QStringLiteral("codec")));
-        info.insert(QStringLiteral("external"), trackInfo.value(QStringLiteral("external")));
-        info.insert(QStringLiteral("external-filename"), trackInfo.value(QStringLiteral("external-filename")));
-        info.insert(QStringLiteral("selected"), trackInfo.value(QStringLiteral("selected")));
-        info.insert(QStringLiteral("decoder-desc"), trackInfo.value(QStringLiteral("decoder-desc")));
-        info.insert(QStringLiteral("albumart"), trackInfo.value(QStringLiteral("albumart")));
-        info.insert(QStringLiteral("image"), trackInfo.value(QStringLiteral("image")));
-        info.insert(QStringLiteral("main-selection"), trackInfo.value(QStringLiteral("main-selection")));
-        info.insert(QStringLiteral("ff-index"), trackInfo.value(QStringLiteral("ff-index")));
-        if (type == QStringLiteral("video")) {
-            info.insert(QStringLiteral("demux-w"), trackInfo.value(QStringLiteral("demux-w")));
-            info.insert(QStringLiteral("demux-h"), trackInfo.value(QStringLiteral("demux-h")));
-            info.insert(QStringLiteral("demux-fps"), trackInfo.value(QStringLiteral("demux-fps")));
-            info.insert(QStringLiteral("demux-rotation"), trackInfo.value(QStringLiteral("demux-rotation")));
-            info.insert(QStringLiteral("demux-par"), trackInfo.value(QStringLiteral("demux-par")));
-            result.video.append(info);
-        } else if (type == QStringLiteral("audio")) {
-            info.insert(QStringLiteral("demux-channel-count"), trackInfo.value(QStringLiteral("demux-channel-count")));
-            info.insert(QStringLiteral("demux-channels"), trackInfo.value(QStringLiteral("demux-channels")));
-            info.insert(QStringLiteral("demux-samplerate"), trackInfo.value(QStringLiteral("demux-samplerate")));
-            info.insert(QStringLiteral("demux-bitrate"), trackInfo.value(QStringLiteral("demux-bitrate")));
-            result.audio.append(info);
-        } else if (type == QStringLiteral("sub")) {
-            result.subtitle.append(info);
-        }
-    }
-    return result;
+    return (isStopped() ? MediaTracks{} : m_cache.mediaTracks);
 }
 
 int MPVPlayer::activeVideoTrack() const
 {
-    return (isStopped() ? 0 : mpvGetProperty(QStringLiteral("vid")).toInt());
+    if (isStopped()) {
+        return 0;
+    }
+    return static_cast<int>(videoSuspended() ? m_suspendedVideoTrack : m_cache.vid);
 }
 
 void MPVPlayer::setActiveVideoTrack(const int value)
@@ -671,14 +969,20 @@ void MPVPlayer::setActiveVideoTrack(const int value)
     if (activeVideoTrack() == track) {
         return;
     }
-    if (!mpvSetProperty(QStringLiteral("vid"), track)) {
+    if (videoSuspended()) {
+        // Applied when the video resumes.
+        m_suspendedVideoTrack = track;
+        Q_EMIT activeVideoTrackChanged();
+        return;
+    }
+    if (!mpvSetPropertyAsync(QStringLiteral("vid"), track, 0)) {
         qCWarning(lcQMPMPV) << "Failed to set \"vid\" to" << track;
     }
 }
 
 int MPVPlayer::activeAudioTrack() const
 {
-    return (isStopped() ? 0 : mpvGetProperty(QStringLiteral("aid")).toInt());
+    return (isStopped() ? 0 : static_cast<int>(m_cache.aid));
 }
 
 void MPVPlayer::setActiveAudioTrack(const int value)
@@ -704,14 +1008,14 @@ void MPVPlayer::setActiveAudioTrack(const int value)
     if (activeAudioTrack() == track) {
         return;
     }
-    if (!mpvSetProperty(QStringLiteral("aid"), track)) {
+    if (!mpvSetPropertyAsync(QStringLiteral("aid"), track, 0)) {
         qCWarning(lcQMPMPV) << "Failed to set \"aid\" to" << track;
     }
 }
 
 int MPVPlayer::activeSubtitleTrack() const
 {
-    return (isStopped() ? 0 : mpvGetProperty(QStringLiteral("sid")).toInt());
+    return (isStopped() ? 0 : static_cast<int>(m_cache.sid));
 }
 
 void MPVPlayer::setActiveSubtitleTrack(const int value)
@@ -737,7 +1041,7 @@ void MPVPlayer::setActiveSubtitleTrack(const int value)
     if (activeSubtitleTrack() == track) {
         return;
     }
-    if (!mpvSetProperty(QStringLiteral("sid"), track)) {
+    if (!mpvSetPropertyAsync(QStringLiteral("sid"), track, 0)) {
         qCWarning(lcQMPMPV) << "Failed to set \"sid\" to" << track;
     }
 }
@@ -749,44 +1053,12 @@ bool MPVPlayer::rendererReady() const
 
 Chapters MPVPlayer::chapters() const
 {
-    if (isStopped()) {
-        return {};
-    }
-    const QVariantList chapterList = mpvGetProperty(QStringLiteral("chapter-list")).toList();
-    if (chapterList.isEmpty()) {
-        return {};
-    }
-    Chapters result = {};
-    for (auto &&chapter : qAsConst(chapterList)) {
-        const QVariantMap chapterInfo = chapter.toMap();
-        if (chapterInfo.isEmpty()) {
-            continue;
-        }
-        ChapterInfo info = {};
-        info.title = chapterInfo.value(QStringLiteral("title")).toString();
-        info.startTime = qRound64(chapterInfo.value(QStringLiteral("time")).toReal() * 1000.0);
-        info.endTime = 0; // ### FIXME
-        result.append(info);
-    }
-    return result;
+    return (isStopped() ? Chapters{} : m_cache.chapters);
 }
 
 MetaData MPVPlayer::metaData() const
 {
-    if (isStopped()) {
-        return {};
-    }
-    const QVariantMap md = mpvGetProperty(QStringLiteral("metadata")).toMap();
-    if (md.isEmpty()) {
-        return {};
-    }
-    MetaData result = {};
-    auto it = md.constBegin();
-    while (it != md.constEnd()) {
-        result.insert(it.key(), it.value());
-        ++it;
-    }
-    return result;
+    return (isStopped() ? MetaData{} : m_cache.metaData);
 }
 
 bool MPVPlayer::livePreview() const
@@ -799,7 +1071,7 @@ void MPVPlayer::play()
     if (!m_source.isValid() || m_livePreview) {
         return;
     }
-    if (!mpvSetProperty(QStringLiteral("pause"), false)) {
+    if (!mpvSetPropertyAsync(QStringLiteral("pause"), false, 0)) {
         qCWarning(lcQMPMPV) << "Failed to set \"pause\" to \"false\".";
     }
 }
@@ -809,7 +1081,7 @@ void MPVPlayer::pause()
     if (!m_source.isValid()) {
         return;
     }
-    if (!mpvSetProperty(QStringLiteral("pause"), true)) {
+    if (!mpvSetPropertyAsync(QStringLiteral("pause"), true, 0)) {
         qCWarning(lcQMPMPV) << "Failed to set \"pause\" to \"true\".";
     }
 }
@@ -819,30 +1091,56 @@ void MPVPlayer::stop()
     if (!m_source.isValid()) {
         return;
     }
-    if (!mpvSendCommand(QVariantList{QStringLiteral("stop")})) {
+    if (!mpvSendCommandAsync(QVariantList{QStringLiteral("stop")}, 0)) {
         qCWarning(lcQMPMPV) << "Failed to send command \"stop\".";
     }
+    // A file that hasn't been loaded yet won't be anymore.
+    failPendingLoads();
 }
 
 void MPVPlayer::seek(const qint64 value)
 {
-    if (isStopped() || (position() == value)) {
+    doSeek(value, 0);
+}
+
+quint64 MPVPlayer::seekAsync(const qint64 value)
+{
+    const quint64 id = createRequestId();
+    doSeek(value, id);
+    return id;
+}
+
+void MPVPlayer::doSeek(const qint64 value, const quint64 id)
+{
+    if (isStopped()) {
+        finishRequest(id, false);
+        return;
+    }
+    if (position() == value) {
+        finishRequest(id, true, value);
         return;
     }
     if (value < 0) {
         qCWarning(lcQMPMPV) << "Media start time is 0, however, the user is trying to seek to" << value;
+        finishRequest(id, false);
         return;
     }
     const qint64 _duration = duration();
     if (value > _duration) {
         qCWarning(lcQMPMPV) << "Media duration is" << _duration
                             << ", however, the user is trying to seek to" << value;
+        finishRequest(id, false);
         return;
     }
-    if (!mpvSendCommand(QVariantList{QStringLiteral("seek"),
-                                     qRound64(static_cast<qreal>(value) / 1000.0),
-                                     QStringLiteral("absolute")})) {
+    if (!mpvSendCommandAsync(QVariantList{QStringLiteral("seek"),
+                                          static_cast<qreal>(value) / 1000.0,
+                                          QStringLiteral("absolute")}, id)) {
         qCWarning(lcQMPMPV) << "Failed to send command \"seek\".";
+        finishRequest(id, false);
+        return;
+    }
+    if (id != 0) {
+        m_pendingRequests.insert(id, RequestType::Seek);
     }
 }
 
@@ -852,58 +1150,200 @@ void MPVPlayer::snapshot()
         return;
     }
     // Replace "subtitles" with "video" if you don't want to include subtitles when screenshotting.
-    if (!mpvSendCommand(QVariantList{QStringLiteral("screenshot"), QStringLiteral("subtitles")})) {
+    // mpv encodes and writes the file, don't let the GUI thread wait for it.
+    if (!mpvSendCommandAsync(QVariantList{QStringLiteral("screenshot"), QStringLiteral("subtitles")}, 0)) {
         qCWarning(lcQMPMPV) << "Failed to send command \"screenshot\".";
     }
 }
 
 void MPVPlayer::setSource(const QUrl &value)
 {
-    if (!m_rendererReady) {
-        m_cachedUrl = value;
-        return;
-    }
-    if (value.isEmpty()) {
-        qCDebug(lcQMPMPV) << "Empty source is set, playback stopped.";
-        stop();
-        return;
-    }
+    startLoad(value, 0);
+}
+
+quint64 MPVPlayer::loadAsync(const QUrl &url)
+{
+    const quint64 id = createRequestId();
+    startLoad(url, id);
+    return id;
+}
+
+bool MPVPlayer::isSourceSupported(const QUrl &value) const
+{
     if (!value.isValid()) {
         qCWarning(lcQMPMPV) << "The given URL" << value << "is invalid.";
-        return;
+        return false;
     }
-    if (QString::compare(value.scheme(), QStringLiteral("qrc"), Qt::CaseInsensitive) == 0) {
-        qCWarning(lcQMPMPV) << "Currently embeded resource is not supported.";
-        return;
+    if (MPVStreamSource::isDeviceUrl(value)) {
+        // Registered by setSourceDevice(), the name is only a hint.
+        return true;
+    }
+    if (MPVStreamSource::isResourceUrl(value) && !QFile::exists(MPVStreamSource::resourceFilePath(value))) {
+        qCWarning(lcQMPMPV) << "The embeded resource" << value << "doesn't exist.";
+        return false;
     }
     const QString filename = value.fileName();
     if (filename.isEmpty()) {
         qCWarning(lcQMPMPV) << "The source url" << value << "doesn't contain a filename.";
-        return;
+        return false;
     }
     if (!isMediaFile(filename)) {
         qCWarning(lcQMPMPV) << "The source url" << value << "doesn't seem to be a multimedia file.";
+        return false;
+    }
+    return true;
+}
+
+void MPVPlayer::startLoad(const QUrl &value, const quint64 id)
+{
+    if (!m_rendererReady) {
+        // Only the latest source matters, a previously deferred one is dropped.
+        finishRequest(m_cachedRequestId, false);
+        m_cachedUrl = value;
+        m_cachedRequestId = id;
+        return;
+    }
+    if (value.isEmpty()) {
+        qCDebug(lcQMPMPV) << "Empty source is set, playback stopped.";
+        stop();
+        finishRequest(id, true);
+        return;
+    }
+    if (!isSourceSupported(value)) {
+        finishRequest(id, false);
         return;
     }
     if (value == m_source) {
         if (isStopped() && !m_livePreview) {
             play();
         }
+        finishRequest(id, true, value);
         return;
     }
-    stop();
-    const bool result = mpvSendCommand(QVariantList{QStringLiteral("loadfile"), value.isLocalFile()
-                                                        ? QDir::toNativeSeparators(value.toLocalFile())
-                                                        : value.toString()});
-    if (result) {
-        if (m_livePreview || !m_autoStart) {
-            if (!mpvSetProperty(QStringLiteral("pause"), true)) {
-                qCWarning(lcQMPMPV) << "Failed to set \"pause\" to \"true\".";
-            }
+    // "loadfile" replaces the current file without going through the idle
+    // state, so the end of the current playback has to be reported here.
+    if (!isStopped()) {
+        notifyStopped();
+    }
+    // A file that is still being opened gets superseded by the new one.
+    failPendingLoads();
+    if (m_deviceUrl.isValid() && (m_deviceUrl != value)) {
+        MPVStreamSource::unregisterDevice(m_deviceUrl);
+        m_deviceUrl.clear();
+    }
+    const QString path = (value.isLocalFile() ? QDir::toNativeSeparators(value.toLocalFile()) : MPVStreamSource::toMpvUrl(value));
+    if (!mpvSendCommandAsync(QVariantList{QStringLiteral("loadfile"), path}, id)) {
+        finishRequest(id, false);
+        return;
+    }
+    if (id != 0) {
+        m_pendingRequests.insert(id, RequestType::Load);
+    }
+    if (m_livePreview || !m_autoStart) {
+        if (!mpvSetPropertyAsync(QStringLiteral("pause"), true, 0)) {
+            qCWarning(lcQMPMPV) << "Failed to set \"pause\" to \"true\".";
         }
-        m_source = value;
-        Q_EMIT sourceChanged();
     }
+    m_source = value;
+    Q_EMIT sourceChanged();
+}
+
+void MPVPlayer::setSourceDevice(QIODevice *device, const QString &name)
+{
+    Q_ASSERT(device);
+    if (!device) {
+        return;
+    }
+    if (!device->isOpen() || !device->isReadable()) {
+        qCWarning(lcQMPMPV) << "The source device must be opened for reading.";
+        return;
+    }
+    // mpv reads it from a thread without an event loop, where a sequential
+    // device would look like it ended whenever no data is buffered.
+    if (device->isSequential()) {
+        qCWarning(lcQMPMPV) << "Sequential source devices are not supported.";
+        return;
+    }
+    const QUrl url = MPVStreamSource::registerDevice(device, name);
+    if (m_deviceUrl.isValid()) {
+        MPVStreamSource::unregisterDevice(m_deviceUrl);
+    }
+    m_deviceUrl = url;
+    setSource(url);
+}
+
+quint64 MPVPlayer::setActiveTrackAsync(const TrackType type, const int value)
+{
+    const quint64 id = createRequestId();
+    if (isStopped()) {
+        qCWarning(lcQMPMPV) << "Setting active track before the media is loaded has no effect."
+                            << "Please try again later when the media has been loaded successfully.";
+        finishRequest(id, false);
+        return id;
+    }
+    const MediaTracks tracks = mediaTracks();
+    QString name = {};
+    int totalTrackCount = 0;
+    switch (type) {
+    case TrackType::Video:
+        name = QStringLiteral("vid");
+        totalTrackCount = tracks.video.count();
+        break;
+    case TrackType::Audio:
+        name = QStringLiteral("aid");
+        totalTrackCount = tracks.audio.count();
+        break;
+    case TrackType::Subtitle:
+        name = QStringLiteral("sid");
+        totalTrackCount = tracks.subtitle.count();
+        break;
+    }
+    const int track = qBound(0, value, qMax(totalTrackCount - 1, 0));
+    if (track != value) {
+        qCWarning(lcQMPMPV) << "Total track count is" << totalTrackCount
+                            << ". Can't set active track to" << value << ", using" << track << "instead.";
+    }
+    if ((type == TrackType::Video) && videoSuspended()) {
+        m_suspendedVideoTrack = track;
+        Q_EMIT activeVideoTrackChanged();
+        finishRequest(id, true, track);
+        return id;
+    }
+    if (!mpvSetPropertyAsync(name, track, id)) {
+        finishRequest(id, false);
+        return id;
+    }
+    m_pendingRequests.insert(id, RequestType::Other);
+    return id;
+}
+
+quint64 MPVPlayer::grabFrame(const QSize &size)
+{
+    const quint64 id = createRequestId();
+    if (isStopped()) {
+        finishRequest(id, false);
+        return id;
+    }
+    // The frame as decoded, without subtitles and OSD. mpv converts it on its
+    // own thread and the event thread copies it into a QImage.
+    if (!mpvSendCommandAsync(QVariantList{QStringLiteral("screenshot-raw"), QStringLiteral("video")}, id)) {
+        finishRequest(id, false);
+        return id;
+    }
+    m_pendingRequests.insert(id, RequestType::GrabFrame);
+    m_frameGrabSizes.insert(id, size);
+    return id;
+}
+
+quint64 MPVPlayer::setPropertyAsync(const QString &name, const QVariant &value)
+{
+    const quint64 id = createRequestId();
+    if (!mpvSetPropertyAsync(name, value, id)) {
+        finishRequest(id, false);
+        return id;
+    }
+    m_pendingRequests.insert(id, RequestType::Other);
+    return id;
 }
 
 void MPVPlayer::setMute(const bool value)
@@ -913,7 +1353,9 @@ void MPVPlayer::setMute(const bool value)
     }
     if (!mpvSetProperty(QStringLiteral("mute"), value)) {
         qCWarning(lcQMPMPV) << "Failed to set \"mute\" to" << value;
+        return;
     }
+    m_cache.mute = value;
 }
 
 void MPVPlayer::setPlaybackState(const PlaybackState value)
@@ -963,10 +1405,12 @@ void MPVPlayer::setLogLevel(const LogLevel value)
         level = QStringLiteral("info");
         break;
     }
-    const bool result1 = mpvSetProperty(QStringLiteral("terminal"), level != QStringLiteral("no"));
-    const bool result2 = mpvSetProperty(QStringLiteral("msg-level"), QStringLiteral("all=%1").arg(level));
+    const QString msgLevel = QStringLiteral("all=%1").arg(level);
+    const bool result1 = mpvSetPropertyAsync(QStringLiteral("terminal"), level != QStringLiteral("no"), 0);
+    const bool result2 = mpvSetPropertyAsync(QStringLiteral("msg-level"), msgLevel, 0);
     const int errorCode = mpv_request_log_messages(m_mpv, qUtf8Printable(level));
     if (result1 && result2 && (errorCode >= 0)) {
+        m_cache.msgLevel = msgLevel;
         Q_EMIT logLevelChanged();
     } else {
         if (!m_livePreview) {
@@ -997,7 +1441,9 @@ void MPVPlayer::setVolume(const qreal value)
     const int vol = qRound(value * 100.0);
     if (!mpvSetProperty(QStringLiteral("volume"), vol)) {
         qCWarning(lcQMPMPV) << "Failed to set \"volume\" to" << vol;
+        return;
     }
+    m_cache.volume = vol;
 }
 
 void MPVPlayer::setHardwareDecoding(const bool value)
@@ -1044,7 +1490,9 @@ void MPVPlayer::setAspectRatio(const qreal value)
     }
     if (!mpvSetProperty(QStringLiteral("video-aspect-override"), value)) {
         qCWarning(lcQMPMPV) << "Failed to set \"video-aspect-override\" to" << value;
+        return;
     }
+    m_cache.aspect = value;
 }
 
 void MPVPlayer::setPlaybackRate(const qreal value)
@@ -1059,7 +1507,9 @@ void MPVPlayer::setPlaybackRate(const qreal value)
     }
     if (!mpvSetProperty(QStringLiteral("speed"), value)) {
         qCWarning(lcQMPMPV) << "Failed to set \"speed\" to" << value;
+        return;
     }
+    m_cache.speed = value;
 }
 
 void MPVPlayer::setSnapshotFormat(const QString &value)
@@ -1069,7 +1519,9 @@ void MPVPlayer::setSnapshotFormat(const QString &value)
     }
     if (!mpvSetProperty(QStringLiteral("screenshot-format"), value)) {
         qCWarning(lcQMPMPV) << "Failed to set \"screenshot-format\" to" << value;
+        return;
     }
+    m_cache.screenshotFormat = value;
 }
 
 void MPVPlayer::setSnapshotTemplate(const QString &value)
@@ -1079,7 +1531,9 @@ void MPVPlayer::setSnapshotTemplate(const QString &value)
     }
     if (!mpvSetProperty(QStringLiteral("screenshot-template"), value)) {
         qCWarning(lcQMPMPV) << "Failed to set \"screenshot-template\" to" << value;
+        return;
     }
+    m_cache.screenshotTemplate = value;
 }
 
 void MPVPlayer::setSnapshotDirectory(const QUrl &value)
@@ -1090,7 +1544,9 @@ void MPVPlayer::setSnapshotDirectory(const QUrl &value)
     const QString dir = QDir::toNativeSeparators(value.toLocalFile());
     if (!mpvSetProperty(QStringLiteral("screenshot-directory"), dir)) {
         qCWarning(lcQMPMPV) << "Failed to set \"screenshot-directory\" to" << dir;
+        return;
     }
+    m_cache.screenshotDirectory = dir;
 }
 
 void MPVPlayer::setLivePreview(const bool value)
@@ -1121,15 +1577,10 @@ void MPVPlayer::setLivePreview(const bool value)
 
 FillMode MPVPlayer::fillMode() const
 {
-    bool ok = false;
-    const bool keepaspect = mpvGetProperty(QStringLiteral("keepaspect"), false, &ok).toBool();
-    if (!ok) {
-        return FillMode::PreserveAspectFit;
-    }
-    if (!keepaspect) {
+    if (!m_cache.keepaspect) {
         return FillMode::Stretch;
     }
-    const QString videoUnscaledStr = mpvGetProperty(QStringLiteral("video-unscaled")).toString();
+    const QString videoUnscaledStr = m_cache.videoUnscaled;
     if (videoUnscaledStr.isEmpty() || (videoUnscaledStr == QStringLiteral("no"))) {
         return FillMode::PreserveAspectFit;
     }
@@ -1143,53 +1594,107 @@ void MPVPlayer::setFillMode(const FillMode value)
     }
     switch (value) {
     case FillMode::PreserveAspectFit: {
-        if (!mpvSetProperty(QStringLiteral("keepaspect"), true)) {
+        if (mpvSetProperty(QStringLiteral("keepaspect"), true)) {
+            m_cache.keepaspect = true;
+        } else {
             qCWarning(lcQMPMPV) << "Failed to set \"keepaspect\" to \"true\".";
         }
-        if (!mpvSetProperty(QStringLiteral("video-unscaled"), QStringLiteral("no"))) {
+        if (mpvSetProperty(QStringLiteral("video-unscaled"), QStringLiteral("no"))) {
+            m_cache.videoUnscaled = QStringLiteral("no");
+        } else {
             qCWarning(lcQMPMPV) << "Failed to set \"video-unscaled\" to \"no\".";
         }
     } break;
     case FillMode::PreserveAspectCrop: {
-        if (!mpvSetProperty(QStringLiteral("keepaspect"), true)) {
+        if (mpvSetProperty(QStringLiteral("keepaspect"), true)) {
+            m_cache.keepaspect = true;
+        } else {
             qCWarning(lcQMPMPV) << "Failed to set \"keepaspect\" to \"true\".";
         }
-        if (!mpvSetProperty(QStringLiteral("video-unscaled"), QStringLiteral("yes"))) {
+        if (mpvSetProperty(QStringLiteral("video-unscaled"), QStringLiteral("yes"))) {
+            m_cache.videoUnscaled = QStringLiteral("yes");
+        } else {
             qCWarning(lcQMPMPV) << "Failed to set \"video-unscaled\" to \"yes\".";
         }
     } break;
     case FillMode::Stretch:
-        if (!mpvSetProperty(QStringLiteral("keepaspect"), false)) {
+        if (mpvSetProperty(QStringLiteral("keepaspect"), false)) {
+            m_cache.keepaspect = false;
+        } else {
             qCWarning(lcQMPMPV) << "Failed to set \"keepaspect\" to \"false\".";
         }
         break;
     }
 }
 
-void MPVPlayer::handleMpvEvents()
+quint64 MPVPlayer::postedMpvWakeups() const
 {
-    Q_ASSERT(m_mpv);
-    // Process all events, until the event queue is empty.
-    while (m_mpv) {
-        const auto event = mpv_wait_event(m_mpv, 0.005);
-        if (!event) {
-            continue;
-        }
-        // Nothing happened. Happens on timeouts or sporadic wakeups.
-        if (event->event_id == MPV_EVENT_NONE) {
-            break;
-        }
+    return (m_eventThread ? m_eventThread->postedWakeups() : 0);
+}
+
+quint64 MPVPlayer::coalescedMpvWakeups() const
+{
+    return (m_eventThread ? m_eventThread->coalescedWakeups() : 0);
+}
+
+int MPVPlayer::renderBufferCount() const
+{
+    return m_renderBufferCount;
+}
+
+void MPVPlayer::setRenderBufferCount(const int value)
+{
+    const int count = qBound(MPVVideoTextureNode::kMinRenderBuffers, value, MPVVideoTextureNode::kMaxRenderBuffers);
+    if (m_renderBufferCount == count) {
+        return;
+    }
+    m_renderBufferCount = count;
+    update();
+    Q_EMIT renderBufferCountChanged();
+}
+
+quint64 MPVPlayer::renderedFrames() const
+{
+    return m_renderedFrames.loadRelaxed();
+}
+
+quint64 MPVPlayer::renderRingUnderruns() const
+{
+    return m_renderRingUnderruns.loadRelaxed();
+}
+
+// Called on the GUI thread with all the events the event thread collected
+// during one wake up.
+void MPVPlayer::drainMpvEvents()
+{
+    // A drain may still be queued after the event thread has been stopped.
+    if (!m_eventThread) {
+        return;
+    }
+    const MPVEventList events = m_eventThread->takePendingEvents();
+    if (events.isEmpty()) {
+        return;
+    }
+    handleMpvEvents(events);
+}
+
+void MPVPlayer::handleMpvEvents(const QVector<MPVEvent> &events)
+{
+    if (!m_mpv) {
+        return;
+    }
+    for (auto &&event : qAsConst(events)) {
         bool shouldOutput = true;
-        switch (event->event_id) {
+        switch (event.id) {
         // Happens when the player quits. The player enters a state where it
         // tries to disconnect all clients. Most requests to the player will
         // fail, and the client should react to this and quit with
         // mpv_destroy() as soon as possible.
         case MPV_EVENT_SHUTDOWN:
             break;
-        // See mpv_request_log_messages().
+        // See mpv_request_log_messages(). They are sent to the log sink
+        // by the event thread directly and never get here.
         case MPV_EVENT_LOG_MESSAGE:
-            processMpvLogMessage(event->data);
             shouldOutput = false;
             break;
         // Reply to a mpv_get_property_async() request.
@@ -1200,16 +1705,22 @@ void MPVPlayer::handleMpvEvents()
         // Reply to a mpv_set_property_async() request.
         // (Unlike MPV_EVENT_GET_PROPERTY, mpv_event_property is not used.)
         case MPV_EVENT_SET_PROPERTY_REPLY:
+            processMpvReply(event);
             shouldOutput = false;
             break;
         // Reply to a mpv_command_async() or mpv_command_node_async() request.
         // See also mpv_event and mpv_event_command.
         case MPV_EVENT_COMMAND_REPLY:
+            processMpvReply(event);
             shouldOutput = false;
             break;
         // Notification before playback start of a file (before the file is
         // loaded).
         case MPV_EVENT_START_FILE:
+            // A new file starts with the default video track.
+            m_suspendedVideoTrack = 0;
+            m_openingRequests.append(m_loadingRequests);
+            m_loadingRequests.clear();
             m_mediaStatus = MediaStatusFlag::Loading;
             Q_EMIT mediaStatusChanged();
             break;
@@ -1219,6 +1730,16 @@ void MPVPlayer::handleMpvEvents()
             m_loaded = false;
             m_mediaStatus = (MediaStatusFlag::NoMedia | MediaStatusFlag::Unloaded | MediaStatusFlag::End);
             Q_EMIT mediaStatusChanged();
+            // The file ended before it got loaded, no matter if it failed, got
+            // stopped or redirected. The loads queued after it are not
+            // affected, their file hasn't started yet.
+            if (event.endFileReason == MPV_END_FILE_REASON_ERROR) {
+                finishPendingRequests(m_openingRequests, false, QString::fromUtf8(mpv_error_string(event.error)));
+            } else {
+                finishPendingRequests(m_openingRequests, false);
+            }
+            finishPendingRequests(m_seekingRequests, false);
+            finishPendingRequests(m_restartingRequests, false);
             break;
         // Notification when the file has been loaded (headers were read
         // etc.), and decoding starts.
@@ -1227,6 +1748,7 @@ void MPVPlayer::handleMpvEvents()
             m_mediaStatus = (MediaStatusFlag::Loaded | MediaStatusFlag::Prepared | MediaStatusFlag::Buffering);
             Q_EMIT mediaStatusChanged();
             Q_EMIT loaded();
+            finishPendingRequests(m_openingRequests, true, m_source);
             break;
         // Triggered by the script-message input command. The command uses the
         // first argument of the command as client name (see mpv_client_name())
@@ -1259,6 +1781,8 @@ void MPVPlayer::handleMpvEvents()
             m_mediaStatus &= ~MediaStatus(MediaStatusFlag::Buffered);
             m_mediaStatus |= (MediaStatusFlag::Seeking | MediaStatusFlag::Buffering);
             Q_EMIT mediaStatusChanged();
+            m_restartingRequests.append(m_seekingRequests);
+            m_seekingRequests.clear();
             break;
         // There was a discontinuity of some sort (like a seek), and playback
         // was reinitialized. Usually happens after seeking, or ordered chapter
@@ -1268,11 +1792,14 @@ void MPVPlayer::handleMpvEvents()
             m_mediaStatus &= ~(MediaStatusFlag::Seeking | MediaStatusFlag::Buffering);
             m_mediaStatus |= MediaStatusFlag::Buffered;
             Q_EMIT mediaStatusChanged();
+            // Only the seeks that have actually started, with the position
+            // the event thread read when the playback restarted.
+            finishPendingRequests(m_restartingRequests, true, qRound64(event.realValue * 1000.0));
             break;
         // Event sent due to mpv_observe_property().
         // See also mpv_event and mpv_event_property.
         case MPV_EVENT_PROPERTY_CHANGE:
-            processMpvPropertyChange(event->data);
+            processMpvPropertyChange(event);
             shouldOutput = false;
             break;
         // Happens if the internal per-mpv_handle ringbuffer overflows, and at
@@ -1289,12 +1816,20 @@ void MPVPlayer::handleMpvEvents()
         // continue the hook with mpv_hook_continue().
         // See also mpv_event and mpv_event_hook.
         case MPV_EVENT_HOOK:
+            if (event.replyUserdata == kAdaptiveResolutionHook) {
+                applyAdaptiveResolution(videoSizeFromTracks(event.nodeValue.value<MediaTracks>()));
+            }
+            // The loading is blocked until the hook is continued, the decoder
+            // options above have been queued before it.
+            if (m_eventThread) {
+                m_eventThread->continueHook(event.hookId);
+            }
             break;
         default:
             break;
         }
         if (shouldOutput && !m_livePreview) {
-            qCDebug(lcQMPMPV) << mpv_event_name(event->event_id) << "event received.";
+            qCDebug(lcQMPMPV) << mpv_event_name(event.id) << "event received.";
         }
     }
 }
@@ -1321,6 +1856,17 @@ void MPVPlayer::releaseResources() // Called on the gui thread if the item is re
     m_node = nullptr;
 }
 
+bool MPVPlayer::isTextureProvider() const
+{
+    return true;
+}
+
+QSGTextureProvider *MPVPlayer::textureProvider() const
+{
+    // Only valid on the render thread, like the node itself.
+    return m_node;
+}
+
 QSGNode *MPVPlayer::updatePaintNode(QSGNode *node, UpdatePaintNodeData *data)
 {
     Q_UNUSED(data);
@@ -1350,6 +1896,7 @@ void MPVPlayer::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeom
 #endif
     if (newGeometry.size() != oldGeometry.size()) {
         update();
+        applyAdaptiveResolution(videoSize());
     }
 }
 
@@ -26,6 +26,7 @@
 
 #include "mpvbackend_global.h"
 #include <playerinterface.h>
+#include <QtCore/qatomic.h>
 
 struct mpv_handle;
 struct mpv_render_context;
@@ -33,6 +34,8 @@ struct mpv_render_context;
 QTMEDIAPLAYER_BEGIN_NAMESPACE
 
 class MPVVideoTextureNode;
+class MPVEventThread;
+struct MPVEvent;
 
 class MPVPlayer : public MediaPlayer
 {
@@ -41,8 +44,10 @@ class MPVPlayer : public MediaPlayer
     QML_NAMED_ELEMENT(MediaPlayer)
 #endif
     Q_DISABLE_COPY_MOVE(MPVPlayer)
+    Q_PROPERTY(int renderBufferCount READ renderBufferCount WRITE setRenderBufferCount NOTIFY renderBufferCountChanged FINAL)
 
     friend class MPVVideoTextureNode;
+    friend class MPVEventThread;
 
 public:
     explicit MPVPlayer(QQuickItem *parent = nullptr);
@@ -133,6 +138,14 @@ public:
 
     Q_NODISCARD bool rendererReady() const override;
 
+    // The video can be shown by other items, see VideoMirror.
+    Q_NODISCARD bool isTextureProvider() const override;
+    Q_NODISCARD QSGTextureProvider *textureProvider() const override;
+
+    // How many render targets the OpenGL renderer cycles through (2 or 3).
+    Q_NODISCARD int renderBufferCount() const;
+    void setRenderBufferCount(const int value);
+
 public Q_SLOTS:
     void play() override;
     void pause() override;
@@ -148,10 +161,29 @@ public:
     Q_NODISCARD Q_INVOKABLE bool isPaused() const override;
     Q_NODISCARD Q_INVOKABLE bool isStopped() const override;
 
-protected Q_SLOTS:
-    void handleMpvEvents();
+    Q_NODISCARD Q_INVOKABLE quint64 loadAsync(const QUrl &url) override;
+    Q_NODISCARD Q_INVOKABLE quint64 seekAsync(const qint64 value) override;
+    Q_NODISCARD Q_INVOKABLE quint64 setActiveTrackAsync(const TrackType type, const int value) override;
+    Q_NODISCARD Q_INVOKABLE quint64 setPropertyAsync(const QString &name, const QVariant &value) override;
+
+    Q_INVOKABLE void setSourceDevice(QIODevice *device, const QString &name = {}) override;
+
+    Q_NODISCARD Q_INVOKABLE quint64 grabFrame(const QSize &size = {}) override;
+
+    Q_NODISCARD Q_INVOKABLE quint64 postedMpvWakeups() const;
+    Q_NODISCARD Q_INVOKABLE quint64 coalescedMpvWakeups() const;
+
+    Q_NODISCARD Q_INVOKABLE quint64 renderedFrames() const;
+    // How often a new frame had to wait because no back buffer was free.
+    Q_NODISCARD Q_INVOKABLE quint64 renderRingUnderruns() const;
 
 protected:
+    Q_NODISCARD qreal precisePosition() const override;
+    void applyVideoSuspension(const bool suspend) override;
+
+    void drainMpvEvents();
+    void handleMpvEvents(const QVector<MPVEvent> &events);
+
     Q_NODISCARD QSGNode *updatePaintNode(QSGNode *node, UpdatePaintNodeData *data) override;
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
     void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
@@ -170,78 +202,120 @@ private:
 
     void releaseResources() override;
 
+    Q_NODISCARD bool isSourceSupported(const QUrl &value) const;
+    void startLoad(const QUrl &value, const quint64 id);
+    void doSeek(const qint64 value, const quint64 id);
+    void notifyStopped();
+    void failPendingLoads();
+    void finishPendingRequests(QList<quint64> &ids, const bool success, const QVariant &result = {});
+
     Q_NODISCARD bool mpvSendCommand(const QVariant &arguments);
+    Q_NODISCARD bool mpvSendCommandAsync(const QVariant &arguments, const quint64 id);
     Q_NODISCARD bool mpvSetProperty(const QString &name, const QVariant &value);
+    Q_NODISCARD bool mpvSetPropertyAsync(const QString &name, const QVariant &value, const quint64 id);
     Q_NODISCARD QVariant mpvGetProperty(const QString &name, const bool silent = false, bool *ok = nullptr) const;
-    Q_NODISCARD bool mpvObserveProperty(const QString &name);
+    Q_NODISCARD bool mpvObserveProperty(const quint64 id);
 
-    void processMpvLogMessage(void *event);
-    void processMpvPropertyChange(void *event);
+    void processMpvPropertyChange(const MPVEvent &event);
+    void processMpvReply(const MPVEvent &event);
+    void updatePropertyCache(const MPVEvent &event);
 
     void videoReconfig();
     void audioReconfig();
 
+    void applyAdaptiveResolution(const QSizeF &sourceSize);
+
 Q_SIGNALS:
     void onUpdate();
-    void hasMpvEvents();
+    void renderBufferCountChanged();
 
 private:
     mpv_handle *m_mpv = nullptr;
     mpv_render_context *m_mpv_gl = nullptr;
+    QScopedPointer<MPVEventThread> m_eventThread;
 
     MPVVideoTextureNode *m_node = nullptr;
 
     QUrl m_source = {};
     QUrl m_cachedUrl = {};
+    // The qiodevice:// URL of the device that is currently registered.
+    QUrl m_deviceUrl = {};
     MediaStatus m_mediaStatus = {};
     bool m_livePreview = false;
     bool m_autoStart = true;
     qint64 m_lastPosition = 0;
     bool m_rendererReady = false;
     bool m_loaded = false;
-
-    static inline const QHash<QString, QByteArrayList> properties =
+    // Read by the texture node in sync(), updated from the render thread.
+    int m_renderBufferCount = 2;
+    QAtomicInteger<quint64> m_renderedFrames = 0;
+    QAtomicInteger<quint64> m_renderRingUnderruns = 0;
+    // The video track to restore when the suspended video resumes, zero
+    // lets mpv choose.
+    qint64 m_suspendedVideoTrack = 0;
+    // The downscale the decoder options are set for, 1 means they hold the
+    // application's own values, which are kept here in the meantime.
+    int m_adaptiveDownscale = 1;
+    QString m_userSkipLoopFilter = {};
+    bool m_userLavcFast = false;
+
+    enum class RequestType
     {
-        {QStringLiteral("dwidth"), {QByteArrayLiteral("videoSizeChanged")}},
-        {QStringLiteral("dheight"), {QByteArrayLiteral("videoSizeChanged")}},
-        {QStringLiteral("duration"), {QByteArrayLiteral("durationChanged")}},
-        {QStringLiteral("time-pos"), {QByteArrayLiteral("positionChanged")}},
-        {QStringLiteral("volume"), {QByteArrayLiteral("volumeChanged")}},
-        {QStringLiteral("mute"), {QByteArrayLiteral("muteChanged")}},
-        {QStringLiteral("seekable"), {QByteArrayLiteral("seekableChanged")}},
-        {QStringLiteral("hwdec"), {QByteArrayLiteral("hardwareDecodingChanged")}},
-        {QStringLiteral("video-out-params/aspect"), {QByteArrayLiteral("aspectRatioChanged")}},
-        {QStringLiteral("speed"), {QByteArrayLiteral("playbackRateChanged")}},
-        {QStringLiteral("filename"), {QByteArrayLiteral("fileNameChanged")}},
-        {QStringLiteral("screenshot-format"), {QByteArrayLiteral("snapshotFormatChanged")}},
-        {QStringLiteral("screenshot-template"), {QByteArrayLiteral("snapshotTemplateChanged")}},
-        {QStringLiteral("screenshot-directory"), {QByteArrayLiteral("snapshotDirectoryChanged")}},
-        {QStringLiteral("path"), {QByteArrayLiteral("filePathChanged")}},
-        {QStringLiteral("pause"), {QByteArrayLiteral("playbackStateChanged")}},
-        {QStringLiteral("idle-active"), {QByteArrayLiteral("playbackStateChanged")}},
-        {QStringLiteral("track-list"), {QByteArrayLiteral("mediaTracksChanged")}},
-        {QStringLiteral("chapter-list"), {QByteArrayLiteral("chaptersChanged")}},
-        {QStringLiteral("metadata"), {QByteArrayLiteral("metaDataChanged")}},
-        {QStringLiteral("video-unscaled"), {QByteArrayLiteral("fillModeChanged")}},
-        {QStringLiteral("keepaspect"), {QByteArrayLiteral("fillModeChanged")}},
-        {QStringLiteral("vid"), {QByteArrayLiteral("activeVideoTrackChanged")}},
-        {QStringLiteral("aid"), {QByteArrayLiteral("activeAudioTrackChanged")}},
-        {QStringLiteral("sid"), {QByteArrayLiteral("activeSubtitleTrackChanged")}}
+        Load,
+        Seek,
+        GrabFrame,
+        Other
     };
-
-    // These properties are changing all the time during the playback process.
-    // So we have to add them to the black list, otherwise we'll get huge
-    // message floods.
-    static inline const QStringList propertyBlackList =
+    // Asynchronous requests waiting for their reply from mpv.
+    QHash<quint64, RequestType> m_pendingRequests = {};
+    // Accepted by mpv, but the file has not started loading yet.
+    QList<quint64> m_loadingRequests = {};
+    // The file has started loading, but it's not loaded yet.
+    QList<quint64> m_openingRequests = {};
+    // Accepted by mpv, but the seek has not started yet.
+    QList<quint64> m_seekingRequests = {};
+    // The seek has started, but the playback has not restarted yet.
+    QList<quint64> m_restartingRequests = {};
+    quint64 m_cachedRequestId = 0;
+    // The sizes the grabbed frames should be scaled to.
+    QHash<quint64, QSize> m_frameGrabSizes = {};
+
+    // Last known values of the observed properties. They are registered with
+    // their native formats and updated from MPV_EVENT_PROPERTY_CHANGE, so the
+    // getters only need to read memory instead of querying libmpv. The setters
+    // write the requested value in here as well, so reading it back or
+    // changing it again before the change event arrives sees the new value.
+    struct PropertyCache
     {
-        QStringLiteral("time-pos"),
-        QStringLiteral("playback-time"),
-        QStringLiteral("percent-pos"),
-        QStringLiteral("video-bitrate"),
-        QStringLiteral("audio-bitrate"),
-        QStringLiteral("estimated-vf-fps"),
-        QStringLiteral("avsync")
-    };
+        qreal duration = 0.0;
+        qreal timePos = 0.0;
+        qreal volume = 100.0;
+        qreal aspect = 0.0;
+        qreal speed = 1.0;
+        qint64 dwidth = 0;
+        qint64 dheight = 0;
+        qint64 vid = 0;
+        qint64 aid = 0;
+        qint64 sid = 0;
+        bool mute = false;
+        bool seekable = false;
+        bool pause = false;
+        bool idleActive = true;
+        bool keepaspect = true;
+        QString hwdecCurrent = {};
+        QString fileName = {};
+        QString path = {};
+        QString screenshotFormat = {};
+        QString screenshotTemplate = {};
+        QString screenshotDirectory = {};
+        QString videoUnscaled = {};
+        QString skipLoopFilter = {};
+        QString msgLevel = {};
+        bool lavcFast = false;
+        MediaTracks mediaTracks = {};
+        Chapters chapters = {};
+        MetaData metaData = {};
+    } m_cache = {};
 };
 
 QTMEDIAPLAYER_END_NAMESPACE
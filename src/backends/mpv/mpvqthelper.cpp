@@ -76,18 +76,30 @@
 #define WWX190_NOTNULL_MPVAPI(funcName) (m_lp_##funcName != nullptr)
 #endif
 
+// Only the lookup of the function pointer is protected by the mutex. The
+// client API of libmpv is thread-safe by itself, and holding the lock during
+// the call would serialize every player and dead lock as soon as a thread
+// blocks in mpv_wait_event().
+#ifndef WWX190_GET_MPVAPI
+#define WWX190_GET_MPVAPI(funcName) \
+    const auto _lp_##funcName = [](){ \
+        QMutexLocker locker(&MPV::Qt::mpvData()->m_mutex); \
+        return MPV::Qt::mpvData()->m_lp_##funcName; \
+    }();
+#endif
+
 #ifndef WWX190_CALL_MPVAPI
 #define WWX190_CALL_MPVAPI(funcName, ...) \
-    QMutexLocker locker(&MPV::Qt::mpvData()->m_mutex); \
-    if (MPV::Qt::mpvData()->m_lp_##funcName) { \
-        MPV::Qt::mpvData()->m_lp_##funcName(__VA_ARGS__); \
+    WWX190_GET_MPVAPI(funcName) \
+    if (_lp_##funcName) { \
+        _lp_##funcName(__VA_ARGS__); \
     }
 #endif
 
 #ifndef WWX190_CALL_MPVAPI_RETURN
 #define WWX190_CALL_MPVAPI_RETURN(funcName, defRet, ...) \
-    QMutexLocker locker(&MPV::Qt::mpvData()->m_mutex); \
-    return (MPV::Qt::mpvData()->m_lp_##funcName ? MPV::Qt::mpvData()->m_lp_##funcName(__VA_ARGS__) : defRet);
+    WWX190_GET_MPVAPI(funcName) \
+    return (_lp_##funcName ? _lp_##funcName(__VA_ARGS__) : defRet);
 #endif
 
 namespace MPV::Qt
@@ -412,6 +424,12 @@ struct MPVData
         return result;
     }
 
+    [[nodiscard]] inline QString fileName()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_library.fileName();
+    }
+
 private:
     Q_DISABLE_COPY_MOVE(MPVData)
     QLibrary m_library;
@@ -424,6 +442,14 @@ bool isLibmpvAvailable()
     return mpvData()->isLoaded();
 }
 
+QString getLibmpvFilePath()
+{
+    if (!mpvData()->isLoaded()) {
+        return {};
+    }
+    return mpvData()->fileName();
+}
+
 QString getLibmpvVersion()
 {
     const auto fullVerNum = mpv_client_api_version();
@@ -432,7 +458,7 @@ QString getLibmpvVersion()
     return QStringLiteral("%1.%2.0").arg(QString::number(majorVerNum), QString::number(minorVerNum));
 }
 
-[[nodiscard]] static inline QVariant node_to_variant(const mpv_node *node)
+QVariant node_to_variant(const mpv_node *node)
 {
     Q_ASSERT(node);
     if (!node) {
@@ -34,6 +34,7 @@ namespace MPV::Qt
 
 [[nodiscard]] bool isLibmpvAvailable();
 [[nodiscard]] QString getLibmpvVersion();
+[[nodiscard]] QString getLibmpvFilePath();
 
 /**
  * This is used to return error codes wrapped in QVariant for functions which
@@ -69,6 +70,14 @@ struct ErrorReturn
  */
 [[nodiscard]] bool is_error(const QVariant &v);
 
+/**
+ * Convert the given mpv_node to QVariant. Arrays become QVariantList and maps
+ * become QVariantMap. The node is not freed.
+ *
+ * @return the converted value, or QVariant() for unsupported formats
+ */
+[[nodiscard]] QVariant node_to_variant(const mpv_node *node);
+
 /**
  * Return the given property as mpv_node converted to QVariant, or QVariant()
  * on error.
@@ -0,0 +1,265 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvstreamsource.h"
+#include "mpvqthelper.h"
+#include "include/mpv/stream_cb.h"
+#include <QtCore/qiodevice.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qresource.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qhash.h>
+#include <cstring>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+namespace MPVStreamSource
+{
+
+static const QString kResourceScheme = QStringLiteral("qrc");
+static const QString kDeviceScheme = QStringLiteral("qiodevice");
+
+struct DeviceRegistry
+{
+    QMutex mutex;
+    QHash<QString, QIODevice *> devices = {};
+    quint64 lastId = 0;
+};
+
+Q_GLOBAL_STATIC(DeviceRegistry, deviceRegistry)
+
+// The cookie handed to mpv. Exactly one of the three backends is used: a
+// block of memory, a device we own or a device the application owns.
+struct Stream
+{
+    const uchar *data = nullptr;
+    qint64 size = -1;
+    qint64 pos = 0;
+    QScopedPointer<QFile> file;
+    QIODevice *device = nullptr;
+
+    [[nodiscard]] QIODevice *io() const
+    {
+        return (file ? file.data() : device);
+    }
+};
+
+[[nodiscard]] static inline bool mapFile(Stream *stream, const QString &fileName)
+{
+    QScopedPointer<QFile> file(new QFile(fileName));
+    if (!file->open(QFile::ReadOnly)) {
+        return false;
+    }
+    const qint64 size = file->size();
+    if (size <= 0) {
+        return false;
+    }
+    uchar *data = file->map(0, size);
+    if (!data) {
+        return false;
+    }
+    // The mapping stays valid as long as the file object exists.
+    stream->data = data;
+    stream->size = size;
+    stream->file.reset(file.take());
+    return true;
+}
+
+[[nodiscard]] static inline bool openResource(Stream *stream, const QString &path)
+{
+    const QResource resource(path);
+    if (!resource.isValid()) {
+        return false;
+    }
+    if ((resource.compressionAlgorithm() == QResource::NoCompression) && resource.data()) {
+        // Uncompressed resources live in memory already.
+        stream->data = resource.data();
+        stream->size = resource.size();
+        return true;
+    }
+    QScopedPointer<QFile> file(new QFile(path));
+    if (!file->open(QFile::ReadOnly)) {
+        return false;
+    }
+    stream->size = file->size();
+    stream->file.reset(file.take());
+    return true;
+}
+
+[[nodiscard]] static inline bool openDevice(Stream *stream, const QString &key)
+{
+    QIODevice *device = nullptr;
+    {
+        const QMutexLocker locker(&deviceRegistry()->mutex);
+        device = deviceRegistry()->devices.value(key);
+    }
+    if (!device || !device->isOpen() || !device->isReadable()) {
+        return false;
+    }
+    // A plain file on disk: map it and leave the application's device alone.
+    if (const auto file = qobject_cast<QFile *>(device)) {
+        const QString fileName = file->fileName();
+        if (!fileName.isEmpty() && !fileName.startsWith(u':') && mapFile(stream, fileName)) {
+            return true;
+        }
+    }
+    // Rejected by the player already, see the header.
+    if (device->isSequential()) {
+        return false;
+    }
+    stream->device = device;
+    stream->size = device->size();
+    return device->seek(0);
+}
+
+static int64_t readFn(void *cookie, char *buf, uint64_t nbytes)
+{
+    const auto stream = static_cast<Stream *>(cookie);
+    if (stream->data) {
+        const qint64 length = qMin(static_cast<qint64>(nbytes), stream->size - stream->pos);
+        if (length <= 0) {
+            return 0;
+        }
+        std::memcpy(buf, stream->data + stream->pos, static_cast<std::size_t>(length));
+        stream->pos += length;
+        return length;
+    }
+    // Random-access devices only return less than requested at the end.
+    return stream->io()->read(buf, static_cast<qint64>(nbytes));
+}
+
+static int64_t seekFn(void *cookie, int64_t offset)
+{
+    const auto stream = static_cast<Stream *>(cookie);
+    if (stream->data) {
+        if ((offset < 0) || (offset > stream->size)) {
+            return MPV_ERROR_GENERIC;
+        }
+        stream->pos = offset;
+        return offset;
+    }
+    if (!stream->io()->seek(offset)) {
+        return MPV_ERROR_GENERIC;
+    }
+    return offset;
+}
+
+static int64_t sizeFn(void *cookie)
+{
+    const auto stream = static_cast<Stream *>(cookie);
+    return ((stream->size >= 0) ? stream->size : MPV_ERROR_UNSUPPORTED);
+}
+
+static void closeFn(void *cookie)
+{
+    delete static_cast<Stream *>(cookie);
+}
+
+static int openFn(void *userData, char *uri, mpv_stream_cb_info *info)
+{
+    Q_UNUSED(userData);
+    const QUrl url(QString::fromUtf8(uri));
+    QScopedPointer<Stream> stream(new Stream);
+    bool opened = false;
+    if (isResourceUrl(url)) {
+        opened = openResource(stream.data(), resourceFilePath(url));
+    } else if (isDeviceUrl(url)) {
+        opened = openDevice(stream.data(), url.host());
+    }
+    if (!opened) {
+        qCWarning(lcQMPMPV) << "Failed to open" << url;
+        return MPV_ERROR_LOADING_FAILED;
+    }
+    info->cookie = stream.take();
+    info->read_fn = readFn;
+    info->seek_fn = seekFn;
+    info->size_fn = sizeFn;
+    info->close_fn = closeFn;
+    info->cancel_fn = nullptr;
+    return 0;
+}
+
+bool registerProtocols(mpv_handle *mpv)
+{
+    Q_ASSERT(mpv);
+    if (!mpv) {
+        return false;
+    }
+    const QByteArray resourceScheme = kResourceScheme.toUtf8();
+    const QByteArray deviceScheme = kDeviceScheme.toUtf8();
+    return ((mpv_stream_cb_add_ro(mpv, resourceScheme.constData(), nullptr, openFn) >= 0)
+            && (mpv_stream_cb_add_ro(mpv, deviceScheme.constData(), nullptr, openFn) >= 0));
+}
+
+QUrl registerDevice(QIODevice *device, const QString &name)
+{
+    Q_ASSERT(device);
+    if (!device) {
+        return {};
+    }
+    const QMutexLocker locker(&deviceRegistry()->mutex);
+    const QString key = QString::number(++deviceRegistry()->lastId);
+    deviceRegistry()->devices.insert(key, device);
+    QUrl url = {};
+    url.setScheme(kDeviceScheme);
+    url.setHost(key);
+    url.setPath(QStringLiteral("/") + (name.isEmpty() ? QStringLiteral("stream") : name));
+    return url;
+}
+
+void unregisterDevice(const QUrl &url)
+{
+    if (!isDeviceUrl(url)) {
+        return;
+    }
+    const QMutexLocker locker(&deviceRegistry()->mutex);
+    deviceRegistry()->devices.remove(url.host());
+}
+
+bool isDeviceUrl(const QUrl &url)
+{
+    return (QString::compare(url.scheme(), kDeviceScheme, Qt::CaseInsensitive) == 0);
+}
+
+bool isResourceUrl(const QUrl &url)
+{
+    return (QString::compare(url.scheme(), kResourceScheme, Qt::CaseInsensitive) == 0);
+}
+
+QString resourceFilePath(const QUrl &url)
+{
+    return (QStringLiteral(":") + url.path());
+}
+
+QString toMpvUrl(const QUrl &url)
+{
+    if (isResourceUrl(url)) {
+        return (kResourceScheme + QStringLiteral("://") + url.path());
+    }
+    return url.toString();
+}
+
+} // namespace MPVStreamSource
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mpvbackend_global.h"
+#include <QtCore/qurl.h>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+struct mpv_handle;
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// Custom mpv protocols backed by Qt's I/O classes:
+//   qrc:/path       embedded resources, uncompressed ones are read directly
+//                   from the memory they are mapped to.
+//   qiodevice://id  devices registered with registerDevice(). Devices that
+//                   are plain files on disk are memory mapped instead of
+//                   being read through the device.
+// The callbacks are invoked on mpv's demuxer thread, so a registered device
+// must not be used by anyone else while mpv is reading from it. That thread
+// has no event loop, so only random-access devices can be read: a sequential
+// device has nothing buffered most of the time and mpv would take that for
+// the end of the stream.
+namespace MPVStreamSource
+{
+
+[[nodiscard]] bool registerProtocols(mpv_handle *mpv);
+
+// The device must be random-access and stay alive until it is unregistered
+// and mpv has closed the stream. It is read from mpv's demuxer thread, not
+// the thread it belongs to. The name is only a hint for the format detection
+// and shows up as the file name.
+[[nodiscard]] QUrl registerDevice(QIODevice *device, const QString &name);
+void unregisterDevice(const QUrl &url);
+
+[[nodiscard]] bool isDeviceUrl(const QUrl &url);
+[[nodiscard]] bool isResourceUrl(const QUrl &url);
+
+// ":/path" for "qrc:/path".
+[[nodiscard]] QString resourceFilePath(const QUrl &url);
+
+// mpv only recognizes custom protocols in the "scheme://" form.
+[[nodiscard]] QString toMpvUrl(const QUrl &url);
+
+} // namespace MPVStreamSource
+
+QTMEDIAPLAYER_END_NAMESPACE
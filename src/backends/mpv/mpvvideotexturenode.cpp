@@ -26,9 +26,11 @@
 #include "mpvplayer.h"
 #include "mpvqthelper.h"
 #include "include/mpv/render_gl.h"
+#include <QtCore/qsysinfo.h>
 #include <QtCore/qdebug.h>
 #include <QtGui/qscreen.h>
 #include <QtGui/qopenglcontext.h>
+#include <QtGui/qopenglextrafunctions.h>
 #include <QtQuick/qquickwindow.h>
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
 #include <QtOpenGL/qopenglframebufferobject.h>
@@ -38,6 +40,11 @@
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
 #include <QtQuick/qquickopenglutils.h>
 #endif
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 6, 0))
+#include <rhi/qrhi.h>
+#elif (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+#include <QtGui/private/qrhi_p.h>
+#endif
 #if (defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID))
 #include <QtGui/qguiapplication.h>
 #include <QtGui/qpa/qplatformnativeinterface.h>
@@ -74,6 +81,205 @@ using Display = struct _XDisplay;
     return (glctx ? reinterpret_cast<void *>(glctx->getProcAddress(name)) : nullptr);
 }
 
+// libmpv's software renderer processes whole lines with SIMD code, keeping
+// both the surface and the stride aligned avoids its slow unaligned path.
+static constexpr const int kSoftwareAlignment = 64;
+
+// Both formats describe QImage::Format_RGB32, which needs no conversion before
+// it's uploaded by the software and the RHI scene graph backends.
+#if (Q_BYTE_ORDER == Q_LITTLE_ENDIAN)
+static constexpr const char kSoftwareFormat[] = "bgr0";
+#else
+static constexpr const char kSoftwareFormat[] = "0rgb";
+#endif
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+// The software frame on the RHI backends (Vulkan, Direct3D, Metal). The GPU
+// texture is created once for the size of the frame and every new frame is
+// uploaded into it, instead of creating a new texture from a QImage.
+class MPVSoftwareTexture final : public QSGDynamicTexture
+{
+    Q_DISABLE_COPY_MOVE(MPVSoftwareTexture)
+
+public:
+    // Shares the pixels of the frame, which libmpv renders into directly.
+    explicit MPVSoftwareTexture(const QImage &frame) : m_frame(frame) {}
+
+    ~MPVSoftwareTexture() override
+    {
+        // The RHI defers releasing the native texture until the frames that
+        // still use it are done.
+        delete m_texture;
+    }
+
+    Q_NODISCARD qint64 comparisonKey() const override
+    {
+        return static_cast<qint64>(reinterpret_cast<quintptr>(this));
+    }
+
+    Q_NODISCARD QRhiTexture *rhiTexture() const override
+    {
+        return m_texture;
+    }
+
+    Q_NODISCARD QSize textureSize() const override
+    {
+        return m_frame.size();
+    }
+
+    Q_NODISCARD bool hasAlphaChannel() const override
+    {
+        return false;
+    }
+
+    Q_NODISCARD bool hasMipmaps() const override
+    {
+        return false;
+    }
+
+    bool updateTexture() override
+    {
+        return false;
+    }
+
+    // A new frame has been rendered, upload it the next time the texture is used.
+    void markContentDirty()
+    {
+        m_contentDirty = true;
+    }
+
+    void commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates) override
+    {
+        if (!m_texture) {
+            // "bgr0" is laid out like BGRA8 in memory, everything else needs
+            // a conversion per frame.
+            m_native = ((Q_BYTE_ORDER == Q_LITTLE_ENDIAN) && rhi->isTextureFormatSupported(QRhiTexture::BGRA8));
+            m_texture = rhi->newTexture((m_native ? QRhiTexture::BGRA8 : QRhiTexture::RGBA8), m_frame.size());
+            if (!m_texture->create()) {
+                qCWarning(lcQMPMPV) << "Failed to create the texture of the software renderer.";
+                delete m_texture;
+                m_texture = nullptr;
+                return;
+            }
+            m_contentDirty = true;
+        }
+        if (!m_contentDirty) {
+            return;
+        }
+        m_contentDirty = false;
+        resourceUpdates->uploadTexture(m_texture, (m_native ? m_frame : m_frame.convertToFormat(QImage::Format_RGBA8888)));
+    }
+
+private:
+    QImage m_frame = {};
+    QRhiTexture *m_texture = nullptr;
+    bool m_native = true;
+    bool m_contentDirty = true;
+};
+#endif // (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+
+#if QT_CONFIG(opengl)
+// Rings of different sizes can't be exchanged through the pool.
+[[nodiscard]] static inline const char *openGLTargetKind(const int count)
+{
+    return ((count >= MPVVideoTextureNode::kMaxRenderBuffers) ? "mpv/opengl-3" : "mpv/opengl-2");
+}
+
+[[nodiscard]] static inline QOpenGLExtraFunctions *fenceFunctions()
+{
+    QOpenGLContext * const ctx = QOpenGLContext::currentContext();
+    if (!ctx) {
+        return nullptr;
+    }
+    const QSurfaceFormat format = ctx->format();
+    const bool supported = (ctx->isOpenGLES() ? (format.majorVersion() >= 3)
+        : ((format.version() >= qMakePair(3, 2)) || ctx->hasExtension(QByteArrayLiteral("GL_ARB_sync"))));
+    return (supported ? ctx->extraFunctions() : nullptr);
+}
+
+class MPVOpenGLRenderTarget final : public VideoRenderTarget
+{
+    Q_DISABLE_COPY_MOVE(MPVOpenGLRenderTarget)
+
+public:
+    explicit MPVOpenGLRenderTarget(const QSize &size, const int count)
+        : VideoRenderTarget(openGLTargetKind(count), size)
+    {
+        this->count = qBound(MPVVideoTextureNode::kMinRenderBuffers, count, MPVVideoTextureNode::kMaxRenderBuffers);
+        for (int i = 0; i != this->count; ++i) {
+            fbos[i].reset(new QOpenGLFramebufferObject(size));
+        }
+    }
+
+    ~MPVOpenGLRenderTarget() override
+    {
+        // Destroyed on the render thread, with the context still current.
+        QOpenGLExtraFunctions * const f = fenceFunctions();
+        for (auto &&fence : m_fences) {
+            if (fence && f) {
+                f->glDeleteSync(fence);
+            }
+            fence = nullptr;
+        }
+    }
+
+    // The scene graph stops sampling the buffer. Everything that reads from it
+    // has been queued before this point, so the fence tells when it's done.
+    void retire(const int index)
+    {
+        QOpenGLExtraFunctions * const f = fenceFunctions();
+        if (!f) {
+            // No fences, rely on the driver to order the commands.
+            return;
+        }
+        if (m_fences[index]) {
+            f->glDeleteSync(m_fences[index]);
+        }
+        m_fences[index] = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // Whether mpv can draw into the buffer without waiting for the GPU.
+    Q_NODISCARD bool isIdle(const int index)
+    {
+        if (!m_fences[index]) {
+            return true;
+        }
+        QOpenGLExtraFunctions * const f = fenceFunctions();
+        if (!f) {
+            return true;
+        }
+        const GLenum result = f->glClientWaitSync(m_fences[index], 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+        f->glDeleteSync(m_fences[index]);
+        m_fences[index] = nullptr;
+        return true;
+    }
+
+    QScopedPointer<QOpenGLFramebufferObject> fbos[MPVVideoTextureNode::kMaxRenderBuffers];
+    int count = 0;
+
+private:
+    GLsync m_fences[MPVVideoTextureNode::kMaxRenderBuffers] = {};
+};
+
+[[nodiscard]] static inline QSGTexture *wrapOpenGLTexture(QQuickWindow *window, const GLuint id, const QSize &size)
+{
+    if (!id) {
+        return nullptr;
+    }
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    return QNativeInterface::QSGOpenGLTexture::fromNative(id, window, size);
+#elif (QT_VERSION <= QT_VERSION_CHECK(5, 14, 0))
+    return window->createTextureFromId(id, size);
+#else
+    intmax_t nativeObj = static_cast<intmax_t>(id);
+    return window->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture, &nativeObj, 0, size);
+#endif
+}
+#endif // QT_CONFIG(opengl)
+
 static inline void on_mpv_redraw(void *ctx)
 {
     Q_ASSERT(ctx);
@@ -100,11 +306,26 @@ MPVVideoTextureNode::MPVVideoTextureNode(QQuickItem *item) : VideoTextureNode(it
 
 MPVVideoTextureNode::~MPVVideoTextureNode()
 {
-    const auto tex = texture();
-    if (tex) {
+    // Software frames are owned by the node itself (see sync()), the
+    // render target goes back to the pool in the base class.
+    releaseRingTextures();
+    qCDebug(lcQMPMPV) << "Renderer destroyed.";
+}
+
+void MPVVideoTextureNode::releaseRingTextures()
+{
+#if QT_CONFIG(opengl)
+    const auto target = static_cast<MPVOpenGLRenderTarget *>(renderTarget());
+    if (target && !m_softwareRendering) {
+        target->retire(m_frontBuffer);
+    }
+#endif
+    for (auto &&tex : m_ringTextures) {
         delete tex;
+        tex = nullptr;
     }
-    qCDebug(lcQMPMPV) << "Renderer destroyed.";
+    m_ringSize = 0;
+    m_frontBuffer = 0;
 }
 
 void MPVVideoTextureNode::sync()
@@ -117,27 +338,40 @@ void MPVVideoTextureNode::sync()
     // effectiveDevicePixelRatio() will always give the correct result even if QQuickWindow is not available.
     const auto dpr = m_window->effectiveDevicePixelRatio();
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
-    const QSize newSize = QSizeF(m_item->size() * dpr).toSize();
+    const QSize pixelSize = QSizeF(m_item->size() * dpr).toSize();
 #else
-    const QSize newSize = {qRound(m_item->width() * dpr), qRound(m_item->height() * dpr)};
+    const QSize pixelSize = {qRound(m_item->width() * dpr), qRound(m_item->height() * dpr)};
 #endif
-    if (texture() && (newSize == m_size)) {
-        return;
-    }
+    // Never render above the native video size, the scene graph scales up.
+    const QSize newSize = m_item->videoRenderSize(pixelSize);
     Q_ASSERT(m_item->m_mpv);
     if (!m_item->m_mpv) {
         return;
     }
-    m_size = newSize;
-    const auto tex = ensureTexture(nullptr, m_size);
-    if (!tex) {
+    // The software renderer draws at the exact size, there's no target to reuse.
+    const QSize targetSize = (m_softwareRendering ? newSize : chooseRenderTargetSize(m_targetSize, newSize));
+    const bool ringChanged = (!m_softwareRendering && (m_ringSize != m_item->m_renderBufferCount));
+    if (texture() && (newSize == m_size) && (targetSize == m_targetSize) && !ringChanged) {
         return;
     }
-    delete texture();
-    setTexture(tex);
-    // MUST set when texture() is available
-    setTextureCoordinatesTransform(TextureCoordinatesTransformFlag::NoTransform);
-    setFiltering(QSGTexture::Linear);
+    m_size = newSize;
+    if (!texture() || (targetSize != m_targetSize) || ringChanged || m_softwareRendering) {
+        const auto tex = ensureTexture(nullptr, targetSize);
+        if (!tex) {
+            return;
+        }
+        m_targetSize = targetSize;
+        // Software frames belong to the node, the OpenGL textures to the ring.
+        setOwnsTexture(m_softwareRendering);
+        presentTexture(tex);
+        // MUST set when texture() is available
+        setTextureCoordinatesTransform(TextureCoordinatesTransformFlag::NoTransform);
+        setFiltering(QSGTexture::Linear);
+    }
+    // Only the top-left part of the target is covered by the video.
+    setSourceRect(0, 0, m_size.width(), m_size.height());
+    // Either the target is new or the video has to be laid out again.
+    markFrameDirty();
     // Qt's own API will apply correct DPR automatically. Don't double scale.
     setRect(0, 0, m_item->width(), m_item->height());
 }
@@ -160,16 +394,59 @@ void MPVVideoTextureNode::render()
         return;
     }
 
+    // The window also repaints for reasons that have nothing to do with the
+    // video (animations of other items, for example). The texture still holds
+    // the last frame, only render again if mpv has something new for us.
+    if (mpv_render_context_update(m_item->m_mpv_gl) & MPV_RENDER_UPDATE_FRAME) {
+        markFrameDirty();
+    }
+    if (!takeFrameDirty()) {
+        return;
+    }
+
+    if (m_softwareRendering) {
+        renderSoftware();
+        return;
+    }
+
+#if QT_CONFIG(opengl)
+    const auto target = static_cast<MPVOpenGLRenderTarget *>(renderTarget());
+    if (!target) {
+        return;
+    }
+
+    // Never draw into the front buffer, and only into a back buffer the GPU
+    // is done with, so mpv and the scene graph don't wait for each other.
+    int backBuffer = -1;
+    for (int i = 1; i != target->count; ++i) {
+        const int index = ((m_frontBuffer + i) % target->count);
+        if (target->isIdle(index)) {
+            backBuffer = index;
+            break;
+        }
+    }
+    if (backBuffer < 0) {
+        // The ring ran dry: keep showing the current frame and try again with
+        // the next one.
+        m_item->m_renderRingUnderruns.fetchAndAddRelaxed(1);
+        markFrameDirty();
+        QMetaObject::invokeMethod(m_window, "update", Qt::QueuedConnection);
+        return;
+    }
+#endif // QT_CONFIG(opengl)
+
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
     QQuickOpenGLUtils::resetOpenGLState();
 #else
     m_window->resetOpenGLState();
 #endif
 
+#if QT_CONFIG(opengl)
+    // mpv only draws into the video's part of the (larger) target.
     mpv_opengl_fbo mpvFBO = {};
-    mpvFBO.fbo = static_cast<int>(fbo_gl->handle());
-    mpvFBO.w = fbo_gl->width();
-    mpvFBO.h = fbo_gl->height();
+    mpvFBO.fbo = static_cast<int>(target->fbos[backBuffer]->handle());
+    mpvFBO.w = m_size.width();
+    mpvFBO.h = m_size.height();
     mpvFBO.internal_format = 0;
 
     mpv_render_param params[] =
@@ -189,7 +466,13 @@ void MPVVideoTextureNode::render()
     };
     // See render_gl.h on what OpenGL environment mpv expects, and
     // other API details.
+    // The scene graph has sampled the front buffer for the last time.
+    target->retire(m_frontBuffer);
     mpv_render_context_render(m_item->m_mpv_gl, params);
+    m_frontBuffer = backBuffer;
+    presentTexture(m_ringTextures[m_frontBuffer]);
+    m_item->m_renderedFrames.fetchAndAddRelaxed(1);
+#endif // QT_CONFIG(opengl)
 
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
     QQuickOpenGLUtils::resetOpenGLState();
@@ -213,10 +496,6 @@ QSGTexture* MPVVideoTextureNode::ensureTexture(void *player, const QSize &size)
         return nullptr;
     }
 
-#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-    intmax_t nativeObj = 0;
-    int nativeLayout = 0; // Only usable in Vulkan.
-#endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
     const QSGRendererInterface *rif = m_window->rendererInterface();
     switch (rif->graphicsApi()) {
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
@@ -227,7 +506,21 @@ QSGTexture* MPVVideoTextureNode::ensureTexture(void *player, const QSize &size)
 #endif // (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
     {
 #if QT_CONFIG(opengl)
-        fbo_gl.reset(new QOpenGLFramebufferObject(size));
+        const int count = m_item->m_renderBufferCount;
+        releaseRingTextures();
+        auto target = static_cast<MPVOpenGLRenderTarget *>(recycleRenderTarget(openGLTargetKind(count), size));
+        if (!target) {
+            target = new MPVOpenGLRenderTarget(size, count);
+        }
+        setRenderTarget(target);
+        m_ringSize = count;
+        for (int i = 0; i != target->count; ++i) {
+            m_ringTextures[i] = wrapOpenGLTexture(m_window, target->fbos[i]->texture(), size);
+            if (!m_ringTextures[i]) {
+                releaseRingTextures();
+                return nullptr;
+            }
+        }
         if (!m_item->m_mpv_gl)
         {
             mpv_opengl_init_params gl_init_params =
@@ -272,38 +565,140 @@ QSGTexture* MPVVideoTextureNode::ensureTexture(void *player, const QSize &size)
             // a separate window to display it instead of rendering in our own QQuickItem.
             QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
         }
-        const auto tex = fbo_gl->texture();
-#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        nativeObj = static_cast<decltype(nativeObj)>(tex);
-#if (QT_VERSION <= QT_VERSION_CHECK(5, 14, 0))
-        return m_window->createTextureFromId(tex, size);
-#endif // (QT_VERSION <= QT_VERSION_CHECK(5, 14, 0))
-#else // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        if (tex) {
-            return QNativeInterface::QSGOpenGLTexture::fromNative(tex, m_window, size);
-        }
-#endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+        return m_ringTextures[m_frontBuffer];
 #else // QT_CONFIG(opengl)
-        qFatal("Rebuild Qt with OpenGL support!");
+        m_softwareRendering = true;
+        return ensureSoftwareTexture(m_size);
 #endif // QT_CONFIG(opengl)
     } break;
-    case QSGRendererInterface::Software:
-    {
-        // TODO: libmpv also supports software as VO, implement this.
-        qFatal("TO BE IMPLEMENTED: Software backend of libmpv.");
-    } break;
     default:
-        qFatal("Unsupported backend of libmpv: %d", static_cast<int>(rif->graphicsApi()));
-        break;
-    }
-#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
-    if (nativeObj) {
-        return m_window->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture, &nativeObj, nativeLayout, size);
+        // The software scene graph and all the RHI backends other than OpenGL
+        // (Vulkan, Direct3D, Metal) go through libmpv's software renderer.
+        m_softwareRendering = true;
+        return ensureSoftwareTexture(m_size);
     }
-#endif // (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
-#endif // (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
     return nullptr;
 }
 
+QSGTexture *MPVVideoTextureNode::ensureSoftwareTexture(const QSize &size)
+{
+    Q_ASSERT(m_item);
+    Q_ASSERT(m_window);
+    if (!m_item || !m_window) {
+        return nullptr;
+    }
+
+    Q_ASSERT(m_item->m_mpv);
+    if (!m_item->m_mpv) {
+        return nullptr;
+    }
+
+    if (size.isEmpty()) {
+        return nullptr;
+    }
+
+    if (!m_item->m_mpv_gl) {
+        mpv_render_param params[] =
+        {
+            {
+                MPV_RENDER_PARAM_API_TYPE,
+                const_cast<char *>(MPV_RENDER_API_TYPE_SW)
+            },
+            {
+                MPV_RENDER_PARAM_INVALID,
+                nullptr
+            }
+        };
+        if (mpv_render_context_create(&m_item->m_mpv_gl, m_item->m_mpv, params) < 0) {
+            qCWarning(lcQMPMPV) << "Failed to initialize the software renderer of libmpv.";
+            return nullptr;
+        }
+        mpv_render_context_set_update_callback(m_item->m_mpv_gl, on_mpv_redraw, m_item);
+
+        // If you try to play any media before this signal is emitted, libmpv will create
+        // a separate window to display it instead of rendering in our own QQuickItem.
+        QMetaObject::invokeMethod(m_item, "setRendererReady", Q_ARG(bool, true));
+    }
+
+    const int stride = ((size.width() * 4) + (kSoftwareAlignment - 1)) & ~(kSoftwareAlignment - 1);
+    const int bytes = (stride * size.height()) + kSoftwareAlignment;
+    // Only grow the buffer, shrinking the item must not cause a reallocation.
+    if (m_swBuffer.size() < bytes) {
+        m_swBuffer.resize(bytes);
+    }
+    const auto base = reinterpret_cast<quintptr>(m_swBuffer.data());
+    m_swPixels = reinterpret_cast<uchar *>((base + (kSoftwareAlignment - 1)) & ~static_cast<quintptr>(kSoftwareAlignment - 1));
+    m_swFrame = QImage(m_swPixels, size.width(), size.height(), stride, QImage::Format_RGB32);
+    m_swFrame.fill(Qt::black);
+    m_swTexture = nullptr;
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    // The software scene graph only draws its own pixmap textures.
+    if (m_window->rendererInterface()->graphicsApi() != QSGRendererInterface::Software) {
+        m_swTexture = new MPVSoftwareTexture(m_swFrame);
+        return m_swTexture;
+    }
+#endif
+    return m_window->createTextureFromImage(m_swFrame, QQuickWindow::TextureIsOpaque);
+}
+
+void MPVVideoTextureNode::renderSoftware()
+{
+    if (!m_swPixels || m_swFrame.isNull()) {
+        return;
+    }
+
+    int size[2] = {m_swFrame.width(), m_swFrame.height()};
+    auto stride = static_cast<size_t>(m_swFrame.bytesPerLine());
+    mpv_render_param params[] =
+    {
+        {
+            MPV_RENDER_PARAM_SW_SIZE,
+            size
+        },
+        {
+            MPV_RENDER_PARAM_SW_FORMAT,
+            const_cast<char *>(kSoftwareFormat)
+        },
+        {
+            MPV_RENDER_PARAM_SW_STRIDE,
+            &stride
+        },
+        {
+            MPV_RENDER_PARAM_SW_POINTER,
+            m_swPixels
+        },
+        {
+            MPV_RENDER_PARAM_INVALID,
+            nullptr
+        }
+    };
+    // Write through the raw pointer: touching m_swFrame's pixels would detach
+    // it from the copy the current texture still holds.
+    if (mpv_render_context_render(m_item->m_mpv_gl, params) < 0) {
+        return;
+    }
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    if (m_swTexture) {
+        // Same texture, new content. setTexture() must not be called with the
+        // texture the node already owns, it would delete it.
+        m_swTexture->markContentDirty();
+        markDirty(QSGNode::DirtyMaterial);
+        Q_EMIT textureChanged();
+        return;
+    }
+#endif
+
+    // The software scene graph, and the RHI of Qt 5: the new texture only
+    // takes a shallow copy of the frame, the pixels are uploaded (or converted
+    // to a pixmap) by the scene graph when it's drawn. The node owns it and
+    // deletes the previous one.
+    const auto tex = m_window->createTextureFromImage(m_swFrame, QQuickWindow::TextureIsOpaque);
+    if (!tex) {
+        return;
+    }
+    presentTexture(tex);
+    setFiltering(QSGTexture::Linear);
+}
+
 QTMEDIAPLAYER_END_NAMESPACE
@@ -26,15 +26,17 @@
 
 #include "mpvbackend_global.h"
 #include <texturenodeinterface.h>
+#include <QtCore/qbytearray.h>
+#include <QtGui/qimage.h>
 
 QT_BEGIN_NAMESPACE
-QT_FORWARD_DECLARE_CLASS(QOpenGLFramebufferObject)
 QT_FORWARD_DECLARE_CLASS(QQuickWindow)
 QT_END_NAMESPACE
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
 
 class MPVPlayer;
+class MPVSoftwareTexture;
 
 class MPVVideoTextureNode final : public VideoTextureNode
 {
@@ -42,6 +44,10 @@ class MPVVideoTextureNode final : public VideoTextureNode
     Q_DISABLE_COPY_MOVE(MPVVideoTextureNode)
 
 public:
+    // Number of render targets the OpenGL path cycles through.
+    static constexpr const int kMinRenderBuffers = 2;
+    static constexpr const int kMaxRenderBuffers = 3;
+
     explicit MPVVideoTextureNode(QQuickItem *item);
     ~MPVVideoTextureNode() override;
 
@@ -54,12 +60,31 @@ protected:
     Q_NODISCARD QSGTexture *ensureTexture(void *player, const QSize &size) override;
 
 private:
-#if QT_CONFIG(opengl)
-    QScopedPointer<QOpenGLFramebufferObject> fbo_gl;
-#endif
+    Q_NODISCARD QSGTexture *ensureSoftwareTexture(const QSize &size);
+    void renderSoftware();
+    void releaseRingTextures();
+
+private:
     QQuickWindow *m_window = nullptr;
     MPVPlayer *m_item = nullptr;
+    // Size of the video, in pixels.
     QSize m_size = {};
+    // Size of the render target, which is usually a bit larger than the video.
+    QSize m_targetSize = {};
+    // OpenGL only: mpv renders into one of the back buffers while the scene
+    // graph keeps sampling the front buffer, then the node switches over.
+    QSGTexture *m_ringTextures[kMaxRenderBuffers] = {};
+    int m_ringSize = 0;
+    int m_frontBuffer = 0;
+    // Used when the scene graph is not backed by OpenGL. libmpv renders into
+    // a CPU buffer which only grows and is reused for all following frames,
+    // m_swFrame wraps it without copying. On the RHI backends the frame is
+    // uploaded into m_swTexture, which is replaced only when the size changes.
+    bool m_softwareRendering = false;
+    QByteArray m_swBuffer = {};
+    uchar *m_swPixels = nullptr;
+    QImage m_swFrame = {};
+    MPVSoftwareTexture *m_swTexture = nullptr;
 };
 
 QTMEDIAPLAYER_END_NAMESPACE
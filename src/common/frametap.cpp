@@ -0,0 +1,144 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "frametap.h"
+#include <QtCore/qthread.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+bool TapFrame::toYuvFrame(YuvConverter::Frame *frame) const
+{
+    Q_ASSERT(frame);
+    if (!frame) {
+        return false;
+    }
+    switch (format) {
+    case PixelFormat::I420:
+        frame->format = YuvConverter::PixelFormat::I420;
+        break;
+    case PixelFormat::NV12:
+        frame->format = YuvConverter::PixelFormat::NV12;
+        break;
+    case PixelFormat::P010:
+        frame->format = YuvConverter::PixelFormat::P010;
+        break;
+    default:
+        return false;
+    }
+    frame->size = size;
+    for (int i = 0; i != 3; ++i) {
+        frame->planes[i] = ((i < planeCount) ? reinterpret_cast<const uchar *>(planes[i].constData()) : nullptr);
+        frame->strides[i] = ((i < planeCount) ? strides[i] : 0);
+    }
+    return true;
+}
+
+FrameTap::FrameTap(const Consumer &consumer, const int capacity, const Policy policy)
+    : m_consumer(consumer), m_capacity(qMax(capacity, 1)), m_policy(policy)
+{
+    Q_ASSERT(m_consumer);
+    m_thread = QThread::create([this](){ consume(); });
+    m_thread->setObjectName(QStringLiteral("QtMediaPlayerFrameTap"));
+    m_thread->start();
+}
+
+FrameTap::~FrameTap()
+{
+    {
+        const QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_frameAvailable.wakeAll();
+        // Don't leave a blocked decoder behind.
+        m_spaceAvailable.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+int FrameTap::capacity() const
+{
+    return m_capacity;
+}
+
+FrameTap::Policy FrameTap::policy() const
+{
+    return m_policy;
+}
+
+void FrameTap::push(const TapFramePtr &frame)
+{
+    if (!frame) {
+        return;
+    }
+    const QMutexLocker locker(&m_mutex);
+    if (m_quit) {
+        return;
+    }
+    if (m_policy == Policy::Block) {
+        while ((m_frames.size() >= m_capacity) && !m_quit) {
+            m_spaceAvailable.wait(&m_mutex);
+        }
+        if (m_quit) {
+            return;
+        }
+    } else if (m_frames.size() >= m_capacity) {
+        m_frames.dequeue();
+        m_droppedFrames.fetchAndAddRelaxed(1);
+    }
+    m_frames.enqueue(frame);
+    m_frameAvailable.wakeOne();
+}
+
+quint64 FrameTap::deliveredFrames() const
+{
+    return m_deliveredFrames.loadRelaxed();
+}
+
+quint64 FrameTap::droppedFrames() const
+{
+    return m_droppedFrames.loadRelaxed();
+}
+
+void FrameTap::consume()
+{
+    while (true) {
+        TapFramePtr frame = {};
+        {
+            const QMutexLocker locker(&m_mutex);
+            while (m_frames.isEmpty() && !m_quit) {
+                m_frameAvailable.wait(&m_mutex);
+            }
+            if (m_quit) {
+                break;
+            }
+            frame = m_frames.dequeue();
+            m_spaceAvailable.wakeOne();
+        }
+        m_consumer(frame);
+        m_deliveredFrames.fetchAndAddRelaxed(1);
+    }
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,123 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "common_global.h"
+#include "yuvconverter.h"
+#include <QtCore/qbytearray.h>
+#include <QtCore/qsize.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qwaitcondition.h>
+#include <QtCore/qatomic.h>
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+QT_FORWARD_DECLARE_CLASS(QThread)
+QT_END_NAMESPACE
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// A decoded video frame in host memory. It's shared by all taps through
+// TapFramePtr and never modified after it has been pushed, so consumers may
+// keep it as long as they like.
+struct QTMEDIAPLAYER_COMMON_API TapFrame
+{
+    enum class PixelFormat
+    {
+        Unknown,
+        I420,
+        NV12,
+        P010,
+        RGBA,
+        BGRA
+    };
+
+    PixelFormat format = PixelFormat::Unknown;
+    QSize size = {};
+    // Presentation time in seconds.
+    qreal timestamp = 0.0;
+    int planeCount = 0;
+    QByteArray planes[3] = {};
+    // In bytes.
+    int strides[3] = {};
+
+    // The planes in the layout the YUV converter expects. Returns false for
+    // the RGB formats.
+    Q_NODISCARD bool toYuvFrame(YuvConverter::Frame *frame) const;
+};
+
+using TapFramePtr = QSharedPointer<const TapFrame>;
+
+// Hands the decoded frames of a player to C++ code, see MediaPlayer::addFrameTap().
+// The consumer runs on a thread of its own, one frame at a time. Frames wait
+// in a bounded queue while the consumer is busy: with DropOldest the oldest
+// one is thrown away when a new frame arrives and the queue is full, with
+// Block the decoder waits for the consumer, which slows down the playback.
+class QTMEDIAPLAYER_COMMON_API FrameTap
+{
+    Q_DISABLE_COPY_MOVE(FrameTap)
+
+public:
+    enum class Policy
+    {
+        DropOldest,
+        Block
+    };
+
+    using Consumer = std::function<void(const TapFramePtr &frame)>;
+
+    explicit FrameTap(const Consumer &consumer, const int capacity = 4, const Policy policy = Policy::DropOldest);
+    // Waits for the consumer to return, the frames still queued are discarded.
+    ~FrameTap();
+
+    Q_NODISCARD int capacity() const;
+    Q_NODISCARD Policy policy() const;
+
+    // Called by the backends on their decoder threads.
+    void push(const TapFramePtr &frame);
+
+    Q_NODISCARD quint64 deliveredFrames() const;
+    Q_NODISCARD quint64 droppedFrames() const;
+
+private:
+    void consume();
+
+private:
+    Consumer m_consumer = nullptr;
+    int m_capacity = 4;
+    Policy m_policy = Policy::DropOldest;
+    QThread *m_thread = nullptr;
+    QMutex m_mutex;
+    QWaitCondition m_frameAvailable;
+    QWaitCondition m_spaceAvailable;
+    QQueue<TapFramePtr> m_frames = {};
+    bool m_quit = false;
+    QAtomicInteger<quint64> m_deliveredFrames = 0;
+    QAtomicInteger<quint64> m_droppedFrames = 0;
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
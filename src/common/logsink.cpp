@@ -0,0 +1,243 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logsink.h"
+#include <QtCore/qthread.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qtextstream.h>
+#include <cstring>
+#include <atomic>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+Q_GLOBAL_STATIC(LogSink, logSinkInstance)
+
+[[nodiscard]] static inline const char *msgTypeToString(const QtMsgType type)
+{
+    switch (type) {
+    case QtDebugMsg:
+        return "debug";
+    case QtInfoMsg:
+        return "info";
+    case QtWarningMsg:
+        return "warning";
+    case QtCriticalMsg:
+        return "critical";
+    case QtFatalMsg:
+        return "fatal";
+    }
+    return "unknown";
+}
+
+// Copies at most (size - 1) bytes and always terminates the string.
+static inline void copyString(char *dst, const char *src, const std::size_t size)
+{
+    if (!src) {
+        dst[0] = '\0';
+        return;
+    }
+    std::size_t length = 0;
+    while ((length < (size - 1)) && (src[length] != '\0')) {
+        ++length;
+    }
+    std::memcpy(dst, src, length);
+    dst[length] = '\0';
+}
+
+LogSink::LogSink(QObject *parent) : QObject(parent)
+{
+    qRegisterMetaType<LogRecord>();
+    for (int i = 0; i != kSlotCount; ++i) {
+        m_slots[i].sequence.storeRelaxed(static_cast<quint64>(i));
+    }
+    m_thread = QThread::create([this](){ consume(); });
+    m_thread->setObjectName(QStringLiteral("QtMediaPlayerLogSink"));
+    m_thread->start(QThread::LowPriority);
+}
+
+LogSink::~LogSink()
+{
+    m_quit.storeRelease(1);
+    {
+        const QMutexLocker locker(&m_waitMutex);
+        m_waitCondition.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+LogSink *LogSink::instance()
+{
+    return logSinkInstance();
+}
+
+bool LogSink::isEnabled(const QLoggingCategory &category, const QtMsgType type)
+{
+    return category.isEnabled(type);
+}
+
+void LogSink::post(const QLoggingCategory &category, const QtMsgType type, const char *module,
+                   const char *text, const quintptr playerId)
+{
+    if (!text || (text[0] == '\0') || !category.isEnabled(type)) {
+        return;
+    }
+    // Bounded multi-producer queue: every slot carries a sequence number that
+    // tells whether it's free for the given position or still being read.
+    Slot *slot = nullptr;
+    quint64 pos = m_enqueuePos.loadRelaxed();
+    while (true) {
+        slot = &m_slots[pos & (kSlotCount - 1)];
+        const quint64 sequence = slot->sequence.loadAcquire();
+        const qint64 diff = static_cast<qint64>(sequence) - static_cast<qint64>(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.testAndSetRelaxed(pos, pos + 1, pos)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full. Never block the decoder threads for a log message.
+            m_dropped.fetchAndAddRelaxed(1);
+            return;
+        } else {
+            pos = m_enqueuePos.loadRelaxed();
+        }
+    }
+    slot->timestamp = QDateTime::currentMSecsSinceEpoch();
+    slot->type = type;
+    slot->playerId = playerId;
+    copyString(slot->category, category.categoryName(), kCategorySize);
+    copyString(slot->module, module, kModuleSize);
+    copyString(slot->text, text, kTextSize);
+    slot->sequence.storeRelease(pos + 1);
+    // Pairs with the fence in consume(): either the consumer sees the new
+    // sequence before it sleeps or we see its idle flag and wake it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Only take the lock if the consumer is actually sleeping.
+    if (m_idle.loadRelaxed() != 0) {
+        const QMutexLocker locker(&m_waitMutex);
+        m_waitCondition.wakeOne();
+    }
+}
+
+void LogSink::setLogFilePath(const QString &value)
+{
+    const QMutexLocker locker(&m_fileMutex);
+    if (m_file.fileName() == value) {
+        return;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_file.setFileName(value);
+    if (value.isEmpty()) {
+        return;
+    }
+    if (!m_file.open(QFile::WriteOnly | QFile::Append | QFile::Text)) {
+        qWarning() << "Failed to open the log file" << value << ':' << m_file.errorString();
+    }
+}
+
+QString LogSink::logFilePath() const
+{
+    const QMutexLocker locker(&m_fileMutex);
+    return m_file.fileName();
+}
+
+quint64 LogSink::droppedMessages() const
+{
+    return m_dropped.loadRelaxed();
+}
+
+void LogSink::consume()
+{
+    while (true) {
+        Slot &slot = m_slots[m_dequeuePos & (kSlotCount - 1)];
+        if (slot.sequence.loadAcquire() == (m_dequeuePos + 1)) {
+            LogRecord record = {};
+            record.timestamp = slot.timestamp;
+            record.type = slot.type;
+            const QByteArray category = QByteArray(slot.category);
+            record.playerId = slot.playerId;
+            record.module = QString::fromUtf8(slot.module);
+            // The messages from the backends usually contain a new line.
+            record.message = QString::fromUtf8(slot.text).trimmed();
+            slot.sequence.storeRelease(m_dequeuePos + kSlotCount);
+            ++m_dequeuePos;
+            record.category = QString::fromUtf8(category);
+            if (!record.message.isEmpty()) {
+                write(record);
+                // The category was already checked by post().
+                const QMessageLogger logger(nullptr, 0, nullptr, category.constData());
+                switch (record.type) {
+                case QtDebugMsg:
+                    logger.debug().noquote() << record.module << record.message;
+                    break;
+                case QtInfoMsg:
+                    logger.info().noquote() << record.module << record.message;
+                    break;
+                case QtWarningMsg:
+                    logger.warning().noquote() << record.module << record.message;
+                    break;
+                case QtCriticalMsg:
+                case QtFatalMsg:
+                    logger.critical().noquote() << record.module << record.message;
+                    break;
+                }
+                Q_EMIT messageLogged(record);
+            }
+            continue;
+        }
+        if (m_quit.loadAcquire() != 0) {
+            break;
+        }
+        const QMutexLocker locker(&m_waitMutex);
+        m_idle.storeRelaxed(1);
+        // Pairs with the fence in post(), so a producer that published after
+        // the check below is guaranteed to see the flag and wake us up.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((m_slots[m_dequeuePos & (kSlotCount - 1)].sequence.loadAcquire() != (m_dequeuePos + 1))
+            && (m_quit.loadAcquire() == 0)) {
+            m_waitCondition.wait(&m_waitMutex);
+        }
+        m_idle.storeRelaxed(0);
+    }
+}
+
+void LogSink::write(const LogRecord &record)
+{
+    const QMutexLocker locker(&m_fileMutex);
+    if (!m_file.isOpen()) {
+        return;
+    }
+    QTextStream stream(&m_file);
+    stream << QDateTime::fromMSecsSinceEpoch(record.timestamp).toString(Qt::ISODateWithMs)
+           << ' ' << msgTypeToString(record.type)
+           << ' ' << record.category
+           << " [" << record.module << ']'
+           << " 0x" << QString::number(record.playerId, 16)
+           << ' ' << record.message << '\n';
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,123 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "common_global.h"
+#include <QtCore/qobject.h>
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qwaitcondition.h>
+#include <QtCore/qfile.h>
+
+QT_BEGIN_NAMESPACE
+class QThread;
+QT_END_NAMESPACE
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+struct LogRecord
+{
+    qint64 timestamp = 0; // Milliseconds since epoch.
+    QtMsgType type = QtDebugMsg;
+    QString category = {};
+    QString module = {};
+    QString message = {};
+    quintptr playerId = 0;
+};
+
+// Collects the log messages of the backends. Producers only copy the raw
+// bytes into a lock-free ring buffer, the conversion to QString, the output
+// through the Qt logging framework and the optional log file are handled on
+// a separate consumer thread.
+class QTMEDIAPLAYER_COMMON_API LogSink : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(LogSink)
+
+public:
+    explicit LogSink(QObject *parent = nullptr);
+    ~LogSink() override;
+
+    Q_NODISCARD static LogSink *instance();
+
+    // Check this before doing any work for a message.
+    Q_NODISCARD static bool isEnabled(const QLoggingCategory &category, const QtMsgType type);
+
+    // Thread-safe and never blocks. Messages are truncated if they are too
+    // long and dropped if the buffer is full. Only the name of the category
+    // is queued, so it may come from a plugin that gets unloaded later.
+    void post(const QLoggingCategory &category, const QtMsgType type, const char *module,
+              const char *text, const quintptr playerId = 0);
+
+    // Also write every message to the given file, an empty path disables it.
+    void setLogFilePath(const QString &value);
+    Q_NODISCARD QString logFilePath() const;
+
+    Q_NODISCARD quint64 droppedMessages() const;
+
+Q_SIGNALS:
+    // Emitted on the consumer thread.
+    void messageLogged(const LogRecord &record);
+
+private:
+    void consume();
+    void write(const LogRecord &record);
+
+private:
+    static constexpr const int kSlotCount = 1024; // Must be a power of two.
+    static constexpr const int kCategorySize = 64;
+    static constexpr const int kModuleSize = 32;
+    static constexpr const int kTextSize = 448;
+
+    struct Slot
+    {
+        QAtomicInteger<quint64> sequence = 0;
+        qint64 timestamp = 0;
+        QtMsgType type = QtDebugMsg;
+        quintptr playerId = 0;
+        char category[kCategorySize] = {};
+        char module[kModuleSize] = {};
+        char text[kTextSize] = {};
+    };
+
+    Slot m_slots[kSlotCount];
+    QAtomicInteger<quint64> m_enqueuePos = 0;
+    quint64 m_dequeuePos = 0;
+    QAtomicInteger<quint64> m_dropped = 0;
+
+    QThread *m_thread = nullptr;
+    QAtomicInt m_quit = 0;
+    QAtomicInt m_idle = 0;
+    QMutex m_waitMutex;
+    QWaitCondition m_waitCondition;
+
+    mutable QMutex m_fileMutex;
+    QFile m_file;
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QTMEDIAPLAYER_PREPEND_NAMESPACE(LogRecord))
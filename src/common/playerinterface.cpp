@@ -23,12 +23,14 @@
  */
 
 #include "playerinterface.h"
+#include "snapshotwriter.h"
 #include <QtCore/qdebug.h>
 #include <QtCore/qdir.h>
 #include <QtCore/qmimedatabase.h>
 #include <QtCore/qmimetype.h>
 #include <QtCore/qdatetime.h>
 #include <QtCore/qfileinfo.h>
+#include <QtCore/qpointer.h>
 #include <QtGui/qguiapplication.h>
 #include <QtGui/qscreen.h>
 #include <QtGui/qabstractfileiconprovider.h>
@@ -119,6 +121,15 @@ static constexpr const qint64 GiB = 1024 * MiB;
     }
 }
 
+// Scale factors from the video to the given pixel size, per axis.
+[[nodiscard]] static inline QSizeF videoScale(const QSizeF &videoSize, const QSizeF &pixelSize)
+{
+    if (videoSize.isEmpty() || pixelSize.isEmpty()) {
+        return {};
+    }
+    return {pixelSize.width() / videoSize.width(), pixelSize.height() / videoSize.height()};
+}
+
 [[nodiscard]] static inline QString variantHashToString(const QVariantHash &hash)
 {
     if (hash.isEmpty()) {
@@ -166,6 +177,27 @@ MediaPlayer::MediaPlayer(QQuickItem *parent) : QQuickItem(parent)
     connect(this, &MediaPlayer::videoSizeChanged, this, &MediaPlayer::recommendedWindowSizeChanged);
     connect(this, &MediaPlayer::recommendedWindowSizeChanged, this, &MediaPlayer::recommendedWindowPositionChanged);
 
+    // Keep the presentation clock in sync with what the backend reports.
+    connect(this, &MediaPlayer::positionChanged, this, [this](){
+        m_clock->update(precisePosition());
+    });
+    connect(this, &MediaPlayer::durationChanged, this, [this](){
+        m_clock->setDuration(static_cast<qreal>(duration()));
+    });
+    connect(this, &MediaPlayer::playbackRateChanged, this, [this](){
+        m_clock->setRate(playbackRate());
+    });
+    connect(this, &MediaPlayer::playbackStateChanged, this, [this](){
+        m_clock->setRunning(isPlaying());
+    });
+    connect(this, &MediaPlayer::stopped, m_clock.data(), &PresentationClock::reset);
+
+    // Anything that can hide the item. Moving an ancestor or scrolling a
+    // Flickable doesn't notify us, so the check is repeated every frame.
+    connect(this, &MediaPlayer::visibleChanged, this, &MediaPlayer::updateVideoSuspension);
+    connect(this, &MediaPlayer::opacityChanged, this, &MediaPlayer::updateVideoSuspension);
+    connect(this, &MediaPlayer::windowChanged, this, &MediaPlayer::trackWindow);
+
     connect(this, &MediaPlayer::mediaTracksChanged, this, [this](){
         m_mediaInfo->resetInfo();
 
@@ -239,7 +271,12 @@ MediaPlayer::MediaPlayer(QQuickItem *parent) : QQuickItem(parent)
     });
 }
 
-MediaPlayer::~MediaPlayer() = default;
+MediaPlayer::~MediaPlayer()
+{
+    // QQuickItem notifies about the window and visibility changes while it
+    // is destroyed, don't react to them anymore.
+    disconnect(this, nullptr, this, nullptr);
+}
 
 QString MediaPlayer::graphicsApiName() const
 {
@@ -536,6 +573,203 @@ MediaInfo *MediaPlayer::mediaInfo() const
     return m_mediaInfo.data();
 }
 
+PresentationClock *MediaPlayer::clock() const
+{
+    return m_clock.data();
+}
+
+qreal MediaPlayer::precisePosition() const
+{
+    return static_cast<qreal>(position());
+}
+
+bool MediaPlayer::adaptiveResolution() const
+{
+    return m_adaptiveResolution;
+}
+
+void MediaPlayer::setAdaptiveResolution(const bool value)
+{
+    if (m_adaptiveResolution == value) {
+        return;
+    }
+    m_adaptiveResolution = value;
+    Q_EMIT adaptiveResolutionChanged();
+}
+
+QSize MediaPlayer::videoRenderSize(const QSize &pixelSize) const
+{
+    const QSizeF scale = videoScale(videoSize(), pixelSize);
+    if (scale.isEmpty()) {
+        return pixelSize;
+    }
+    // How much the video is magnified on screen. Stretch scales both axes
+    // independently, neither of them may drop below the native size.
+    const qreal factor = ((fillMode() == FillMode::PreserveAspectCrop)
+                              ? qMax(scale.width(), scale.height())
+                              : qMin(scale.width(), scale.height()));
+    if (factor <= qreal(1)) {
+        return pixelSize;
+    }
+    return {qMax(qRound(qreal(pixelSize.width()) / factor), 1),
+            qMax(qRound(qreal(pixelSize.height()) / factor), 1)};
+}
+
+bool MediaPlayer::suspendWhenHidden() const
+{
+    return m_suspendWhenHidden;
+}
+
+void MediaPlayer::setSuspendWhenHidden(const bool value)
+{
+    if (m_suspendWhenHidden == value) {
+        return;
+    }
+    m_suspendWhenHidden = value;
+    Q_EMIT suspendWhenHiddenChanged();
+    updateVideoSuspension();
+}
+
+bool MediaPlayer::videoSuspended() const
+{
+    return m_videoSuspended;
+}
+
+void MediaPlayer::applyVideoSuspension(const bool suspend)
+{
+    Q_UNUSED(suspend);
+}
+
+bool MediaPlayer::addFrameTap(const QSharedPointer<FrameTap> &tap)
+{
+    Q_UNUSED(tap);
+    qWarning() << backendName() << "can't provide decoded video frames.";
+    return false;
+}
+
+void MediaPlayer::removeFrameTap(const QSharedPointer<FrameTap> &tap)
+{
+    Q_UNUSED(tap);
+}
+
+bool MediaPlayer::isVideoHidden() const
+{
+    const QQuickWindow * const win = window();
+    if (!win || !isVisible()) {
+        return true;
+    }
+    const QWindow::Visibility visibility = win->visibility();
+    if ((visibility == QWindow::Hidden) || (visibility == QWindow::Minimized)) {
+        return true;
+    }
+    QRectF visibleRect = mapRectToScene(boundingRect()).intersected(QRectF(QPointF(0, 0), win->size()));
+    for (const QQuickItem *item = this; item; item = item->parentItem()) {
+        if (qFuzzyIsNull(item->opacity())) {
+            return true;
+        }
+        if (item->clip()) {
+            visibleRect = visibleRect.intersected(item->mapRectToScene(item->boundingRect()));
+        }
+    }
+    return visibleRect.isEmpty();
+}
+
+void MediaPlayer::updateVideoSuspension()
+{
+    const bool suspend = (m_suspendWhenHidden && isVideoHidden());
+    if (m_videoSuspended == suspend) {
+        return;
+    }
+    m_videoSuspended = suspend;
+    applyVideoSuspension(m_videoSuspended);
+    Q_EMIT videoSuspendedChanged();
+    if (!m_videoSuspended) {
+        update();
+    }
+}
+
+void MediaPlayer::trackWindow(QQuickWindow *win)
+{
+    for (auto &&connection : qAsConst(m_windowConnections)) {
+        disconnect(connection);
+    }
+    m_windowConnections.clear();
+    if (win) {
+        m_windowConnections.append(connect(win, &QQuickWindow::afterAnimating, this, &MediaPlayer::updateVideoSuspension));
+        m_windowConnections.append(connect(win, &QQuickWindow::visibilityChanged, this, &MediaPlayer::updateVideoSuspension));
+    }
+    updateVideoSuspension();
+}
+
+int MediaPlayer::adaptiveDownscale(const QSizeF &sourceSize) const
+{
+    if (!m_adaptiveResolution) {
+        return 1;
+    }
+    const QQuickWindow * const win = window();
+    const qreal dpr = (win ? win->effectiveDevicePixelRatio() : qreal(1));
+    const QSizeF scale = videoScale(sourceSize, size() * dpr);
+    if (scale.isEmpty()) {
+        return 1;
+    }
+    // Only the larger axis matters, except for PreserveAspectFit which
+    // letterboxes the other one.
+    const qreal factor = ((fillMode() == FillMode::PreserveAspectFit)
+                              ? qMin(scale.width(), scale.height())
+                              : qMax(scale.width(), scale.height()));
+    if (factor <= qreal(0.25)) {
+        return 4;
+    }
+    if (factor <= qreal(0.5)) {
+        return 2;
+    }
+    return 1;
+}
+
+quint64 MediaPlayer::createRequestId()
+{
+    // Zero is reserved for "no request".
+    return ++m_lastRequestId;
+}
+
+void MediaPlayer::finishFrameGrab(const quint64 id, const QImage &image, const QSize &size)
+{
+    if (id == 0) {
+        return;
+    }
+    if (image.isNull()) {
+        finishRequest(id, false);
+        return;
+    }
+    if (!size.isValid() || ((image.width() <= size.width()) && (image.height() <= size.height()))) {
+        finishRequest(id, true, image);
+        return;
+    }
+    const QPointer<MediaPlayer> self = this;
+    SnapshotWriter::run([self, id, image, size](){
+        const QImage scaled = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        // Checked on the GUI thread, the player may be gone by then.
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, id, scaled](){
+            if (self) {
+                Q_EMIT self->requestFinished(id, true, scaled);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MediaPlayer::finishRequest(const quint64 id, const bool success, const QVariant &result)
+{
+    if (id == 0) {
+        return;
+    }
+    // Always deliver the result through the event loop, so the caller has got
+    // the request id before the signal arrives, no matter which thread the
+    // backend reports the result from.
+    QMetaObject::invokeMethod(this, [this, id, success, result](){
+        Q_EMIT requestFinished(id, success, result);
+    }, Qt::QueuedConnection);
+}
+
 void MediaPlayer::play(const QUrl &url)
 {
     Q_ASSERT(url.isValid());
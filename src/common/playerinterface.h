@@ -26,7 +26,11 @@
 
 #include "playertypes.h"
 #include "mediainfo.h"
+#include "presentationclock.h"
+#include "frametap.h"
 #include <QtQuick/qquickitem.h>
+#include <QtCore/qiodevice.h>
+#include <QtGui/qimage.h>
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
 
@@ -47,8 +51,8 @@ class QTMEDIAPLAYER_COMMON_API MediaPlayer : public QQuickItem
     Q_PROPERTY(QString backendCopyright READ backendCopyright CONSTANT FINAL)
     Q_PROPERTY(QString backendLicenses READ backendLicenses CONSTANT FINAL)
     Q_PROPERTY(QString backendHomepage READ backendHomepage CONSTANT FINAL)
-    Q_PROPERTY(QString ffmpegVersion READ ffmpegVersion CONSTANT FINAL)
-    Q_PROPERTY(QString ffmpegConfiguration READ ffmpegConfiguration CONSTANT FINAL)
+    Q_PROPERTY(QString ffmpegVersion READ ffmpegVersion NOTIFY ffmpegInfoChanged FINAL)
+    Q_PROPERTY(QString ffmpegConfiguration READ ffmpegConfiguration NOTIFY ffmpegInfoChanged FINAL)
     Q_PROPERTY(QString graphicsApiName READ graphicsApiName CONSTANT FINAL)
     Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged FINAL)
     Q_PROPERTY(QString fileName READ fileName NOTIFY fileNameChanged FINAL)
@@ -89,6 +93,10 @@ class QTMEDIAPLAYER_COMMON_API MediaPlayer : public QQuickItem
     Q_PROPERTY(bool hasAudio READ hasAudio NOTIFY hasAudioChanged FINAL)
     Q_PROPERTY(bool hasSubtitle READ hasSubtitle NOTIFY hasSubtitleChanged FINAL)
     Q_PROPERTY(MediaInfo* mediaInfo READ mediaInfo CONSTANT FINAL)
+    Q_PROPERTY(PresentationClock* clock READ clock CONSTANT FINAL)
+    Q_PROPERTY(bool adaptiveResolution READ adaptiveResolution WRITE setAdaptiveResolution NOTIFY adaptiveResolutionChanged FINAL)
+    Q_PROPERTY(bool suspendWhenHidden READ suspendWhenHidden WRITE setSuspendWhenHidden NOTIFY suspendWhenHiddenChanged FINAL)
+    Q_PROPERTY(bool videoSuspended READ videoSuspended NOTIFY videoSuspendedChanged FINAL)
 
 public:
     explicit MediaPlayer(QQuickItem *parent = nullptr);
@@ -194,6 +202,26 @@ public:
 
     Q_NODISCARD MediaInfo *mediaInfo() const;
 
+    Q_NODISCARD PresentationClock *clock() const;
+
+    // Let the backend decode with cheaper settings when the video is shown
+    // far smaller than its native size.
+    Q_NODISCARD bool adaptiveResolution() const;
+    void setAdaptiveResolution(const bool value);
+
+    // Stop decoding and rendering the video while the item can't be seen,
+    // audio and the clock keep running.
+    Q_NODISCARD bool suspendWhenHidden() const;
+    void setSuspendWhenHidden(const bool value);
+
+    Q_NODISCARD bool videoSuspended() const;
+
+    // C++ only: deliver every decoded video frame to the tap until it's
+    // removed again. The player keeps a reference to the tap meanwhile.
+    // Returns false if the backend can't provide decoded frames.
+    virtual bool addFrameTap(const QSharedPointer<FrameTap> &tap);
+    virtual void removeFrameTap(const QSharedPointer<FrameTap> &tap);
+
 public Q_SLOTS:
     virtual void play() = 0;
     void play(const QUrl &url);
@@ -224,6 +252,58 @@ public:
     Q_NODISCARD Q_INVOKABLE bool isPlayingVideo() const;
     Q_NODISCARD Q_INVOKABLE bool isPlayingAudio() const;
 
+    // Asynchronous variants of the control functions. They never wait for the
+    // backend and return a request id at once, requestFinished() is emitted
+    // later with the same id and the real result of the request.
+    Q_NODISCARD Q_INVOKABLE virtual quint64 loadAsync(const QUrl &url) = 0;
+    Q_NODISCARD Q_INVOKABLE virtual quint64 seekAsync(const qint64 value) = 0;
+    Q_NODISCARD Q_INVOKABLE virtual quint64 setActiveTrackAsync(const TrackType type, const int value) = 0;
+    Q_NODISCARD Q_INVOKABLE virtual quint64 setPropertyAsync(const QString &name, const QVariant &value) = 0;
+
+    // Play from an application provided device, which must be open for reading
+    // and stay alive until another source is set. The name is a hint for the
+    // format detection, a file name with the correct suffix works best.
+    // Only random-access devices are supported, sequential ones (sockets,
+    // network replies, processes) are rejected. The device may be read from
+    // a thread of the backend, so the application must not use it while it
+    // is the source.
+    Q_INVOKABLE virtual void setSourceDevice(QIODevice *device, const QString &name = {}) = 0;
+
+    // Captures the current video frame in memory, nothing is written to disk.
+    // requestFinished() carries the QImage, scaled down to fit the size if a
+    // valid one is given (the aspect ratio is kept).
+    Q_NODISCARD Q_INVOKABLE virtual quint64 grabFrame(const QSize &size = {}) = 0;
+
+protected:
+    // The position used to synchronize the presentation clock, in milliseconds.
+    // Backends that know the position more precisely than position() should
+    // override it.
+    Q_NODISCARD virtual qreal precisePosition() const;
+
+    // The size of the render target for the given item size in pixels. It is
+    // reduced so the video never has to be rendered above its native size,
+    // the scene graph scales it up for free. The aspect ratio is kept.
+    Q_NODISCARD QSize videoRenderSize(const QSize &pixelSize) const;
+
+    // How much smaller than the source the video is shown: 1, 2 or 4. Always
+    // 1 if adaptiveResolution is disabled.
+    Q_NODISCARD int adaptiveDownscale(const QSizeF &sourceSize) const;
+
+    // Called when the video has to be suspended or resumed. The backend
+    // should disable the video track and bring it back at the current
+    // position.
+    virtual void applyVideoSuspension(const bool suspend);
+
+    Q_NODISCARD quint64 createRequestId();
+    void finishRequest(const quint64 id, const bool success, const QVariant &result = {});
+    // Finishes a grabFrame() request, the image is scaled on the thread pool.
+    void finishFrameGrab(const quint64 id, const QImage &image, const QSize &size);
+
+private:
+    Q_NODISCARD bool isVideoHidden() const;
+    void updateVideoSuspension();
+    void trackWindow(QQuickWindow *win);
+
 Q_SIGNALS:
     void loaded();
     void playing();
@@ -231,6 +311,7 @@ Q_SIGNALS:
     void stopped();
     void stoppedWithPosition(const QUrl &url, const qint64 pos);
 
+    void ffmpegInfoChanged();
     void sourceChanged();
     void fileNameChanged();
     void filePathChanged();
@@ -264,9 +345,20 @@ Q_SIGNALS:
     void hasVideoChanged();
     void hasAudioChanged();
     void hasSubtitleChanged();
+    void adaptiveResolutionChanged();
+    void suspendWhenHiddenChanged();
+    void videoSuspendedChanged();
+
+    void requestFinished(const quint64 id, const bool success, const QVariant &result);
 
 private:
     QScopedPointer<MediaInfo> m_mediaInfo{new MediaInfo(this)};
+    QScopedPointer<PresentationClock> m_clock{new PresentationClock(this)};
+    quint64 m_lastRequestId = 0;
+    bool m_adaptiveResolution = false;
+    bool m_suspendWhenHidden = false;
+    bool m_videoSuspended = false;
+    QList<QMetaObject::Connection> m_windowConnections = {};
 };
 
 QTMEDIAPLAYER_END_NAMESPACE
@@ -79,6 +79,14 @@ enum class FillMode
 };
 Q_ENUM_NS(FillMode)
 
+enum class TrackType
+{
+    Video = 0,
+    Audio = 1,
+    Subtitle = 2
+};
+Q_ENUM_NS(TrackType)
+
 struct ChapterInfo
 {
     QString title = {};
@@ -0,0 +1,179 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "presentationclock.h"
+#include <QtCore/qmetaobject.h>
+#include <QtCore/qthread.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+PresentationClock::PresentationClock(QObject *parent) : QObject(parent)
+{
+    m_notifyTimer.setTimerType(Qt::PreciseTimer);
+    // Roughly once per frame of a 60Hz display.
+    m_notifyTimer.setInterval(16);
+    connect(&m_notifyTimer, &QTimer::timeout, this, &PresentationClock::positionChanged);
+    m_elapsed.start();
+}
+
+PresentationClock::~PresentationClock() = default;
+
+qreal PresentationClock::elapsedPosition() const
+{
+    if (!m_running) {
+        return m_basePosition;
+    }
+    const qreal elapsed = (static_cast<qreal>(m_elapsed.nsecsElapsed()) / 1000000.0) * m_rate;
+    const qreal result = m_basePosition + elapsed;
+    // Don't run past the end while waiting for the backend to catch up.
+    return ((m_duration > 0.0) ? qMin(result, m_duration) : result);
+}
+
+qreal PresentationClock::position() const
+{
+    return elapsedPosition();
+}
+
+qreal PresentationClock::duration() const
+{
+    return m_duration;
+}
+
+qreal PresentationClock::rate() const
+{
+    return m_rate;
+}
+
+bool PresentationClock::running() const
+{
+    return m_running;
+}
+
+int PresentationClock::notifyInterval() const
+{
+    return m_notifyTimer.interval();
+}
+
+void PresentationClock::setNotifyInterval(const int value)
+{
+    const int interval = qMax(value, 1);
+    if (m_notifyTimer.interval() == interval) {
+        return;
+    }
+    m_notifyTimer.setInterval(interval);
+    Q_EMIT notifyIntervalChanged();
+}
+
+void PresentationClock::update(const qreal position)
+{
+    m_basePosition = qMax(position, 0.0);
+    m_elapsed.restart();
+    // While running, the notify timer takes care of the change signal.
+    if (!m_running) {
+        Q_EMIT positionChanged();
+    }
+}
+
+void PresentationClock::setDuration(const qreal value)
+{
+    const qreal duration = qMax(value, 0.0);
+    if (qFuzzyCompare(m_duration, duration)) {
+        return;
+    }
+    m_duration = duration;
+    Q_EMIT durationChanged();
+}
+
+void PresentationClock::setRate(const qreal value)
+{
+    if (qFuzzyCompare(m_rate, value) || (value <= 0.0)) {
+        return;
+    }
+    // Keep what has been played so far at the old rate.
+    m_basePosition = elapsedPosition();
+    m_elapsed.restart();
+    m_rate = value;
+    Q_EMIT rateChanged();
+}
+
+void PresentationClock::setRunning(const bool value)
+{
+    if (m_running == value) {
+        return;
+    }
+    m_basePosition = elapsedPosition();
+    m_elapsed.restart();
+    m_running = value;
+    updateNotifyTimer();
+    if (!m_running) {
+        Q_EMIT positionChanged();
+    }
+    Q_EMIT runningChanged();
+}
+
+void PresentationClock::reset()
+{
+    setRunning(false);
+    setDuration(0.0);
+    update(0.0);
+}
+
+void PresentationClock::connectNotify(const QMetaMethod &signal)
+{
+    QObject::connectNotify(signal);
+    if (signal == QMetaMethod::fromSignal(&PresentationClock::positionChanged)) {
+        updateNotifyTimer();
+    }
+}
+
+void PresentationClock::disconnectNotify(const QMetaMethod &signal)
+{
+    QObject::disconnectNotify(signal);
+    if (signal == QMetaMethod::fromSignal(&PresentationClock::positionChanged)) {
+        updateNotifyTimer();
+    }
+}
+
+void PresentationClock::updateNotifyTimer()
+{
+    // Connections can be made from any thread, the timer only works in ours.
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this](){
+            updateNotifyTimer();
+        }, Qt::QueuedConnection);
+        return;
+    }
+    // Nobody would see the notifications, don't wake up for them.
+    const bool active = (m_running && isSignalConnected(QMetaMethod::fromSignal(&PresentationClock::positionChanged)));
+    if (active == m_notifyTimer.isActive()) {
+        return;
+    }
+    if (active) {
+        m_notifyTimer.start();
+    } else {
+        m_notifyTimer.stop();
+    }
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
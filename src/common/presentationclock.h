@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "common_global.h"
+#include <QtCore/qobject.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtQml/qqml.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// Sub-millisecond playback position for the UI. The backends only report the
+// position every now and then, in between the clock extrapolates it from a
+// monotonic timer and the playback rate. QML is notified at most once per
+// notifyInterval while the clock is running and something is connected to
+// positionChanged.
+class QTMEDIAPLAYER_COMMON_API PresentationClock : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(PresentationClock)
+
+    Q_PROPERTY(qreal position READ position NOTIFY positionChanged FINAL)
+    Q_PROPERTY(qreal duration READ duration NOTIFY durationChanged FINAL)
+    Q_PROPERTY(qreal rate READ rate NOTIFY rateChanged FINAL)
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged FINAL)
+    Q_PROPERTY(int notifyInterval READ notifyInterval WRITE setNotifyInterval NOTIFY notifyIntervalChanged FINAL)
+
+public:
+    explicit PresentationClock(QObject *parent = nullptr);
+    ~PresentationClock() override;
+
+    // In milliseconds.
+    Q_NODISCARD qreal position() const;
+    Q_NODISCARD qreal duration() const;
+
+    Q_NODISCARD qreal rate() const;
+
+    Q_NODISCARD bool running() const;
+
+    Q_NODISCARD int notifyInterval() const;
+    void setNotifyInterval(const int value);
+
+    // Fed by the player. Plain methods, so QML can't call them.
+    void update(const qreal position);
+    void setDuration(const qreal value);
+    void setRate(const qreal value);
+    void setRunning(const bool value);
+    void reset();
+
+Q_SIGNALS:
+    void positionChanged();
+    void durationChanged();
+    void rateChanged();
+    void runningChanged();
+    void notifyIntervalChanged();
+
+protected:
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
+
+private:
+    Q_NODISCARD qreal elapsedPosition() const;
+    void updateNotifyTimer();
+
+private:
+    QElapsedTimer m_elapsed;
+    QTimer m_notifyTimer;
+    qreal m_basePosition = 0.0;
+    qreal m_duration = 0.0;
+    qreal m_rate = 1.0;
+    bool m_running = false;
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QTMEDIAPLAYER_PREPEND_NAMESPACE(PresentationClock))
+QML_DECLARE_TYPE(QTMEDIAPLAYER_PREPEND_NAMESPACE(PresentationClock))
@@ -0,0 +1,186 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "snapshotwriter.h"
+#include <QtCore/qdebug.h>
+#include <QtCore/qrunnable.h>
+#include <QtCore/qthreadpool.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+class SnapshotTask : public QRunnable
+{
+    Q_DISABLE_COPY_MOVE(SnapshotTask)
+
+public:
+    explicit SnapshotTask(std::function<void()> &&function) : m_function(std::move(function))
+    {
+        setAutoDelete(true);
+    }
+
+    ~SnapshotTask() override = default;
+
+    void run() override
+    {
+        m_function();
+    }
+
+private:
+    std::function<void()> m_function;
+};
+
+SnapshotTemplate::SnapshotTemplate(const QString &pattern) : m_pattern(pattern)
+{
+    struct Variable
+    {
+        const char *name;
+        Field field;
+    };
+    static const Variable variables[] = {
+        {"filename", Field::FileName},
+        {"date", Field::Date},
+        {"time", Field::Time},
+        {"datetime", Field::DateTime},
+        {"frametime", Field::FrameTime},
+        {"position", Field::Position},
+        {"duration", Field::Duration},
+        {"title", Field::Title},
+        {"author", Field::Author},
+        {"artist", Field::Artist},
+        {"album", Field::Album}
+    };
+    const auto appendLiteral = [this](const QString &text){
+        if (text.isEmpty()) {
+            return;
+        }
+        if (!m_segments.isEmpty() && (m_segments.last().field == Field::Literal)) {
+            m_segments.last().text.append(text);
+            return;
+        }
+        m_segments.append({Field::Literal, text});
+    };
+    int from = 0;
+    while (from < pattern.size()) {
+        const int start = pattern.indexOf(QStringLiteral("${"), from);
+        const int end = ((start < 0) ? -1 : pattern.indexOf(u'}', start + 2));
+        if (end < 0) {
+            appendLiteral(pattern.mid(from));
+            break;
+        }
+        appendLiteral(pattern.mid(from, start - from));
+        const QString name = pattern.mid(start + 2, end - start - 2);
+        Field field = Field::Literal;
+        for (auto &&variable : variables) {
+            if (name.compare(QLatin1String(variable.name), Qt::CaseInsensitive) == 0) {
+                field = variable.field;
+                break;
+            }
+        }
+        if (field == Field::Literal) {
+            appendLiteral(pattern.mid(start, end - start + 1));
+        } else {
+            m_segments.append({field, {}});
+        }
+        from = end + 1;
+    }
+}
+
+QString SnapshotTemplate::pattern() const
+{
+    return m_pattern;
+}
+
+QString SnapshotTemplate::expand(const Context &context) const
+{
+    if (m_segments.isEmpty()) {
+        return context.fileName;
+    }
+    QString result = {};
+    for (auto &&segment : qAsConst(m_segments)) {
+        switch (segment.field) {
+        case Field::Literal:
+            result.append(segment.text);
+            break;
+        case Field::FileName:
+            result.append(context.fileName);
+            break;
+        case Field::Date:
+            result.append(context.dateTime.toString(QStringLiteral("yyyy.MM.dd")));
+            break;
+        case Field::Time:
+            result.append(context.dateTime.toString(QStringLiteral("hh.mm.ss.zzz")));
+            break;
+        case Field::DateTime:
+            result.append(context.dateTime.toString(QStringLiteral("yyyy.MM.dd.hh.mm.ss.zzz")));
+            break;
+        case Field::FrameTime:
+            result.append(QString::number(context.frameTime));
+            break;
+        case Field::Position:
+            result.append(QString::number(context.position));
+            break;
+        case Field::Duration:
+            result.append(QString::number(context.duration));
+            break;
+        case Field::Title:
+            result.append(context.metaData.value(QStringLiteral("title")).toString());
+            break;
+        case Field::Author:
+            result.append(context.metaData.value(QStringLiteral("author")).toString());
+            break;
+        case Field::Artist:
+            result.append(context.metaData.value(QStringLiteral("artist")).toString());
+            break;
+        case Field::Album:
+            result.append(context.metaData.value(QStringLiteral("album")).toString());
+            break;
+        }
+    }
+    return result;
+}
+
+void SnapshotWriter::run(std::function<void()> function)
+{
+    Q_ASSERT(function);
+    if (!function) {
+        return;
+    }
+    QThreadPool::globalInstance()->start(new SnapshotTask(std::move(function)));
+}
+
+void SnapshotWriter::save(const QImage &image, const QString &filePath)
+{
+    Q_ASSERT(!image.isNull());
+    Q_ASSERT(!filePath.isEmpty());
+    if (image.isNull() || filePath.isEmpty()) {
+        return;
+    }
+    run([image, filePath](){
+        if (!image.save(filePath)) {
+            qWarning() << "Failed to save the snapshot to" << filePath;
+        }
+    });
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "playertypes.h"
+#include <QtCore/qdatetime.h>
+#include <QtCore/qvector.h>
+#include <QtGui/qimage.h>
+#include <functional>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// The snapshot file name template, parsed once when it's set instead of
+// searching for every variable each time a snapshot is taken. Variables are
+// written as ${name}, unknown ones are kept as they are.
+class QTMEDIAPLAYER_COMMON_API SnapshotTemplate
+{
+public:
+    struct Context
+    {
+        QString fileName = {}; // Without the suffix.
+        QDateTime dateTime = {};
+        qreal frameTime = 0.0; // In seconds.
+        qint64 position = 0;
+        qint64 duration = 0;
+        MetaData metaData = {};
+    };
+
+    explicit SnapshotTemplate(const QString &pattern = {});
+
+    Q_NODISCARD QString pattern() const;
+
+    // The file name without directory and suffix. An empty template gives
+    // the name of the media file.
+    Q_NODISCARD QString expand(const Context &context) const;
+
+private:
+    enum class Field : quint8
+    {
+        Literal,
+        FileName,
+        Date,
+        Time,
+        DateTime,
+        FrameTime,
+        Position,
+        Duration,
+        Title,
+        Author,
+        Artist,
+        Album
+    };
+
+    struct Segment
+    {
+        Field field = Field::Literal;
+        QString text = {};
+    };
+
+    QString m_pattern = {};
+    QVector<Segment> m_segments = {};
+};
+
+// Runs the expensive parts of taking snapshots on the global thread pool, so
+// neither the GUI thread nor the backends' threads wait for them.
+class QTMEDIAPLAYER_COMMON_API SnapshotWriter
+{
+public:
+    static void run(std::function<void()> function);
+
+    // The format is deduced from the suffix of the path.
+    static void save(const QImage &image, const QString &filePath);
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
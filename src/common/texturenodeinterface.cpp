@@ -23,19 +23,95 @@
  */
 
 #include "texturenodeinterface.h"
+#include <QtQuick/qquickitem.h>
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
 
+// How long the content has to stay smaller before its render target shrinks.
+static constexpr const qint64 kShrinkGracePeriod = 2000;
+
 VideoTextureNode::VideoTextureNode(QQuickItem *item)
 {
-    Q_UNUSED(item);
+    Q_ASSERT(item);
+    if (item) {
+        m_targetWindow = item->window();
+    }
 }
 
-VideoTextureNode::~VideoTextureNode() = default;
+VideoTextureNode::~VideoTextureNode()
+{
+    // Destroyed on the render thread, let the next node have our target.
+    if (m_renderTarget) {
+        VideoTexturePool::instance()->release(m_targetWindow, m_renderTarget.take());
+    }
+}
 
 QSGTexture *VideoTextureNode::texture() const
 {
     return QSGSimpleTextureNode::texture();
 }
 
+void VideoTextureNode::presentTexture(QSGTexture *texture)
+{
+    setTexture(texture);
+    Q_EMIT textureChanged();
+}
+
+void VideoTextureNode::markFrameDirty()
+{
+    m_frameDirty.storeRelease(1);
+}
+
+bool VideoTextureNode::takeFrameDirty()
+{
+    return (m_frameDirty.fetchAndStoreAcquire(0) != 0);
+}
+
+QSize VideoTextureNode::chooseRenderTargetSize(const QSize &current, const QSize &size)
+{
+    const QSize bucket = VideoTexturePool::bucketSize(size);
+    if (current.isEmpty() || (bucket.width() > current.width()) || (bucket.height() > current.height())) {
+        m_shrinkTimer.invalidate();
+        return bucket;
+    }
+    if (bucket == current) {
+        m_shrinkTimer.invalidate();
+        return current;
+    }
+    if (!m_shrinkTimer.isValid()) {
+        m_shrinkTimer.start();
+        return current;
+    }
+    if (!m_shrinkTimer.hasExpired(kShrinkGracePeriod)) {
+        return current;
+    }
+    m_shrinkTimer.invalidate();
+    return bucket;
+}
+
+VideoRenderTarget *VideoTextureNode::recycleRenderTarget(const char *kind, const QSize &size)
+{
+    VideoTexturePool * const pool = VideoTexturePool::instance();
+    if (m_renderTarget) {
+        pool->release(m_targetWindow, m_renderTarget.take());
+    }
+    return pool->acquire(m_targetWindow, kind, size);
+}
+
+void VideoTextureNode::setRenderTarget(VideoRenderTarget *target)
+{
+    if (m_renderTarget.data() == target) {
+        return;
+    }
+    if (m_renderTarget) {
+        VideoTexturePool::instance()->release(m_targetWindow, m_renderTarget.take());
+    }
+    m_renderTarget.reset(target);
+}
+
+VideoRenderTarget *VideoTextureNode::renderTarget() const
+{
+    return m_renderTarget.data();
+}
+
 QTMEDIAPLAYER_END_NAMESPACE
@@ -25,11 +25,15 @@
 #pragma once
 
 #include "common_global.h"
+#include "videotexturepool.h"
+#include <QtCore/qatomic.h>
+#include <QtCore/qelapsedtimer.h>
 #include <QtQuick/qsgtextureprovider.h>
 #include <QtQuick/qsgsimpletexturenode.h>
 
 QT_BEGIN_NAMESPACE
 QT_FORWARD_DECLARE_CLASS(QQuickItem)
+QT_FORWARD_DECLARE_CLASS(QQuickWindow)
 QT_END_NAMESPACE
 
 QTMEDIAPLAYER_BEGIN_NAMESPACE
@@ -52,6 +56,36 @@ protected Q_SLOTS:
 
 protected:
     Q_NODISCARD virtual QSGTexture *ensureTexture(void *player, const QSize &size) = 0;
+
+    // setTexture() for the video, also tells the consumers of the texture
+    // provider (VideoMirror, ShaderEffect) to pick up the new texture.
+    void presentTexture(QSGTexture *texture);
+
+    // The video content changed, render() has to draw it again. Thread safe.
+    void markFrameDirty();
+    // Whether the video content changed since the last call, resets the state.
+    Q_NODISCARD bool takeFrameDirty();
+
+    // Render targets are allocated in buckets (see VideoTexturePool::bucketSize())
+    // and the video only covers the top-left part of them. Returns the size the
+    // target should have for content of the given size: it grows immediately,
+    // but only shrinks after the content has been smaller for a while, so that
+    // resizing the window doesn't reallocate GPU memory on every frame.
+    Q_NODISCARD QSize chooseRenderTargetSize(const QSize &current, const QSize &size);
+
+    // Moves the current render target back into the pool and returns a free one
+    // of the given kind and size, or nullptr if the node has to create it.
+    Q_NODISCARD VideoRenderTarget *recycleRenderTarget(const char *kind, const QSize &size);
+    // Takes ownership of the target.
+    void setRenderTarget(VideoRenderTarget *target);
+    Q_NODISCARD VideoRenderTarget *renderTarget() const;
+
+private:
+    // Nothing has been drawn into the texture yet, so start dirty.
+    QAtomicInt m_frameDirty = 1;
+    QQuickWindow *m_targetWindow = nullptr;
+    QScopedPointer<VideoRenderTarget> m_renderTarget;
+    QElapsedTimer m_shrinkTimer;
 };
 
 QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "videomirror.h"
+#include "playerinterface.h"
+#include "texturenodeinterface.h"
+#include <QtQuick/qsgsimpletexturenode.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// Picks up the texture of the source right before the frame is drawn. The
+// source renders the new frame in beforeRendering(), which is after the
+// scene graph has been synchronized, so doing it in updatePaintNode() would
+// always show the previous frame.
+class VideoMirrorNode : public QObject, public QSGNode
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(VideoMirrorNode)
+
+public:
+    explicit VideoMirrorNode(VideoTextureNode *source) : m_source(source)
+    {
+        Q_ASSERT(m_source);
+        setFlag(UsePreprocess);
+        // The textures of the source die with it.
+        connect(m_source, &QObject::destroyed, this, &VideoMirrorNode::detach, Qt::DirectConnection);
+    }
+
+    ~VideoMirrorNode() override = default;
+
+    Q_NODISCARD VideoTextureNode *source() const
+    {
+        return m_source;
+    }
+
+    void setRect(const QRectF &rect)
+    {
+        m_rect = rect;
+        if (m_content) {
+            m_content->setRect(m_rect);
+        }
+    }
+
+    void preprocess() override
+    {
+        if (!m_source) {
+            return;
+        }
+        QSGTexture * const texture = m_source->texture();
+        if (!texture) {
+            return;
+        }
+        if (!m_content) {
+            m_content = new QSGSimpleTextureNode;
+            m_content->setOwnsTexture(false);
+            m_content->setFiltering(QSGTexture::Linear);
+            m_content->setTexture(texture);
+            m_content->setRect(m_rect);
+            appendChildNode(m_content);
+        } else if (m_content->texture() != texture) {
+            m_content->setTexture(texture);
+        }
+        // The video only covers a part of pooled render targets.
+        if (m_content->sourceRect() != m_source->sourceRect()) {
+            m_content->setSourceRect(m_source->sourceRect());
+        }
+        if (m_content->textureCoordinatesTransform() != m_source->textureCoordinatesTransform()) {
+            m_content->setTextureCoordinatesTransform(m_source->textureCoordinatesTransform());
+        }
+    }
+
+private Q_SLOTS:
+    void detach()
+    {
+        m_source = nullptr;
+        if (m_content) {
+            removeChildNode(m_content);
+            delete m_content;
+            m_content = nullptr;
+        }
+    }
+
+private:
+    QPointer<VideoTextureNode> m_source;
+    QSGSimpleTextureNode *m_content = nullptr;
+    QRectF m_rect = {};
+};
+
+VideoMirror::VideoMirror(QQuickItem *parent) : QQuickItem(parent)
+{
+    setFlag(ItemHasContents);
+}
+
+VideoMirror::~VideoMirror() = default;
+
+MediaPlayer *VideoMirror::source() const
+{
+    return m_source;
+}
+
+void VideoMirror::setSource(MediaPlayer *value)
+{
+    if (m_source == value) {
+        return;
+    }
+    if (m_source) {
+        disconnect(m_source, nullptr, this, nullptr);
+    }
+    m_source = value;
+    if (m_source) {
+        // The paint node of the source is created lazily and is gone again
+        // when it loses its window.
+        connect(m_source, &MediaPlayer::windowChanged, this, &VideoMirror::update);
+        connect(m_source, &MediaPlayer::rendererReadyChanged, this, &VideoMirror::update);
+        connect(m_source, &QObject::destroyed, this, &VideoMirror::update);
+    }
+    Q_EMIT sourceChanged();
+    update();
+}
+
+QSGNode *VideoMirror::updatePaintNode(QSGNode *node, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data);
+    auto n = static_cast<VideoMirrorNode *>(node);
+    // Textures can't be shared between windows.
+    const bool usable = (m_source && window() && (m_source->window() == window()));
+    const auto provider = (usable ? m_source->textureProvider() : nullptr);
+    if (provider != m_provider) {
+        disconnect(m_providerConnection);
+        m_provider = provider;
+        if (m_provider) {
+            // Emitted from the render thread whenever the source gets a new
+            // texture (a new render target, the next buffer of a ring).
+            m_providerConnection = connect(m_provider, &QSGTextureProvider::textureChanged,
+                                           this, &VideoMirror::update, Qt::QueuedConnection);
+        }
+    }
+    const auto source = qobject_cast<VideoTextureNode *>(provider);
+    if (!source || (width() <= 0) || (height() <= 0)) {
+        delete n;
+        return nullptr;
+    }
+    if (n && (n->source() != source)) {
+        delete n;
+        n = nullptr;
+    }
+    if (!n) {
+        n = new VideoMirrorNode(source);
+    }
+    n->setRect(boundingRect());
+    return n;
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
+
+#include "videomirror.moc"
@@ -0,0 +1,67 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "common_global.h"
+#include <QtCore/qpointer.h>
+#include <QtQuick/qquickitem.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+class MediaPlayer;
+
+// Shows the video of another MediaPlayer item of the same window. Nothing is
+// decoded or rendered a second time, the mirror samples the texture of the
+// source, so any number of copies (picture-in-picture, minimaps, ...) cost
+// one draw call each. The whole item of the source is mirrored, including
+// its letterboxing, and stretched to the size of the mirror.
+class QTMEDIAPLAYER_COMMON_API VideoMirror : public QQuickItem
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(VideoMirror)
+
+    Q_PROPERTY(MediaPlayer* source READ source WRITE setSource NOTIFY sourceChanged FINAL)
+
+public:
+    explicit VideoMirror(QQuickItem *parent = nullptr);
+    ~VideoMirror() override;
+
+    Q_NODISCARD MediaPlayer *source() const;
+    void setSource(MediaPlayer *value);
+
+protected:
+    Q_NODISCARD QSGNode *updatePaintNode(QSGNode *node, UpdatePaintNodeData *data) override;
+
+Q_SIGNALS:
+    void sourceChanged();
+
+private:
+    QPointer<MediaPlayer> m_source;
+    // The texture provider we are listening to, only touched on the render thread.
+    QPointer<QSGTextureProvider> m_provider;
+    QMetaObject::Connection m_providerConnection = {};
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,167 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "videotexturepool.h"
+#include <cstring>
+#include <QtQuick/qquickwindow.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+Q_GLOBAL_STATIC(VideoTexturePool, videoTexturePoolInstance)
+
+// Free targets kept per window, the oldest ones are destroyed first.
+static constexpr const int kMaxFreeTargets = 4;
+
+static constexpr const int kMinBucketStep = 64;
+
+[[nodiscard]] static inline int bucketLength(const int value)
+{
+    if (value <= kMinBucketStep) {
+        return kMinBucketStep;
+    }
+    int pot = kMinBucketStep;
+    while (pot < value) {
+        pot *= 2;
+    }
+    const int step = qMax(kMinBucketStep, pot / 8);
+    return (((value + step - 1) / step) * step);
+}
+
+VideoRenderTarget::VideoRenderTarget(const char *kind, const QSize &size) : m_kind(kind), m_size(size)
+{
+    Q_ASSERT(kind);
+}
+
+VideoRenderTarget::~VideoRenderTarget() = default;
+
+const char *VideoRenderTarget::kind() const
+{
+    return m_kind;
+}
+
+QSize VideoRenderTarget::size() const
+{
+    return m_size;
+}
+
+VideoTexturePool::VideoTexturePool() = default;
+
+VideoTexturePool::~VideoTexturePool()
+{
+    // The graphics resources are gone already if there is anything left here,
+    // don't touch them.
+    m_targets.clear();
+}
+
+VideoTexturePool *VideoTexturePool::instance()
+{
+    return videoTexturePoolInstance();
+}
+
+QSize VideoTexturePool::bucketSize(const QSize &size)
+{
+    if (size.isEmpty()) {
+        return {};
+    }
+    return {bucketLength(size.width()), bucketLength(size.height())};
+}
+
+VideoRenderTarget *VideoTexturePool::acquire(QQuickWindow *window, const char *kind, const QSize &size)
+{
+    Q_ASSERT(window);
+    Q_ASSERT(kind);
+    if (!window || !kind) {
+        return nullptr;
+    }
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_targets.find(window);
+    if (it == m_targets.end()) {
+        return nullptr;
+    }
+    QList<VideoRenderTarget *> &targets = it.value();
+    for (int i = 0; i != targets.size(); ++i) {
+        VideoRenderTarget * const target = targets.at(i);
+        if ((target->size() == size) && (std::strcmp(target->kind(), kind) == 0)) {
+            targets.removeAt(i);
+            return target;
+        }
+    }
+    return nullptr;
+}
+
+void VideoTexturePool::release(QQuickWindow *window, VideoRenderTarget *target)
+{
+    Q_ASSERT(window);
+    Q_ASSERT(target);
+    if (!target) {
+        return;
+    }
+    if (!window) {
+        delete target;
+        return;
+    }
+    VideoRenderTarget *evicted = nullptr;
+    bool firstTarget = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_windows.contains(window)) {
+            m_windows.insert(window);
+            firstTarget = true;
+        }
+        QList<VideoRenderTarget *> &targets = m_targets[window];
+        targets.append(target);
+        if (targets.size() > kMaxFreeTargets) {
+            evicted = targets.takeFirst();
+        }
+    }
+    if (firstTarget) {
+        // The targets belong to the graphics context of the window, they have to
+        // be destroyed together with it, on the render thread while it's current.
+        QObject::connect(window, &QQuickWindow::sceneGraphInvalidated, window, [this, window](){
+            clear(window);
+        }, Qt::DirectConnection);
+        // The window normally invalidates its scene graph before this. Whatever
+        // is still left can't be destroyed safely anymore without a context, so
+        // only forget about it.
+        QObject::connect(window, &QObject::destroyed, [this, window](){
+            QMutexLocker locker(&m_mutex);
+            m_targets.remove(window);
+            m_windows.remove(window);
+        });
+    }
+    // Called on the render thread, so the graphics context is current.
+    delete evicted;
+}
+
+void VideoTexturePool::clear(QQuickWindow *window)
+{
+    QList<VideoRenderTarget *> targets = {};
+    {
+        QMutexLocker locker(&m_mutex);
+        targets = m_targets.take(window);
+    }
+    qDeleteAll(targets);
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,96 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "common_global.h"
+#include <QtCore/qsize.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qset.h>
+#include <QtCore/qmutex.h>
+
+QT_BEGIN_NAMESPACE
+QT_FORWARD_DECLARE_CLASS(QQuickWindow)
+QT_END_NAMESPACE
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// A backend specific render target (FBO, native texture, ...). The kind tells
+// the different implementations apart, targets are only reused for the same kind.
+class QTMEDIAPLAYER_COMMON_API VideoRenderTarget
+{
+    Q_DISABLE_COPY_MOVE(VideoRenderTarget)
+
+public:
+    explicit VideoRenderTarget(const char *kind, const QSize &size);
+    virtual ~VideoRenderTarget();
+
+    Q_NODISCARD const char *kind() const;
+    Q_NODISCARD QSize size() const;
+
+private:
+    const char *m_kind = nullptr;
+    QSize m_size = {};
+};
+
+// Keeps the render targets video nodes no longer need, so that the next node
+// of the same window (or the same node after a resize back) doesn't have to
+// allocate GPU memory again. All functions are thread-safe, but targets must
+// only be acquired and released on the render thread of their window.
+class QTMEDIAPLAYER_COMMON_API VideoTexturePool
+{
+    Q_DISABLE_COPY_MOVE(VideoTexturePool)
+
+public:
+    explicit VideoTexturePool();
+    ~VideoTexturePool();
+
+    Q_NODISCARD static VideoTexturePool *instance();
+
+    // Rounds the size up to the one render targets are allocated with. The
+    // steps get bigger with the size, so a target is at most 1/8 larger than
+    // needed in each direction.
+    Q_NODISCARD static QSize bucketSize(const QSize &size);
+
+    // Takes a free target of the given kind and size out of the pool, the
+    // caller owns it afterwards. Returns nullptr if there is none.
+    Q_NODISCARD VideoRenderTarget *acquire(QQuickWindow *window, const char *kind, const QSize &size);
+
+    // Hands the target over to the pool, which destroys it once the scene graph
+    // of the window is invalidated or too many targets are waiting.
+    void release(QQuickWindow *window, VideoRenderTarget *target);
+
+    // Destroys all free targets of the window. Only call this on its render
+    // thread with the graphics context current.
+    void clear(QQuickWindow *window);
+
+private:
+    QMutex m_mutex;
+    QHash<QQuickWindow *, QList<VideoRenderTarget *>> m_targets = {};
+    // Windows whose invalidation we are already listening to.
+    QSet<QQuickWindow *> m_windows = {};
+};
+
+QTMEDIAPLAYER_END_NAMESPACE
@@ -0,0 +1,448 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "yuvconverter.h"
+#include <QtCore/qendian.h>
+#include <cstring>
+#include <vector>
+
+#if defined(Q_PROCESSOR_X86) && (defined(Q_CC_MSVC) || defined(__GNUC__) || defined(__clang__))
+#  define QTMEDIAPLAYER_YUV_X86
+#  include <immintrin.h>
+#  ifdef Q_CC_MSVC
+#    include <intrin.h>
+#  endif
+#  if defined(__GNUC__) || defined(__clang__)
+#    define QTMEDIAPLAYER_TARGET_SSE41 __attribute__((target("sse4.1")))
+#    define QTMEDIAPLAYER_TARGET_AVX2 __attribute__((target("avx2")))
+#  else
+#    define QTMEDIAPLAYER_TARGET_SSE41
+#    define QTMEDIAPLAYER_TARGET_AVX2
+#  endif
+#endif
+
+// NEON is part of every ARM64 CPU, on 32 bit ARM only when the compiler
+// has been told to use it.
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#  define QTMEDIAPLAYER_YUV_NEON
+#  include <arm_neon.h>
+#endif
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+using Coefficients = YuvConverter::Coefficients;
+
+[[nodiscard]] static inline Coefficients makeCoefficients(const YuvConverter::ColorSpace colorSpace, const YuvConverter::Range range)
+{
+    const bool bt709 = (colorSpace == YuvConverter::ColorSpace::BT709);
+    const bool limited = (range == YuvConverter::Range::Limited);
+    const qreal kr = (bt709 ? 0.2126 : 0.299);
+    const qreal kb = (bt709 ? 0.0722 : 0.114);
+    const qreal kg = (1.0 - kr - kb);
+    const qreal ys = (limited ? (255.0 / 219.0) : 1.0);
+    const qreal cs = (limited ? (255.0 / 224.0) : 1.0);
+    // The factors are at most 2.12 (BT.709, limited range), so all products
+    // fit into 16 bits. Only the sum for blue can overflow, and the
+    // saturated value still clamps to 255.
+    const auto fixed = [](const qreal value) -> qint16 { return static_cast<qint16>(qRound(value * 64.0)); };
+    Coefficients coefficients = {};
+    coefficients.yOffset = (limited ? 16 : 0);
+    coefficients.yGain = fixed(ys);
+    coefficients.vr = fixed(2.0 * (1.0 - kr) * cs);
+    coefficients.ug = fixed(-2.0 * (1.0 - kb) * kb / kg * cs);
+    coefficients.vg = fixed(-2.0 * (1.0 - kr) * kr / kg * cs);
+    coefficients.ub = fixed(2.0 * (1.0 - kb) * cs);
+    return coefficients;
+}
+
+[[nodiscard]] static inline uchar clampToByte(const int value)
+{
+    return static_cast<uchar>(qBound(0, value, 255));
+}
+
+// The reference implementation, also converts what's left at the end of the
+// rows for the vector kernels.
+template<bool Interleaved, bool Bgra>
+static inline void convertPixelsScalar(const uchar *y, const uchar *u, const uchar *v, uchar *destination,
+                                       const int from, const int width, const Coefficients &c)
+{
+    for (int x = from; x < width; ++x) {
+        const int chroma = (x / 2);
+        const int cu = ((Interleaved ? u[chroma * 2] : u[chroma]) - 128);
+        const int cv = ((Interleaved ? u[(chroma * 2) + 1] : v[chroma]) - 128);
+        const int luma = ((y[x] - c.yOffset) * c.yGain);
+        const uchar r = clampToByte((luma + (c.vr * cv) + 32) >> 6);
+        const uchar g = clampToByte((luma + (c.ug * cu) + (c.vg * cv) + 32) >> 6);
+        const uchar b = clampToByte((luma + (c.ub * cu) + 32) >> 6);
+        uchar * const pixel = (destination + (x * 4));
+        pixel[0] = (Bgra ? b : r);
+        pixel[1] = g;
+        pixel[2] = (Bgra ? r : b);
+        pixel[3] = 255;
+    }
+}
+
+template<bool Interleaved, bool Bgra>
+static void convertRowScalar(const uchar *y, const uchar *u, const uchar *v, uchar *destination,
+                             const int width, const Coefficients &c)
+{
+    convertPixelsScalar<Interleaved, Bgra>(y, u, v, destination, 0, width, c);
+}
+
+#ifdef QTMEDIAPLAYER_YUV_X86
+template<bool Interleaved, bool Bgra>
+QTMEDIAPLAYER_TARGET_SSE41 static void convertRowSse41(const uchar *y, const uchar *u, const uchar *v, uchar *destination,
+                                                       const int width, const Coefficients &c)
+{
+    const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+    const __m128i yGain = _mm_set1_epi16(c.yGain);
+    const __m128i vr = _mm_set1_epi16(c.vr);
+    const __m128i ug = _mm_set1_epi16(c.ug);
+    const __m128i vg = _mm_set1_epi16(c.vg);
+    const __m128i ub = _mm_set1_epi16(c.ub);
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i round = _mm_set1_epi16(32);
+    const __m128i alpha = _mm_set1_epi8(-1);
+    int x = 0;
+    // 8 pixels per iteration.
+    for (; (x + 8) <= width; x += 8) {
+        const __m128i luma = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + x)));
+        __m128i cu = {};
+        __m128i cv = {};
+        if constexpr (Interleaved) {
+            const __m128i uv = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x));
+            cu = _mm_shuffle_epi8(uv, _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 0, 0, 2, 2, 4, 4, 6, 6));
+            cv = _mm_shuffle_epi8(uv, _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 1, 1, 3, 3, 5, 5, 7, 7));
+        } else {
+            int u4 = 0;
+            int v4 = 0;
+            std::memcpy(&u4, u + (x / 2), sizeof(u4));
+            std::memcpy(&v4, v + (x / 2), sizeof(v4));
+            cu = _mm_cvtsi32_si128(u4);
+            cv = _mm_cvtsi32_si128(v4);
+            cu = _mm_unpacklo_epi8(cu, cu);
+            cv = _mm_unpacklo_epi8(cv, cv);
+        }
+        cu = _mm_sub_epi16(_mm_cvtepu8_epi16(cu), bias);
+        cv = _mm_sub_epi16(_mm_cvtepu8_epi16(cv), bias);
+        const __m128i yt = _mm_mullo_epi16(_mm_sub_epi16(luma, yOffset), yGain);
+        const __m128i r = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yt, _mm_mullo_epi16(cv, vr)), round), 6);
+        const __m128i g = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(_mm_adds_epi16(yt, _mm_mullo_epi16(cu, ug)),
+                                                                       _mm_mullo_epi16(cv, vg)), round), 6);
+        const __m128i b = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yt, _mm_mullo_epi16(cu, ub)), round), 6);
+        const __m128i first = (Bgra ? _mm_packus_epi16(b, b) : _mm_packus_epi16(r, r));
+        const __m128i third = (Bgra ? _mm_packus_epi16(r, r) : _mm_packus_epi16(b, b));
+        const __m128i low = _mm_unpacklo_epi8(first, _mm_packus_epi16(g, g));
+        const __m128i high = _mm_unpacklo_epi8(third, alpha);
+        auto target = reinterpret_cast<__m128i *>(destination + (x * 4));
+        _mm_storeu_si128(target, _mm_unpacklo_epi16(low, high));
+        _mm_storeu_si128(target + 1, _mm_unpackhi_epi16(low, high));
+    }
+    convertPixelsScalar<Interleaved, Bgra>(y, u, v, destination, x, width, c);
+}
+
+template<bool Interleaved, bool Bgra>
+QTMEDIAPLAYER_TARGET_AVX2 static void convertRowAvx2(const uchar *y, const uchar *u, const uchar *v, uchar *destination,
+                                                     const int width, const Coefficients &c)
+{
+    const __m256i yOffset = _mm256_set1_epi16(c.yOffset);
+    const __m256i yGain = _mm256_set1_epi16(c.yGain);
+    const __m256i vr = _mm256_set1_epi16(c.vr);
+    const __m256i ug = _mm256_set1_epi16(c.ug);
+    const __m256i vg = _mm256_set1_epi16(c.vg);
+    const __m256i ub = _mm256_set1_epi16(c.ub);
+    const __m256i bias = _mm256_set1_epi16(128);
+    const __m256i round = _mm256_set1_epi16(32);
+    const __m256i alpha = _mm256_set1_epi8(-1);
+    int x = 0;
+    // 16 pixels per iteration.
+    for (; (x + 16) <= width; x += 16) {
+        const __m256i luma = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x)));
+        __m128i u16 = {};
+        __m128i v16 = {};
+        if constexpr (Interleaved) {
+            const __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x));
+            u16 = _mm_shuffle_epi8(uv, _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14));
+            v16 = _mm_shuffle_epi8(uv, _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15));
+        } else {
+            const __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + (x / 2)));
+            const __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + (x / 2)));
+            u16 = _mm_unpacklo_epi8(u8, u8);
+            v16 = _mm_unpacklo_epi8(v8, v8);
+        }
+        const __m256i cu = _mm256_sub_epi16(_mm256_cvtepu8_epi16(u16), bias);
+        const __m256i cv = _mm256_sub_epi16(_mm256_cvtepu8_epi16(v16), bias);
+        const __m256i yt = _mm256_mullo_epi16(_mm256_sub_epi16(luma, yOffset), yGain);
+        const __m256i r = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(yt, _mm256_mullo_epi16(cv, vr)), round), 6);
+        const __m256i g = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_mm256_adds_epi16(yt, _mm256_mullo_epi16(cu, ug)),
+                                                                                _mm256_mullo_epi16(cv, vg)), round), 6);
+        const __m256i b = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(yt, _mm256_mullo_epi16(cu, ub)), round), 6);
+        // The packs and unpacks work on each 128 bit lane separately: the
+        // first lane ends up with pixels 0-3 and 4-7, the second one with
+        // 8-11 and 12-15.
+        const __m256i first = (Bgra ? _mm256_packus_epi16(b, b) : _mm256_packus_epi16(r, r));
+        const __m256i third = (Bgra ? _mm256_packus_epi16(r, r) : _mm256_packus_epi16(b, b));
+        const __m256i low = _mm256_unpacklo_epi8(first, _mm256_packus_epi16(g, g));
+        const __m256i high = _mm256_unpacklo_epi8(third, alpha);
+        const __m256i pixels0 = _mm256_unpacklo_epi16(low, high);
+        const __m256i pixels1 = _mm256_unpackhi_epi16(low, high);
+        auto target = reinterpret_cast<__m256i *>(destination + (x * 4));
+        _mm256_storeu_si256(target, _mm256_permute2x128_si256(pixels0, pixels1, 0x20));
+        _mm256_storeu_si256(target + 1, _mm256_permute2x128_si256(pixels0, pixels1, 0x31));
+    }
+    convertPixelsScalar<Interleaved, Bgra>(y, u, v, destination, x, width, c);
+}
+#endif // QTMEDIAPLAYER_YUV_X86
+
+#ifdef QTMEDIAPLAYER_YUV_NEON
+static inline void convertPixelsNeon(const uint8x8_t luma, const uint8x8_t u, const uint8x8_t v, const Coefficients &c,
+                                     uint8x8_t *r, uint8x8_t *g, uint8x8_t *b)
+{
+    const int16x8_t bias = vdupq_n_s16(128);
+    const int16x8_t cu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)), bias);
+    const int16x8_t cv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)), bias);
+    const int16x8_t yt = vmulq_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(luma)), vdupq_n_s16(c.yOffset)), vdupq_n_s16(c.yGain));
+    // Rounds like the other kernels: (x + 32) >> 6, clamped to [0, 255].
+    *r = vqrshrun_n_s16(vqaddq_s16(yt, vmulq_s16(cv, vdupq_n_s16(c.vr))), 6);
+    *g = vqrshrun_n_s16(vqaddq_s16(vqaddq_s16(yt, vmulq_s16(cu, vdupq_n_s16(c.ug))), vmulq_s16(cv, vdupq_n_s16(c.vg))), 6);
+    *b = vqrshrun_n_s16(vqaddq_s16(yt, vmulq_s16(cu, vdupq_n_s16(c.ub))), 6);
+}
+
+template<bool Interleaved, bool Bgra>
+static void convertRowNeon(const uchar *y, const uchar *u, const uchar *v, uchar *destination,
+                           const int width, const Coefficients &c)
+{
+    int x = 0;
+    // 16 pixels per iteration.
+    for (; (x + 16) <= width; x += 16) {
+        const uint8x16_t luma = vld1q_u8(y + x);
+        uint8x8_t u8 = {};
+        uint8x8_t v8 = {};
+        if constexpr (Interleaved) {
+            const uint8x8x2_t uv = vld2_u8(u + x);
+            u8 = uv.val[0];
+            v8 = uv.val[1];
+        } else {
+            u8 = vld1_u8(u + (x / 2));
+            v8 = vld1_u8(v + (x / 2));
+        }
+        const uint8x8x2_t cu = vzip_u8(u8, u8);
+        const uint8x8x2_t cv = vzip_u8(v8, v8);
+        uint8x8_t r[2] = {};
+        uint8x8_t g[2] = {};
+        uint8x8_t b[2] = {};
+        convertPixelsNeon(vget_low_u8(luma), cu.val[0], cv.val[0], c, &r[0], &g[0], &b[0]);
+        convertPixelsNeon(vget_high_u8(luma), cu.val[1], cv.val[1], c, &r[1], &g[1], &b[1]);
+        uint8x16x4_t pixels = {};
+        pixels.val[0] = (Bgra ? vcombine_u8(b[0], b[1]) : vcombine_u8(r[0], r[1]));
+        pixels.val[1] = vcombine_u8(g[0], g[1]);
+        pixels.val[2] = (Bgra ? vcombine_u8(r[0], r[1]) : vcombine_u8(b[0], b[1]));
+        pixels.val[3] = vdupq_n_u8(255);
+        vst4q_u8(destination + (x * 4), pixels);
+    }
+    convertPixelsScalar<Interleaved, Bgra>(y, u, v, destination, x, width, c);
+}
+#endif // QTMEDIAPLAYER_YUV_NEON
+
+#define QTMEDIAPLAYER_ROW_FUNCTION(Name, Interleaved, Bgra) \
+    ((Interleaved) ? ((Bgra) ? &Name<true, true> : &Name<true, false>) \
+                   : ((Bgra) ? &Name<false, true> : &Name<false, false>))
+
+[[nodiscard]] static inline YuvConverter::RowFunction rowFunction(const YuvConverter::Kernel kernel, const bool interleaved, const bool bgra)
+{
+    switch (kernel) {
+#ifdef QTMEDIAPLAYER_YUV_X86
+    case YuvConverter::Kernel::SSE41:
+        return QTMEDIAPLAYER_ROW_FUNCTION(convertRowSse41, interleaved, bgra);
+    case YuvConverter::Kernel::AVX2:
+        return QTMEDIAPLAYER_ROW_FUNCTION(convertRowAvx2, interleaved, bgra);
+#endif
+#ifdef QTMEDIAPLAYER_YUV_NEON
+    case YuvConverter::Kernel::NEON:
+        return QTMEDIAPLAYER_ROW_FUNCTION(convertRowNeon, interleaved, bgra);
+#endif
+    default:
+        break;
+    }
+    return QTMEDIAPLAYER_ROW_FUNCTION(convertRowScalar, interleaved, bgra);
+}
+
+#undef QTMEDIAPLAYER_ROW_FUNCTION
+
+[[nodiscard]] static inline bool cpuHasSse41()
+{
+#ifdef QTMEDIAPLAYER_YUV_X86
+#  ifdef Q_CC_MSVC
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19));
+#  else
+    return __builtin_cpu_supports("sse4.1");
+#  endif
+#else
+    return false;
+#endif
+}
+
+[[nodiscard]] static inline bool cpuHasAvx2()
+{
+#ifdef QTMEDIAPLAYER_YUV_X86
+#  ifdef Q_CC_MSVC
+    int info[4] = {};
+    __cpuid(info, 1);
+    // The OS has to save the YMM registers as well.
+    const bool osxsave = (info[2] & (1 << 27));
+    const bool avx = (info[2] & (1 << 28));
+    if (!osxsave || !avx || ((_xgetbv(0) & 6) != 6)) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5));
+#  else
+    return __builtin_cpu_supports("avx2");
+#  endif
+#else
+    return false;
+#endif
+}
+
+// Brings a row of P010 samples (10 bits in the high bits of 16) down to 8 bits.
+static inline void narrowP010Row(const uchar *source, uchar *destination, const int count)
+{
+    for (int i = 0; i != count; ++i) {
+        const quint16 value = qFromLittleEndian<quint16>(source + (i * 2));
+        destination[i] = clampToByte((value + 128) >> 8);
+    }
+}
+
+YuvConverter::YuvConverter(const ColorSpace colorSpace, const Range range, const OutputFormat outputFormat, const Kernel kernel)
+{
+    m_colorSpace = colorSpace;
+    m_range = range;
+    m_outputFormat = outputFormat;
+    m_kernel = (((kernel != Kernel::Auto) && isKernelSupported(kernel)) ? kernel : bestKernel());
+    m_coefficients = makeCoefficients(m_colorSpace, m_range);
+    const bool bgra = (m_outputFormat == OutputFormat::BGRA);
+    m_rows[0] = rowFunction(m_kernel, false, bgra);
+    m_rows[1] = rowFunction(m_kernel, true, bgra);
+}
+
+YuvConverter::~YuvConverter() = default;
+
+YuvConverter::Kernel YuvConverter::bestKernel()
+{
+    static const Kernel kernel = []() -> Kernel {
+        if (isKernelSupported(Kernel::AVX2)) {
+            return Kernel::AVX2;
+        }
+        if (isKernelSupported(Kernel::SSE41)) {
+            return Kernel::SSE41;
+        }
+        if (isKernelSupported(Kernel::NEON)) {
+            return Kernel::NEON;
+        }
+        return Kernel::Scalar;
+    }();
+    return kernel;
+}
+
+bool YuvConverter::isKernelSupported(const Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::Auto:
+    case Kernel::Scalar:
+        return true;
+    case Kernel::SSE41:
+        return cpuHasSse41();
+    case Kernel::AVX2:
+        return cpuHasAvx2();
+    case Kernel::NEON:
+#ifdef QTMEDIAPLAYER_YUV_NEON
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+YuvConverter::Kernel YuvConverter::kernel() const
+{
+    return m_kernel;
+}
+
+YuvConverter::ColorSpace YuvConverter::colorSpace() const
+{
+    return m_colorSpace;
+}
+
+YuvConverter::Range YuvConverter::range() const
+{
+    return m_range;
+}
+
+YuvConverter::OutputFormat YuvConverter::outputFormat() const
+{
+    return m_outputFormat;
+}
+
+bool YuvConverter::convert(const Frame &frame, uchar *destination, const int destinationStride) const
+{
+    const int width = frame.size.width();
+    const int height = frame.size.height();
+    if (!destination || (width <= 0) || (height <= 0) || (destinationStride < (width * 4))) {
+        return false;
+    }
+    const bool planar = (frame.format == PixelFormat::I420);
+    if (!frame.planes[0] || !frame.planes[1] || (planar && !frame.planes[2])) {
+        return false;
+    }
+    const int chromaWidth = ((width + 1) / 2);
+    const RowFunction row = m_rows[planar ? 0 : 1];
+    // P010 rows are narrowed into this buffer first: the luma row, followed
+    // by the interleaved chroma row.
+    std::vector<uchar> narrowed = {};
+    if (frame.format == PixelFormat::P010) {
+        narrowed.resize(width + (chromaWidth * 2));
+    }
+    for (int line = 0; line != height; ++line) {
+        const int chromaLine = (line / 2);
+        const uchar *y = (frame.planes[0] + (qptrdiff(line) * frame.strides[0]));
+        const uchar *u = (frame.planes[1] + (qptrdiff(chromaLine) * frame.strides[1]));
+        const uchar *v = (planar ? (frame.planes[2] + (qptrdiff(chromaLine) * frame.strides[2])) : nullptr);
+        if (frame.format == PixelFormat::P010) {
+            narrowP010Row(y, narrowed.data(), width);
+            // Each chroma row is shared by two luma rows.
+            if ((line % 2) == 0) {
+                narrowP010Row(u, narrowed.data() + width, chromaWidth * 2);
+            }
+            y = narrowed.data();
+            u = (narrowed.data() + width);
+        }
+        row(y, u, v, (destination + (qptrdiff(line) * destinationStride)), width, m_coefficients);
+    }
+    return true;
+}
+
+QTMEDIAPLAYER_END_NAMESPACE
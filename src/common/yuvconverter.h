@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2022 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "common_global.h"
+#include <QtCore/qsize.h>
+
+QTMEDIAPLAYER_BEGIN_NAMESPACE
+
+// Converts decoded YUV frames to 8 bit RGBA or BGRA on the CPU, for the paths
+// that can't leave the conversion to the GPU: the software renderer,
+// snapshots and frame taps. The chroma samples are repeated instead of
+// interpolated and P010 is reduced to 8 bits first. The conversion uses the
+// widest instruction set the CPU supports (AVX2, SSE4.1, NEON), all kernels
+// produce exactly the same result as the scalar one.
+class QTMEDIAPLAYER_COMMON_API YuvConverter
+{
+public:
+    enum class PixelFormat
+    {
+        I420,
+        NV12,
+        P010
+    };
+
+    enum class OutputFormat
+    {
+        RGBA,
+        BGRA
+    };
+
+    enum class ColorSpace
+    {
+        BT601,
+        BT709
+    };
+
+    enum class Range
+    {
+        Limited,
+        Full
+    };
+
+    enum class Kernel
+    {
+        Auto,
+        Scalar,
+        SSE41,
+        AVX2,
+        NEON
+    };
+
+    struct Frame
+    {
+        PixelFormat format = PixelFormat::I420;
+        QSize size = {};
+        // Y, U and V for I420, Y and interleaved UV for NV12 and P010.
+        const uchar *planes[3] = {};
+        // In bytes.
+        int strides[3] = {};
+    };
+
+    explicit YuvConverter(const ColorSpace colorSpace = ColorSpace::BT709, const Range range = Range::Limited,
+                          const OutputFormat outputFormat = OutputFormat::RGBA, const Kernel kernel = Kernel::Auto);
+    ~YuvConverter();
+
+    // The fastest kernel this CPU can run.
+    Q_NODISCARD static Kernel bestKernel();
+    Q_NODISCARD static bool isKernelSupported(const Kernel kernel);
+
+    // The kernel actually used, unsupported ones fall back to bestKernel().
+    Q_NODISCARD Kernel kernel() const;
+    Q_NODISCARD ColorSpace colorSpace() const;
+    Q_NODISCARD Range range() const;
+    Q_NODISCARD OutputFormat outputFormat() const;
+
+    // Writes frame.size.height() rows of 4 * frame.size.width() bytes,
+    // destinationStride bytes apart. Returns false if the frame is incomplete.
+    bool convert(const Frame &frame, uchar *destination, const int destinationStride) const;
+
+    struct Coefficients
+    {
+        // 6 bit fixed point factors, applied to Y - yOffset, U - 128 and V - 128.
+        qint16 yOffset = 0;
+        qint16 yGain = 0;
+        qint16 vr = 0;
+        qint16 ug = 0;
+        qint16 vg = 0;
+        qint16 ub = 0;
+    };
+
+    using RowFunction = void (*)(const uchar *y, const uchar *u, const uchar *v, uchar *destination,
+                                 const int width, const Coefficients &coefficients);
+
+private:
+    ColorSpace m_colorSpace = ColorSpace::BT709;
+    Range m_range = Range::Limited;
+    OutputFormat m_outputFormat = OutputFormat::RGBA;
+    Kernel m_kernel = Kernel::Scalar;
+    Coefficients m_coefficients = {};
+    // Planar and interleaved chroma.
+    RowFunction m_rows[2] = {};
+};
+
+QTMEDIAPLAYER_END_NAMESPACE